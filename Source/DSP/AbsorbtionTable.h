@@ -0,0 +1,114 @@
+/*
+  ==============================================================================
+
+    Absorbtion to damping coefficient lookup table.
+
+    The mel -> cutoff -> one-pole coefficient mapping used by MultiTapDelay
+    is evaluated at compile time on the Absorbtion parameter grid (0.01
+    steps) and linearly interpolated in between, so moving the parameter
+    never calls expf/powf on the audio thread.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <array>
+#include <cmath>
+
+//==============================================================================
+namespace ConstexprMath
+{
+	constexpr double ln2 = 0.69314718055994530942;
+
+	constexpr double exp(double x)
+	{
+		// x = k * ln2 + r, |r| <= ln2 / 2
+		const int k = (int)(x / ln2 + (x < 0.0 ? -0.5 : 0.5));
+		const double r = x - k * ln2;
+
+		double term = 1.0;
+		double sum = 1.0;
+		for (int n = 1; n < 20; n++)
+		{
+			term *= r / n;
+			sum += term;
+		}
+
+		double scale = 1.0;
+		for (int i = 0; i < k; i++)
+			scale *= 2.0;
+		for (int i = 0; i > k; i--)
+			scale *= 0.5;
+
+		return sum * scale;
+	}
+
+	constexpr double log(double x)
+	{
+		// x = m * 2^e, m in [sqrt(0.5), sqrt(2))
+		int e = 0;
+		while (x >= 1.41421356237309505)
+		{
+			x *= 0.5;
+			e++;
+		}
+		while (x < 0.70710678118654752)
+		{
+			x *= 2.0;
+			e--;
+		}
+
+		const double z = (x - 1.0) / (x + 1.0);
+		const double z2 = z * z;
+		double term = z;
+		double sum = 0.0;
+		for (int n = 1; n < 40; n += 2)
+		{
+			sum += term / n;
+			term *= z2;
+		}
+
+		return 2.0 * sum + e * ln2;
+	}
+
+	constexpr double pow(double x, double y)
+	{
+		return x > 0.0 ? exp(y * log(x)) : 0.0;
+	}
+}
+
+//==============================================================================
+namespace AbsorbtionTable
+{
+	constexpr int STEPS = 100;
+
+	constexpr float coefficient(double absorbtion)
+	{
+		const double mel = 100.0 + (1.0 - absorbtion) * 3600.0;
+		const double f = 700.0 * (ConstexprMath::exp(mel / 1127.0) - 1.0);
+		const double a0 = ConstexprMath::pow(f / 20000.0, 0.6);
+		return (float)(a0 < 0.0 ? 0.0 : (a0 > 1.0 ? 1.0 : a0));
+	}
+
+	constexpr std::array<float, STEPS + 2> makeTable()
+	{
+		std::array<float, STEPS + 2> table = {};
+		for (int i = 0; i <= STEPS; i++)
+			table[i] = coefficient((double)i / STEPS);
+
+		// Guard entry for interpolation at absorbtion == 1
+		table[STEPS + 1] = table[STEPS];
+		return table;
+	}
+
+	constexpr std::array<float, STEPS + 2> table = makeTable();
+
+	inline float lookup(float absorbtion)
+	{
+		const float position = std::fmaxf(std::fminf(absorbtion, 1.0f), 0.0f) * STEPS;
+		const int idx = (int)position;
+		const float fraction = position - idx;
+		return table[idx] + fraction * (table[idx + 1] - table[idx]);
+	}
+}
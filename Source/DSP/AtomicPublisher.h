@@ -0,0 +1,95 @@
+/*
+  ==============================================================================
+
+    Hands immutable objects from one producer thread to the audio thread
+    through an atomic pointer.
+
+    The audio thread protects the object it reads with a single hazard
+    pointer, so it never allocates, locks or frees. Replaced objects are
+    retired on the producer thread and deleted once the audio thread no
+    longer points at them.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <vector>
+
+//==============================================================================
+template <typename T>
+class AtomicPublisher
+{
+public:
+	AtomicPublisher() = default;
+
+	// Nobody reads anymore
+	~AtomicPublisher()
+	{
+		delete m_current.load();
+		for (T* object : m_retired)
+			delete object;
+	}
+
+	// Producer thread, takes ownership
+	void publish(T* object)
+	{
+		T* previous = m_current.exchange(object);
+
+		if (previous != nullptr)
+			m_retired.push_back(previous);
+
+		reclaim();
+	}
+
+	// Audio thread. The returned object stays valid until release(),
+	// nullptr until the first publish.
+	const T* acquire()
+	{
+		// Announce the pointer, then make sure it was not replaced in
+		// between. Once the hazard matches the current object it cannot
+		// be deleted.
+		const T* object = m_current.load();
+
+		for (;;)
+		{
+			m_hazard.store(object);
+			const T* current = m_current.load();
+
+			if (current == object)
+				return object;
+
+			object = current;
+		}
+	}
+
+	void release()
+	{
+		m_hazard.store(nullptr);
+	}
+
+private:
+	void reclaim()
+	{
+		// An object still announced by the audio thread waits for the next publish
+		const T* hazard = m_hazard.load();
+
+		auto inUse = std::partition(m_retired.begin(), m_retired.end(), [hazard](T* object) { return object == hazard; });
+
+		for (auto it = inUse; it != m_retired.end(); ++it)
+			delete *it;
+
+		m_retired.erase(inUse, m_retired.end());
+	}
+
+	std::atomic<T*> m_current { nullptr };
+	std::atomic<const T*> m_hazard { nullptr };
+
+	// Producer thread only
+	std::vector<T*> m_retired;
+
+	AtomicPublisher(const AtomicPublisher&) = delete;
+	AtomicPublisher& operator=(const AtomicPublisher&) = delete;
+};
@@ -0,0 +1,110 @@
+/*
+  ==============================================================================
+
+    One background thread shared by every plugin instance in the process.
+
+  ==============================================================================
+*/
+
+#include "BackgroundWorker.h"
+
+#include <algorithm>
+
+//==============================================================================
+BackgroundWorker::BackgroundWorker()
+{
+	m_thread = std::thread([this] { run(); });
+}
+
+BackgroundWorker::~BackgroundWorker()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_exit = true;
+	}
+
+	m_wake.notify_all();
+	m_thread.join();
+}
+
+std::shared_ptr<BackgroundWorker> BackgroundWorker::getShared()
+{
+	static std::mutex mutex;
+	static std::weak_ptr<BackgroundWorker> shared;
+
+	std::lock_guard<std::mutex> lock(mutex);
+	std::shared_ptr<BackgroundWorker> worker = shared.lock();
+
+	if (worker == nullptr)
+	{
+		worker = std::make_shared<BackgroundWorker>();
+		shared = worker;
+	}
+
+	return worker;
+}
+
+void BackgroundWorker::add(Client* client)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_clients.push_back(client);
+}
+
+void BackgroundWorker::remove(Client* client)
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_clients.erase(std::remove(m_clients.begin(), m_clients.end(), client), m_clients.end());
+	m_done.wait(lock, [this, client] { return m_current != client; });
+}
+
+void BackgroundWorker::post(Client* client)
+{
+	client->m_pending.store(true);
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_signalled.store(true);
+	}
+
+	m_wake.notify_one();
+}
+
+//==============================================================================
+void BackgroundWorker::run()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+
+	for (;;)
+	{
+		m_wake.wait(lock, [this] { return m_exit || m_signalled.load(); });
+
+		if (m_exit)
+			return;
+
+		// Wakes after this point start the next round
+		m_signalled.store(false);
+
+		for (size_t i = 0; i < m_clients.size(); i++)
+		{
+			Client* client = m_clients[i];
+
+			if (!client->m_pending.exchange(false))
+				continue;
+
+			m_current = client;
+			lock.unlock();
+
+			client->runBackgroundJob();
+
+			lock.lock();
+			m_current = nullptr;
+			m_done.notify_all();
+		}
+
+		// A client removed meanwhile shifts the list, go again for any
+		// job the round stepped over
+		for (Client* client : m_clients)
+			if (client->m_pending.load())
+				m_signalled.store(true);
+	}
+}
@@ -0,0 +1,84 @@
+/*
+  ==============================================================================
+
+    One background thread shared by every plugin instance in the process.
+
+    Instances register a Client and wake it when they have work, the
+    worker then calls runBackgroundJob() of every client that was woken.
+    The first getShared() starts the thread, it ends with the last owner,
+    so a session of many instances keeps one mostly sleeping thread
+    instead of one per instance.
+
+    wake() never takes the mutex and may come from the audio thread. The
+    notify can then get lost just before the worker sleeps, a client that
+    needs its job to run wakes again until it did. post() takes the mutex
+    for the notify and is never lost, for every other thread.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//==============================================================================
+class BackgroundWorker
+{
+public:
+	class Client
+	{
+	public:
+		virtual ~Client() = default;
+
+		// Worker thread, once per wake. Never runs for two clients at once.
+		virtual void runBackgroundJob() = 0;
+
+	private:
+		friend class BackgroundWorker;
+		std::atomic<bool> m_pending { false };
+	};
+
+	BackgroundWorker();
+	~BackgroundWorker();
+
+	// Started by the first caller, not on the audio thread
+	static std::shared_ptr<BackgroundWorker> getShared();
+
+	void add(Client* client);
+	// Waits while the job of the client runs
+	void remove(Client* client);
+
+	// Any thread, never blocks on the mutex
+	void wake(Client* client)
+	{
+		client->m_pending.store(true);
+		m_signalled.store(true);
+		m_wake.notify_one();
+	}
+
+	// Not on the audio thread
+	void post(Client* client);
+
+private:
+	void run();
+
+	std::mutex m_mutex;
+	std::condition_variable m_wake;
+	std::condition_variable m_done;
+	std::atomic<bool> m_signalled { false };
+	bool m_exit = false;
+
+	// Guarded by m_mutex
+	std::vector<Client*> m_clients;
+	Client* m_current = nullptr;
+
+	std::thread m_thread;
+
+	BackgroundWorker(const BackgroundWorker&) = delete;
+	BackgroundWorker& operator=(const BackgroundWorker&) = delete;
+};
@@ -0,0 +1,168 @@
+/*
+  ==============================================================================
+
+    Per block cost of the audio callback.
+
+  ==============================================================================
+*/
+
+#include "BlockProfiler.h"
+
+#if ER_INSTRUMENTATION
+
+#include <algorithm>
+#include <cstdio>
+
+//==============================================================================
+static const char* modeName(ReflectionMode mode)
+{
+	switch (mode)
+	{
+		case ReflectionMode::Room:    return "room";
+		case ReflectionMode::Hall:    return "hall";
+		case ReflectionMode::HallEco: return "hall-eco";
+		case ReflectionMode::Custom:  return "custom";
+	}
+	return "";
+}
+
+//==============================================================================
+BlockProfiler::BlockProfiler()
+{
+}
+
+void BlockProfiler::prepare(double sampleRate)
+{
+	m_nanosecondsPerSample = 1.0e9 / sampleRate;
+}
+
+void BlockProfiler::record(long long start, int numSamples, int activeTaps, ReflectionMode mode, bool idle, bool shared)
+{
+	BlockProfile profile;
+	profile.index = m_index++;
+	profile.nanoseconds = (float)(now() - start);
+	profile.load = numSamples > 0 ? (float)(profile.nanoseconds / (numSamples * m_nanosecondsPerSample)) : 0.0f;
+	profile.numSamples = numSamples;
+	profile.activeTaps = activeTaps;
+	profile.mode = mode;
+	profile.overrun = profile.load > m_overrunThreshold.load(std::memory_order_relaxed);
+	profile.idle = idle;
+	profile.shared = shared;
+
+	if (profile.overrun)
+		m_overruns.fetch_add(1, std::memory_order_relaxed);
+
+	if (!m_queue.push(profile))
+		m_dropped.fetch_add(1, std::memory_order_relaxed);
+}
+
+//==============================================================================
+ProfileHistogram::ProfileHistogram()
+{
+}
+
+void ProfileHistogram::add(const BlockProfile& profile)
+{
+	const int bin = std::min((int)(profile.load / BIN_WIDTH), BINS - 1);
+	m_bins[std::max(bin, 0)]++;
+	m_count++;
+	m_loadSum += profile.load;
+	m_maxLoad = std::max(m_maxLoad, (double)profile.load);
+
+	if (profile.numSamples > 0)
+		m_nanosecondsPerSampleSum += profile.nanoseconds / profile.numSamples;
+}
+
+void ProfileHistogram::reset()
+{
+	*this = ProfileHistogram();
+}
+
+double ProfileHistogram::getPercentile(double fraction) const
+{
+	const long long target = (long long)(fraction * m_count);
+	long long below = 0;
+
+	for (int bin = 0; bin < BINS; bin++)
+	{
+		below += m_bins[bin];
+		if (below > target)
+			return std::min((bin + 1) * BIN_WIDTH, m_maxLoad);
+	}
+
+	return m_maxLoad;
+}
+
+//==============================================================================
+ProfileLog::ProfileLog()
+{
+}
+
+int ProfileLog::collect(BlockProfiler& profiler)
+{
+	int collected = 0;
+	BlockProfile profile;
+
+	while (profiler.pop(profile))
+	{
+		m_histogram.add(profile);
+
+		if (m_history.size() < MAX_HISTORY)
+			m_history.push_back(profile);
+
+		collected++;
+	}
+
+	return collected;
+}
+
+void ProfileLog::reset()
+{
+	m_histogram.reset();
+	m_history.clear();
+}
+
+std::string ProfileLog::getSummary(const BlockProfiler& profiler) const
+{
+	char text[160];
+	snprintf(text, sizeof(text), "load %.1f%% avg, %.1f%% p99, %.1f%% max, %llu overruns",
+			 100.0 * m_histogram.getMeanLoad(), 100.0 * m_histogram.getPercentile(0.99),
+			 100.0 * m_histogram.getMaxLoad(), profiler.getOverruns());
+	return text;
+}
+
+bool ProfileLog::writeCsv(const std::string& path) const
+{
+	FILE* file = fopen(path.c_str(), "w");
+	if (file == nullptr)
+		return false;
+
+	fprintf(file, "block,samples,ns,ns_per_sample,load_percent,active_taps,mode,overrun,idle,shared\n");
+
+	for (const BlockProfile& profile : m_history)
+	{
+		fprintf(file, "%llu,%d,%.0f,%.3f,%.3f,%d,%s,%d,%d,%d\n",
+				profile.index, profile.numSamples, profile.nanoseconds,
+				profile.numSamples > 0 ? profile.nanoseconds / profile.numSamples : 0.0f,
+				100.0f * profile.load, profile.activeTaps, modeName(profile.mode),
+				profile.overrun ? 1 : 0, profile.idle ? 1 : 0, profile.shared ? 1 : 0);
+	}
+
+	fprintf(file, "\nload_percent_below,blocks\n");
+
+	for (int bin = 0; bin < ProfileHistogram::BINS; bin++)
+	{
+		if (m_histogram.getBin(bin) == 0)
+			continue;
+
+		// The last bin has no upper edge
+		if (bin < ProfileHistogram::BINS - 1)
+			fprintf(file, "%.1f,%lld\n", 100.0 * (bin + 1) * ProfileHistogram::BIN_WIDTH, m_histogram.getBin(bin));
+		else
+			fprintf(file, "inf,%lld\n", m_histogram.getBin(bin));
+	}
+
+	return fclose(file) == 0;
+}
+
+#endif
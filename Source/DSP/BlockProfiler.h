@@ -0,0 +1,141 @@
+/*
+  ==============================================================================
+
+    Per block cost of the audio callback, compiled in with
+    ER_INSTRUMENTATION=1 only.
+
+    The audio thread times each block and pushes one BlockProfile into a
+    wait-free queue. A reader (the editor, the offline renderer) drains it
+    into a ProfileLog for histograms and CSV export. Without the flag this
+    header declares nothing and the call sites compile away.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#ifndef ER_INSTRUMENTATION
+ #define ER_INSTRUMENTATION 0
+#endif
+
+#if ER_INSTRUMENTATION
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "ReflectionModes.h"
+#include "SpscQueue.h"
+
+//==============================================================================
+struct BlockProfile
+{
+	unsigned long long index = 0;
+	float nanoseconds = 0.0f;
+	// Share of the buffer period the block took
+	float load = 0.0f;
+	int numSamples = 0;
+	int activeTaps = 0;
+	ReflectionMode mode = ReflectionMode::Room;
+	bool overrun = false;
+	bool idle = false;
+	bool shared = false;
+};
+
+//==============================================================================
+class BlockProfiler
+{
+public:
+	BlockProfiler();
+
+	static const int CAPACITY = 8192;
+
+	// Not while the audio thread records
+	void prepare(double sampleRate);
+
+	// Blocks taking more than this share of their buffer period are overruns
+	void setOverrunThreshold(float share) { m_overrunThreshold = share; }
+	float getOverrunThreshold() const { return m_overrunThreshold; }
+
+	// Audio thread
+	static long long now()
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+	void record(long long start, int numSamples, int activeTaps, ReflectionMode mode, bool idle, bool shared);
+
+	// Any thread
+	unsigned long long getOverruns() const { return m_overruns; }
+	// Blocks lost because nobody drained the queue in time
+	unsigned long long getDropped() const { return m_dropped; }
+
+	// One reader thread at a time
+	bool pop(BlockProfile& profile) { return m_queue.pop(profile); }
+
+private:
+	SpscQueue<BlockProfile, CAPACITY> m_queue;
+	double m_nanosecondsPerSample = 1.0e9 / 48000.0;
+	std::atomic<float> m_overrunThreshold { 0.5f };
+	unsigned long long m_index = 0;
+	std::atomic<unsigned long long> m_overruns { 0 };
+	std::atomic<unsigned long long> m_dropped { 0 };
+};
+
+//==============================================================================
+class ProfileHistogram
+{
+public:
+	ProfileHistogram();
+
+	// One bin per tenth of a percent of load up to 100%, the last one
+	// collects everything above
+	static const int BINS = 1001;
+	static constexpr double BIN_WIDTH = 0.001;
+
+	void add(const BlockProfile& profile);
+	void reset();
+
+	long long getCount() const { return m_count; }
+	long long getBin(int bin) const { return m_bins[bin]; }
+	double getMeanLoad() const { return m_count > 0 ? m_loadSum / m_count : 0.0; }
+	double getMaxLoad() const { return m_maxLoad; }
+	double getMeanNanosecondsPerSample() const { return m_count > 0 ? m_nanosecondsPerSampleSum / m_count : 0.0; }
+	// Load that the given fraction of blocks stays below, at bin resolution
+	double getPercentile(double fraction) const;
+
+private:
+	long long m_bins[BINS] = {};
+	long long m_count = 0;
+	double m_loadSum = 0.0;
+	double m_maxLoad = 0.0;
+	double m_nanosecondsPerSampleSum = 0.0;
+};
+
+//==============================================================================
+// Reader side, drains a profiler into a bounded history and a histogram
+class ProfileLog
+{
+public:
+	ProfileLog();
+
+	static const size_t MAX_HISTORY = 1 << 20;
+
+	// Returns the number of blocks collected
+	int collect(BlockProfiler& profiler);
+	void reset();
+
+	const ProfileHistogram& getHistogram() const { return m_histogram; }
+	const std::vector<BlockProfile>& getHistory() const { return m_history; }
+
+	// e.g. "load 2.1% avg, 5.0% p99, 12.3% max, 0 overruns"
+	std::string getSummary(const BlockProfiler& profiler) const;
+	// One row per block, then the histogram
+	bool writeCsv(const std::string& path) const;
+
+private:
+	ProfileHistogram m_histogram;
+	std::vector<BlockProfile> m_history;
+};
+
+#endif
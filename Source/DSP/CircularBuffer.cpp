@@ -0,0 +1,252 @@
+/*
+  ==============================================================================
+
+    Ring buffer holding the delay history of one channel.
+
+  ==============================================================================
+*/
+
+#include "CircularBuffer.h"
+
+#include <cmath>
+#include <cstring>
+
+//==============================================================================
+static inline void convertSamples(float* ER_RESTRICT dst, const int16_t* ER_RESTRICT src, float scale, int count)
+{
+	for (int i = 0; i < count; i++)
+		dst[i] = scale * (float)src[i];
+}
+
+//==============================================================================
+CircularBuffer::CircularBuffer()
+{
+}
+
+void CircularBuffer::init(float* storage, int size, int delayScale, DelayStorage format)
+{
+	m_head = 0;
+	m_size = size;
+	m_delayScale = delayScale;
+
+	if (format == DelayStorage::Compact)
+	{
+		m_buffer = nullptr;
+		m_samples = static_cast<int16_t*>(static_cast<void*>(storage));
+		m_scales = storage + size / 2;
+	}
+	else
+	{
+		m_buffer = storage;
+		m_samples = nullptr;
+		m_scales = nullptr;
+	}
+
+	clear();
+}
+
+void CircularBuffer::clear()
+{
+	m_head = 0;
+
+	if (m_samples != nullptr)
+	{
+		memset(m_samples, 0, m_size * sizeof(int16_t));
+		std::fill(m_scales, m_scales + m_size / SEGMENT, 0.0f);
+		std::fill(m_pending, m_pending + SEGMENT, 0.0f);
+		return;
+	}
+
+	memset(m_buffer, 0, m_size * sizeof(float));
+}
+
+float CircularBuffer::readIndex(int index) const
+{
+	if (m_samples == nullptr)
+		return m_buffer[index];
+
+	const int pendingBegin = m_head - m_head % SEGMENT;
+	if (index >= pendingBegin && index < m_head)
+		return m_pending[index - pendingBegin];
+
+	return m_scales[index / SEGMENT] * m_samples[index];
+}
+
+float CircularBuffer::readDelay(int sample) const
+{
+	const int bufferSize = m_size;
+	int readIdx = m_head + bufferSize - sample;
+
+	if (readIdx >= bufferSize)
+		readIdx = readIdx - bufferSize;
+
+	return readIndex(readIdx);
+}
+
+float CircularBuffer::readFactor(float factor) const
+{
+	return readDelay(delayFromFactor(factor));
+}
+
+void CircularBuffer::writeBlock(const float* samples, int count)
+{
+	if (m_samples != nullptr)
+	{
+		writeCompact(samples, count);
+		return;
+	}
+
+	const int first = std::min(count, m_size - m_head);
+	memcpy(m_buffer + m_head, samples, first * sizeof(float));
+	memcpy(m_buffer, samples + first, (count - first) * sizeof(float));
+
+	m_head += count;
+	if (m_head >= m_size)
+		m_head -= m_size;
+}
+
+void CircularBuffer::read(float* dst, int start, int count) const
+{
+	if (m_samples == nullptr)
+	{
+		const int first = std::min(count, m_size - start);
+		std::copy(m_buffer + start, m_buffer + start + first, dst);
+		std::copy(m_buffer, m_buffer + (count - first), dst + first);
+		return;
+	}
+
+	const int pendingBegin = m_head - m_head % SEGMENT;
+
+	while (count > 0)
+	{
+		const int segment = start / SEGMENT;
+		int run = std::min(count, (segment + 1) * SEGMENT - start);
+
+		if (start >= pendingBegin && start < m_head)
+		{
+			run = std::min(run, m_head - start);
+			std::copy(m_pending + (start - pendingBegin), m_pending + (start - pendingBegin) + run, dst);
+		}
+		else
+			convertSamples(dst, m_samples + start, m_scales[segment], run);
+
+		dst += run;
+		count -= run;
+		start += run;
+		if (start == m_size)
+			start = 0;
+	}
+}
+
+void CircularBuffer::copyFrom(const CircularBuffer& source)
+{
+	int readIdx = source.m_head - m_size;
+	if (readIdx < 0)
+		readIdx += source.m_size;
+
+	if (m_samples != nullptr)
+	{
+		// Segments of the source do not line up with ours, the history is
+		// scaled again one segment at a time, oldest first
+		m_head = 0;
+
+		for (int copied = 0; copied < m_size; copied += SEGMENT)
+		{
+			source.read(m_pending, readIdx, SEGMENT);
+			storeSegment(copied / SEGMENT);
+
+			readIdx += SEGMENT;
+			if (readIdx >= source.m_size)
+				readIdx -= source.m_size;
+		}
+
+		return;
+	}
+
+	// Oldest sample first, the head wraps to the start
+	const int first = std::min(m_size, source.m_size - readIdx);
+	memcpy(m_buffer, source.m_buffer + readIdx, first * sizeof(float));
+	memcpy(m_buffer + first, source.m_buffer, (m_size - first) * sizeof(float));
+
+	m_head = 0;
+}
+
+//==============================================================================
+void CircularBuffer::writeCompact(const float* samples, int count)
+{
+	while (count > 0)
+	{
+		const int offset = m_head % SEGMENT;
+		const int run = std::min(count, SEGMENT - offset);
+
+		std::copy(samples, samples + run, m_pending + offset);
+		samples += run;
+		count -= run;
+		m_head += run;
+
+		// The ring is whole segments, so the head only wraps here
+		if (offset + run == SEGMENT)
+		{
+			storeSegment(m_head / SEGMENT - 1);
+
+			if (m_head == m_size)
+				m_head = 0;
+		}
+	}
+}
+
+void CircularBuffer::storeSegment(int segment)
+{
+	// Eight independent maxima, one running maximum is a serial dependency
+	float lanes[8] = {};
+	for (int i = 0; i < SEGMENT; i += 8)
+		for (int lane = 0; lane < 8; lane++)
+		{
+			const float magnitude = std::abs(m_pending[i + lane]);
+			lanes[lane] = magnitude > lanes[lane] ? magnitude : lanes[lane];
+		}
+
+	float peak = 0.0f;
+	for (float lane : lanes)
+		peak = std::max(peak, lane);
+
+	const float inverse = peak > 0.0f ? 32767.0f / peak : 0.0f;
+	int16_t* samples = m_samples + segment * SEGMENT;
+
+	// Rounded half away from zero, the peak lands on +-32767
+	for (int i = 0; i < SEGMENT; i++)
+	{
+		const float value = m_pending[i] * inverse;
+		samples[i] = (int16_t)(value + (value >= 0.0f ? 0.5f : -0.5f));
+	}
+
+	m_scales[segment] = peak / 32767.0f;
+}
+
+void CircularBuffer::accumulateCompact(float* dst, int start, int count, float gain) const
+{
+	const TapKernels::AccumulateCompactFunction accumulateSamples = m_kernels->accumulateCompact;
+	const int pendingBegin = m_head - m_head % SEGMENT;
+
+	// One run per segment, the part of the head segment that is not stored
+	// yet comes from the pending samples
+	while (count > 0)
+	{
+		const int segment = start / SEGMENT;
+		int run = std::min(count, (segment + 1) * SEGMENT - start);
+
+		if (start >= pendingBegin && start < m_head)
+		{
+			run = std::min(run, m_head - start);
+			accumulateRun(dst, m_pending + (start - pendingBegin), gain, run);
+		}
+		else
+			accumulateSamples(dst, m_samples + start, gain * m_scales[segment], run);
+
+		dst += run;
+		count -= run;
+		start += run;
+		if (start == m_size)
+			start = 0;
+	}
+}
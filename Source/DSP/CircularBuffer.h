@@ -0,0 +1,143 @@
+/*
+  ==============================================================================
+
+    Ring buffer holding the delay history of one channel. The storage is
+    owned by the engine's DelayArena.
+
+    Compact storage keeps the history as 16 bit samples with one scale per
+    SEGMENT samples, half the memory and bandwidth of floats. Samples are
+    collected in float until their segment is complete, then the segment
+    is scaled to its own peak, so the error stays about 96 dB below the
+    peak of every segment however loud or quiet it is.
+
+    Taps of a block are read through the TapKernels the CPU supports.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+
+#include "TapKernels.h"
+
+#if defined(_MSC_VER)
+ #define ER_RESTRICT __restrict
+#else
+ #define ER_RESTRICT __restrict__
+#endif
+
+//==============================================================================
+enum class DelayStorage
+{
+	Float,
+	Compact
+};
+
+//==============================================================================
+class CircularBuffer
+{
+public:
+	CircularBuffer();
+
+	static const int SEGMENT = 256;
+
+	// The delay scale maps tap factors to delays, the buffer only has to be
+	// long enough for the longest tap (factor 1)
+	static int sizeForDelayScale(int delayScale)
+	{
+		return (int)(2.0f + delayScale * 0.98f) + 1;
+	}
+
+	// Compact rings are whole segments
+	static int roundSize(int size, DelayStorage storage)
+	{
+		return storage == DelayStorage::Compact ? (size + SEGMENT - 1) / SEGMENT * SEGMENT : size;
+	}
+
+	// Storage in floats for a ring of a rounded size
+	static size_t getStorageSize(int size, DelayStorage storage)
+	{
+		return storage == DelayStorage::Compact ? (size_t)size / 2 + (size_t)size / SEGMENT : (size_t)size;
+	}
+
+	void init(float* storage, int size, int delayScale, DelayStorage format = DelayStorage::Float);
+	void clear();
+	void writeSample(float sample)
+	{
+		if (m_samples != nullptr)
+		{
+			writeCompact(&sample, 1);
+			return;
+		}
+
+		m_buffer[m_head] = sample;
+		if (++m_head >= m_size)
+			m_head = 0;
+	}
+	float read() const
+	{
+		return readIndex(m_head);
+	}
+	float readDelay(int sample) const;
+	float readFactor(float factor) const;
+	void writeBlock(const float* samples, int count);
+	// Takes over the latest getSize() samples of a ring at least as long
+	// and of the same storage
+	void copyFrom(const CircularBuffer& source);
+	int delayFromFactor(float factor) const
+	{
+		return (int)(2.0f + m_delayScale * factor * 0.98f);
+	}
+
+	// Sample at a ring index
+	float readIndex(int index) const;
+	// Adds gain times count samples from the ring index start, wrapping
+	void accumulate(float* dst, int start, int count, float gain) const
+	{
+		if (m_samples != nullptr)
+		{
+			accumulateCompact(dst, start, count, gain);
+			return;
+		}
+
+		const int first = std::min(count, m_size - start);
+		m_kernels->accumulate(dst, m_buffer + start, gain, first);
+		m_kernels->accumulate(dst + first, m_buffer, gain, count - first);
+	}
+	// Copies count samples from the ring index start, wrapping
+	void read(float* dst, int start, int count) const;
+
+	bool isCompact() const { return m_samples != nullptr; }
+	// The CPU's widest kernels by default
+	void setKernels(const TapKernels& kernels) { m_kernels = &kernels; }
+	// Float storage only
+	const float* getData() const { return m_buffer; }
+	int getHead() const { return m_head; }
+	int getSize() const { return m_size; }
+
+	static inline void accumulateRun(float* ER_RESTRICT dst, const float* ER_RESTRICT src, float gain, int count)
+	{
+		for (int i = 0; i < count; i++)
+			dst[i] += gain * src[i];
+	}
+
+protected:
+	void writeCompact(const float* samples, int count);
+	void storeSegment(int segment);
+	void accumulateCompact(float* dst, int start, int count, float gain) const;
+
+	float *m_buffer = nullptr;
+	int m_head = 0;
+	int m_size = 0;
+	int m_delayScale = 0;
+
+	// Compact storage, the segment at the head holds older samples from
+	// m_head on and the newer ones in m_pending
+	int16_t* m_samples = nullptr;
+	float* m_scales = nullptr;
+	const TapKernels* m_kernels = &getTapKernels();
+	float m_pending[SEGMENT] = {};
+};
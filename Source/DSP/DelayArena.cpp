@@ -0,0 +1,64 @@
+/*
+  ==============================================================================
+
+    Single cache-line aligned block holding every delay history and scratch
+    buffer of an engine.
+
+  ==============================================================================
+*/
+
+#include "DelayArena.h"
+
+#include <cassert>
+#include <cstring>
+#include <new>
+
+//==============================================================================
+DelayArena::DelayArena()
+{
+}
+
+DelayArena::~DelayArena()
+{
+	release();
+}
+
+bool DelayArena::prepare(size_t floats)
+{
+	m_used = 0;
+	floats = roundUp(floats);
+
+	if (floats <= m_capacity)
+	{
+		memset(m_data, 0, m_capacity * sizeof(float));
+		return false;
+	}
+
+	release();
+
+	m_data = static_cast<float*>(::operator new(floats * sizeof(float), std::align_val_t(ALIGNMENT)));
+	m_capacity = floats;
+	memset(m_data, 0, m_capacity * sizeof(float));
+
+	return true;
+}
+
+void DelayArena::release()
+{
+	if (m_data != nullptr)
+		::operator delete(m_data, std::align_val_t(ALIGNMENT));
+
+	m_data = nullptr;
+	m_capacity = 0;
+	m_used = 0;
+}
+
+float* DelayArena::allocate(size_t floats)
+{
+	floats = roundUp(floats);
+	assert(m_used + floats <= m_capacity);
+
+	float* slice = m_data + m_used;
+	m_used += floats;
+	return slice;
+}
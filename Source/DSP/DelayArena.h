@@ -0,0 +1,60 @@
+/*
+  ==============================================================================
+
+    Single cache-line aligned block holding every delay history and scratch
+    buffer of an engine. prepare() sizes it once, allocate() hands out
+    aligned slices with a bump pointer, and the memory is kept across
+    prepares until it has to grow or release() is called.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <cstddef>
+
+//==============================================================================
+class DelayArena
+{
+public:
+	DelayArena();
+	~DelayArena();
+
+	static const int ALIGNMENT = 64;
+	static const int FLOATS_PER_LINE = ALIGNMENT / sizeof(float);
+
+	// Slice size in floats rounded up to whole cache lines
+	static size_t roundUp(size_t floats)
+	{
+		return (floats + FLOATS_PER_LINE - 1) / FLOATS_PER_LINE * FLOATS_PER_LINE;
+	}
+
+	// Slice size in floats for count elements of a trivial type
+	template <typename T>
+	static size_t roundUpFor(size_t count)
+	{
+		return roundUp((count * sizeof(T) + sizeof(float) - 1) / sizeof(float));
+	}
+
+	// Returns true when the memory had to be reallocated
+	bool prepare(size_t floats);
+	void release();
+
+	float* allocate(size_t floats);
+	template <typename T>
+	T* allocateFor(size_t count)
+	{
+		static_assert(alignof(T) <= ALIGNMENT, "Arena slices are cache line aligned");
+		return static_cast<T*>(static_cast<void*>(allocate(roundUpFor<T>(count))));
+	}
+	size_t getCapacity() const { return m_capacity; }
+	size_t getUsed() const { return m_used; }
+
+private:
+	float* m_data = nullptr;
+	size_t m_capacity = 0;
+	size_t m_used = 0;
+
+	DelayArena(const DelayArena&) = delete;
+	DelayArena& operator=(const DelayArena&) = delete;
+};
@@ -0,0 +1,95 @@
+/*
+  ==============================================================================
+
+    Keeps subnormal floats out of the feedback loops.
+
+    After the input stops, the resonance loop and the damping filters decay
+    towards zero and end up in the subnormal range, where x86 and many ARM
+    cores take a slow path for every operation. A one-pole with a pole above
+    0.5 never even reaches zero, it rounds back to the smallest subnormal.
+
+    Two layers: DenormalGuard sets flush-to-zero (and denormals-are-zero on
+    x86) for the scope of a process call, and the delay lines flush their
+    recursive states with flushDenormal() so nothing below -300 dB survives
+    a sample, whatever the FPU mode of the calling thread.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <cmath>
+
+#if defined(_M_X64) || defined(__x86_64__)
+ #include <xmmintrin.h>
+#elif defined(_M_ARM64)
+ #include <intrin.h>
+#endif
+
+//==============================================================================
+// Far below the 24 bit noise floor and far above the subnormal range
+constexpr float DENORMAL_THRESHOLD = 1.0e-15f;
+
+inline float flushDenormal(float value)
+{
+	return std::abs(value) < DENORMAL_THRESHOLD ? 0.0f : value;
+}
+
+//==============================================================================
+// Flush-to-zero for the lifetime of the guard, restored on destruction
+class DenormalGuard
+{
+public:
+	DenormalGuard()
+		: m_saved(getMode())
+	{
+		setMode(m_saved | FLUSH_BITS);
+	}
+
+	~DenormalGuard()
+	{
+		setMode(m_saved);
+	}
+
+	// False where the FPU mode is left alone and only the software flush applies
+	static constexpr bool isSupported() { return FLUSH_BITS != 0; }
+
+private:
+#if defined(_M_X64) || defined(__x86_64__)
+	typedef unsigned int Mode;
+	// MXCSR flush-to-zero and denormals-are-zero
+	static const Mode FLUSH_BITS = 0x8040;
+
+	static Mode getMode() { return _mm_getcsr(); }
+	static void setMode(Mode mode) { _mm_setcsr(mode); }
+#elif defined(__aarch64__)
+	typedef unsigned long long Mode;
+	// FPCR.FZ, also flushes subnormal inputs
+	static const Mode FLUSH_BITS = 1ull << 24;
+
+	static Mode getMode()
+	{
+		Mode mode;
+		asm volatile("mrs %0, fpcr" : "=r"(mode));
+		return mode;
+	}
+	static void setMode(Mode mode) { asm volatile("msr fpcr, %0" : : "r"(mode)); }
+#elif defined(_M_ARM64)
+	typedef unsigned long long Mode;
+	static const Mode FLUSH_BITS = 1ull << 24;
+
+	static Mode getMode() { return (Mode)_ReadStatusReg(ARM64_FPCR); }
+	static void setMode(Mode mode) { _WriteStatusReg(ARM64_FPCR, (__int64)mode); }
+#else
+	typedef unsigned int Mode;
+	static const Mode FLUSH_BITS = 0;
+
+	static Mode getMode() { return 0; }
+	static void setMode(Mode) {}
+#endif
+
+	const Mode m_saved;
+
+	DenormalGuard(const DenormalGuard&) = delete;
+	DenormalGuard& operator=(const DenormalGuard&) = delete;
+};
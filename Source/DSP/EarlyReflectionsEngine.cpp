@@ -0,0 +1,826 @@
+/*
+  ==============================================================================
+
+    Complete early reflections processing without any plugin or GUI code.
+
+  ==============================================================================
+*/
+
+#include "EarlyReflectionsEngine.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#include "Denormals.h"
+
+//==============================================================================
+// Eight independent maxima, a single running maximum is a serial dependency
+// the compiler may not vectorize without fast math
+static float getPeak(const float* samples, int count)
+{
+	float lanes[8] = {};
+	int sample = 0;
+
+	for (; sample + 8 <= count; sample += 8)
+		for (int lane = 0; lane < 8; lane++)
+		{
+			const float magnitude = std::abs(samples[sample + lane]);
+			lanes[lane] = magnitude > lanes[lane] ? magnitude : lanes[lane];
+		}
+
+	float peak = 0.0f;
+	for (; sample < count; sample++)
+		peak = std::max(peak, std::abs(samples[sample]));
+
+	for (float lane : lanes)
+		peak = std::max(peak, lane);
+
+	return peak;
+}
+
+//==============================================================================
+EarlyReflectionsEngine::EarlyReflectionsEngine()
+	: m_tapFactors(MultiTapDelay::MAX_TAPS),
+	  m_tapGains(MultiTapDelay::MAX_TAPS),
+	  m_tapDelays(MultiTapDelay::MAX_TAPS),
+	  m_tapGroups(MultiTapDelay::MAX_TAPS),
+	  m_configFactors(MultiTapDelay::MAX_TAPS),
+	  m_configGains(MultiTapDelay::MAX_TAPS),
+	  m_configGroups(MultiTapDelay::MAX_TAPS),
+	  m_tapWeight(MultiTapDelay::MAX_TAPS),
+	  m_tapTarget(MultiTapDelay::MAX_TAPS),
+	  m_layoutIndex(MultiTapDelay::MAX_TAPS)
+{
+	// Every engine and instance holds the same default room
+	m_customTaps = RoomGeometryGenerator::getShared(RoomGeometry());
+}
+
+void EarlyReflectionsEngine::prepare(double sampleRate, int maxBlockSize, int numChannels)
+{
+	numChannels = std::max(1, std::min(numChannels, (int)MAX_CHANNELS));
+	maxBlockSize = std::max(1, maxBlockSize);
+
+	const int rateFactor = m_wetRate == WetRate::Reduced ? PolyphaseFilter::getFactor(sampleRate, MIN_REDUCED_RATE) : 1;
+
+	// The interleaved delay has no resampling and keeps float frames, reduced
+	// rate and compact storage run planar
+	const DelayStorage storage = m_storage;
+	const bool interleaved = m_layout == EngineLayout::Interleaved && numChannels == 2 && rateFactor == 1
+		&& storage == DelayStorage::Float;
+
+	m_configApplied = false;
+	m_fading = false;
+	m_fadeIncrement = (float)(1.0 / (FADE_SECONDS * sampleRate));
+
+	if (m_prepared && sampleRate == m_sampleRate && maxBlockSize == m_blockSize && numChannels == m_numChannels
+		&& interleaved == m_interleaved && rateFactor == m_rateFactor && storage == m_preparedStorage)
+	{
+		reset();
+		return;
+	}
+
+	m_sampleRate = sampleRate;
+	m_blockSize = maxBlockSize;
+	m_numChannels = numChannels;
+	m_interleaved = interleaved;
+	m_rateFactor = rateFactor;
+	m_preparedStorage = storage;
+
+	// Delay lines, tap delays and convolution all run at the wet rate
+	const double wetSampleRate = sampleRate / rateFactor;
+	const int wetBlockSize = (maxBlockSize + rateFactor - 1) / rateFactor;
+	m_wetBlockSize = wetBlockSize;
+	m_delayScale = MINIMUM_BUFFER_SIZE + int(ReflectionModes::TIME_MAX * ROOM_SIZE_MAX * wetSampleRate);
+
+	// Storage grows with the channel count, every ring is long enough for the
+	// most decorrelated tap of its channel
+	std::vector<int> ringScales(numChannels);
+	size_t required = numChannels * DelayArena::roundUp(maxBlockSize);
+
+	if (rateFactor > 1)
+	{
+		required += PolyphaseFilter::getRequiredStorage(rateFactor);
+		required += numChannels * (PolyphaseDecimator::getRequiredStorage(rateFactor, maxBlockSize)
+								   + PolyphaseInterpolator::getRequiredStorage(rateFactor, maxBlockSize)
+								   + 2 * DelayArena::roundUp(wetBlockSize));
+	}
+
+	for (int channel = 0; channel < numChannels; channel++)
+	{
+		const float decorrelation = channel < 2 ? TapLayout::getDecorrelation(channel, 0) : TapLayout::DECORRELATION_MAX;
+		ringScales[channel] = m_delayScale + (int)std::ceil(decorrelation * TapLayout::DECORRELATION_SAMPLES);
+
+		if (!interleaved)
+			required += MultiTapDelay::getRequiredStorage(ringScales[channel], wetBlockSize, MultiTapDelay::MAX_TAPS, storage);
+	}
+
+	// Partitions cover the longest tap of the most decorrelated channel
+	const int longestRing = *std::max_element(ringScales.begin(), ringScales.end());
+
+	// The first ring is read by the taps of every channel while they share it
+	if (!interleaved && rateFactor == 1 && numChannels > 1)
+	{
+		required += MultiTapDelay::getRequiredStorage(longestRing, wetBlockSize, MultiTapDelay::MAX_TAPS, storage)
+				  - MultiTapDelay::getRequiredStorage(ringScales[0], wetBlockSize, MultiTapDelay::MAX_TAPS, storage);
+		ringScales[0] = longestRing;
+	}
+
+	m_sharedRingSize = MultiTapDelay::getRingSize(longestRing, wetBlockSize, storage);
+
+	if (interleaved)
+		required += InterleavedMultiTapDelay<2>::getRequiredStorage(ringScales.data(), maxBlockSize);
+	const int longestDelay = CircularBuffer::sizeForDelayScale(longestRing) - 1;
+
+	m_convolutionAvailable = !interleaved && Fft::isPowerOfTwo(wetBlockSize)
+		&& wetBlockSize >= MIN_PARTITION_SIZE && wetBlockSize <= MAX_PARTITION_SIZE
+		&& 2 * wetBlockSize <= longestDelay;
+	m_partitions = m_convolutionAvailable ? longestDelay / wetBlockSize + 1 : 0;
+
+	if (m_convolutionAvailable)
+		required += numChannels * PartitionedConvolver::getRequiredStorage(wetBlockSize, m_partitions);
+
+	m_arena.prepare(required);
+	m_delayLine.assign(interleaved ? 0 : numChannels, MultiTapDelay());
+	m_convolver.assign(m_convolutionAvailable ? numChannels : 0, PartitionedConvolver());
+	m_wetBuffer.assign(numChannels, nullptr);
+
+	if (interleaved)
+		m_interleavedDelay.init(m_arena, ringScales.data(), maxBlockSize);
+	else
+	{
+		for (int channel = 0; channel < numChannels; channel++)
+			m_delayLine[channel].init(m_arena, ringScales[channel], wetBlockSize, MultiTapDelay::MAX_TAPS, storage);
+	}
+
+	// The resampling filters delay the wet signal, the taps are shortened by
+	// the same amount in wet rate samples
+	m_decimator.assign(rateFactor > 1 ? numChannels : 0, PolyphaseDecimator());
+	m_interpolator.assign(rateFactor > 1 ? numChannels : 0, PolyphaseInterpolator());
+	m_reducedInput.assign(rateFactor > 1 ? numChannels : 0, nullptr);
+	m_reducedOutput.assign(rateFactor > 1 ? numChannels : 0, nullptr);
+	m_tapOffset = 0;
+
+	if (rateFactor > 1)
+	{
+		m_rateFilter.init(m_arena, rateFactor);
+		m_tapOffset = m_rateFilter.getLatency();
+
+		for (int channel = 0; channel < numChannels; channel++)
+		{
+			m_decimator[channel].init(m_arena, m_rateFilter, maxBlockSize);
+			m_interpolator[channel].init(m_arena, m_rateFilter, maxBlockSize);
+			m_reducedInput[channel] = m_arena.allocate(wetBlockSize);
+			m_reducedOutput[channel] = m_arena.allocate(wetBlockSize);
+		}
+	}
+
+	if (m_convolutionAvailable)
+	{
+		m_fft = Fft::getShared(2 * wetBlockSize);
+		m_segmentUsed.assign((size_t)m_partitions * MultiTapDelay::MAX_DAMPING_GROUPS, 0);
+
+		std::vector<int> maxDelays(numChannels);
+
+		for (int channel = 0; channel < numChannels; channel++)
+		{
+			m_convolver[channel].init(m_arena, *m_fft, wetBlockSize, m_partitions);
+			m_delayLine[channel].setConvolver(&m_convolver[channel]);
+			maxDelays[channel] = m_delayLine[channel].getMaxDelay();
+		}
+
+		m_irRenderer.prepare(wetBlockSize, m_delayScale, m_tapOffset, maxDelays);
+	}
+
+	m_convolutionWanted = false;
+	m_irRequestPending = false;
+	m_sharedHistory = false;
+	m_identicalSamples = 0;
+	m_silentSamples = 0;
+	m_idle = false;
+
+	for (int channel = 0; channel < numChannels; channel++)
+		m_wetBuffer[channel] = m_arena.allocate(maxBlockSize);
+
+	m_prepared = true;
+}
+
+void EarlyReflectionsEngine::release()
+{
+	m_arena.release();
+	m_delayLine.clear();
+	m_convolver.clear();
+	m_decimator.clear();
+	m_interpolator.clear();
+	m_reducedInput.clear();
+	m_reducedOutput.clear();
+	m_rateFactor = 1;
+	m_convolutionAvailable = false;
+	m_convolutionWanted = false;
+	m_wetBuffer.clear();
+	m_prepared = false;
+}
+
+void EarlyReflectionsEngine::reset()
+{
+	if (!m_prepared)
+		return;
+
+	if (m_interleaved)
+		m_interleavedDelay.clear();
+
+	for (auto& delayLine : m_delayLine)
+		delayLine.clear();
+
+	for (auto& convolver : m_convolver)
+		convolver.invalidate();
+
+	for (auto& decimator : m_decimator)
+		decimator.clear();
+
+	for (auto& interpolator : m_interpolator)
+		interpolator.clear();
+
+	// Nothing left to click, the taps take their targets at once
+	if (m_fading)
+		finishFade();
+
+	m_sharedHistory = false;
+	m_identicalSamples = 0;
+	m_silentSamples = 0;
+	m_idle = false;
+}
+
+void EarlyReflectionsEngine::setParameters(const EngineParameters& parameters)
+{
+	setConfig(m_configBuilder.update(parameters, *m_customTaps));
+}
+
+void EarlyReflectionsEngine::setConfig(const EngineConfig& config)
+{
+	// What changed, before applying it updates the members compared against
+	const bool tapsChanged = !m_configApplied || config.tapsVersion != m_tapsVersion;
+	const bool resonanceChanged = !m_configApplied || config.resonance != m_resonance;
+	const bool volumeChanged = !m_configApplied || config.volume != m_volume;
+
+	if (tapsChanged)
+		applyTaps(config);
+	else if (config.pruneVersion != m_pruneVersion)
+		applyPruning(config);
+
+	if (!m_configApplied || config.dampingVersion != m_dampingVersion)
+		applyDamping(config);
+
+	if (resonanceChanged)
+	{
+		for (auto& delayLine : m_delayLine)
+			delayLine.setFeedback(config.resonance);
+
+		m_interleavedDelay.setFeedback(config.resonance);
+		m_resonance = config.resonance;
+	}
+
+	if (tapsChanged || resonanceChanged || volumeChanged)
+		m_tailLength = getTailLength(config);
+
+	m_mix = config.mix;
+	m_volume = config.volume;
+	m_mode = config.parameters.mode;
+	m_configApplied = true;
+}
+
+double EarlyReflectionsEngine::getTailLength(const EngineConfig& config)
+{
+	float maxFactor = 0.0f;
+	float gainSum = 0.0f;
+
+	for (int i = 0; i < config.tapCount; i++)
+	{
+		maxFactor = std::max(maxFactor, config.tapFactors[i]);
+		gainSum += std::abs(config.tapGains[i]);
+	}
+
+	const double longestTap = maxFactor * ReflectionModes::TIME_MAX * ROOM_SIZE_MAX + TAIL_MARGIN;
+	const float resonance = config.resonance;
+
+	if (resonance <= 0.0f)
+		return longestTap;
+
+	if (resonance >= 1.0f)
+		return std::numeric_limits<double>::infinity();
+
+	// Every resonant tap is a comb through a unity gain low pass, so each
+	// line decays by at least the resonance every longest tap. The output can
+	// exceed a line by the tap gains and the volume.
+	const double peak = std::max(1.0f, gainSum) * std::max(1.0f, config.volume) / (1.0 - resonance);
+	const double passes = std::ceil(std::log(SILENCE_LEVEL / peak) / std::log((double)resonance));
+
+	return longestTap * (1.0 + passes);
+}
+
+void EarlyReflectionsEngine::setCustomTaps(std::shared_ptr<const TapSet> taps)
+{
+	if (taps != nullptr)
+		m_customTaps = std::move(taps);
+}
+
+void EarlyReflectionsEngine::process(float* const* channels, int numChannels, int numSamples, WorkerPool* pool)
+{
+	if (!m_prepared)
+		return;
+
+	// Hosts do not all set flush-to-zero, the delay lines flush their states
+	// but subnormal input and the decay within a block still pass through
+	const DenormalGuard denormalGuard;
+
+	numChannels = std::min(numChannels, m_numChannels);
+
+	updateIdle(channels, numChannels, numSamples);
+
+	if (m_idle)
+	{
+		processIdle(channels, numChannels, numSamples);
+		return;
+	}
+
+	if (!m_fading)
+	{
+		processActive(channels, numChannels, numSamples, pool);
+		return;
+	}
+
+	// Fading taps get new gains every FADE_STEP samples
+	float* chunk[MAX_CHANNELS];
+
+	for (int offset = 0; offset < numSamples; offset += FADE_STEP)
+	{
+		const int count = std::min((int)FADE_STEP, numSamples - offset);
+
+		for (int channel = 0; channel < numChannels; ++channel)
+			chunk[channel] = channels[channel] + offset;
+
+		if (m_fading)
+			stepFade(count);
+
+		processActive(chunk, numChannels, count, pool);
+	}
+}
+
+void EarlyReflectionsEngine::processActive(float* const* channels, int numChannels, int numSamples, WorkerPool* pool)
+{
+	if (m_interleaved && numChannels == 2)
+	{
+		processInterleaved(channels, numSamples);
+		return;
+	}
+
+	beginConvolutionBlock();
+
+	if (m_historySharing && m_rateFactor == 1 && numChannels > 1)
+		updateSharedHistory(channels, numChannels, numSamples);
+
+	if (m_sharedHistory)
+	{
+		processShared(channels, numChannels, numSamples);
+		endConvolutionBlock();
+		return;
+	}
+
+	if (pool == nullptr || pool->getNumThreads() < 2 || numChannels < 2)
+	{
+		processChannels(channels, 0, numChannels, numSamples);
+		endConvolutionBlock();
+		return;
+	}
+
+	// Channels are independent, split them into one group per worker
+	const int groups = std::min(numChannels, pool->getNumThreads());
+	const int groupSize = (numChannels + groups - 1) / groups;
+
+	for (int first = 0; first < numChannels; first += groupSize)
+	{
+		const int last = std::min(first + groupSize, numChannels);
+		pool->submit([this, channels, first, last, numSamples]
+		{
+			// Workers have their own FPU mode
+			const DenormalGuard denormalGuard;
+			processChannels(channels, first, last, numSamples);
+		});
+	}
+
+	pool->wait();
+	endConvolutionBlock();
+}
+
+void EarlyReflectionsEngine::beginConvolutionBlock()
+{
+	if (!m_convolutionWanted)
+		return;
+
+	// A request that found the renderer busy is posted again
+	if (m_irRequestPending)
+		m_irRequestPending = !m_irRenderer.request(m_tapFactors.data(), m_tapGains.data(), m_tapGroups.data(),
+													m_tapCount, m_irVersion, m_layoutIndex.data());
+
+	// Until the IR of the current taps arrives the direct taps play
+	const RenderedIR* rendered = m_irRenderer.acquire();
+	const ConvolutionIR* ir = rendered != nullptr && rendered->version == m_irVersion ? rendered->ir.get() : nullptr;
+
+	for (int channel = 0; channel < (int)m_delayLine.size(); channel++)
+		m_delayLine[channel].setImpulseResponse(ir, channel);
+}
+
+void EarlyReflectionsEngine::endConvolutionBlock()
+{
+	if (!m_convolutionWanted)
+		return;
+
+	for (auto& delayLine : m_delayLine)
+		delayLine.setImpulseResponse(nullptr, 0);
+
+	m_irRenderer.release();
+}
+
+void EarlyReflectionsEngine::updateConvolution(int tapCount, int groupCount)
+{
+	bool wanted = false;
+
+	if (m_convolutionAvailable && m_convolutionMode != ConvolutionMode::Off && tapCount > 0)
+	{
+		// Segments of the first channel, the others only differ by decorrelation
+		const int blockSize = m_wetBlockSize;
+		std::fill(m_segmentUsed.begin(), m_segmentUsed.end(), 0);
+		int segments = 0;
+
+		for (int i = 0; i < tapCount; i++)
+		{
+			const int delay = std::min(std::max(m_tapDelays[i], 1), m_delayLine[0].getMaxDelay());
+			const size_t index = (size_t)(delay / blockSize) * MultiTapDelay::MAX_DAMPING_GROUPS + m_tapGroups[i];
+
+			if (m_segmentUsed[index] == 0)
+			{
+				m_segmentUsed[index] = 1;
+				segments++;
+			}
+		}
+
+		const double convolutionCost = PartitionedConvolver::estimateCost(blockSize, groupCount, segments);
+		const double directCost = (double)tapCount * blockSize;
+
+		wanted = m_convolutionMode == ConvolutionMode::Always || convolutionCost < directCost;
+	}
+
+	if (wanted)
+	{
+		m_irVersion++;
+		m_irRequestPending = true;
+	}
+
+	if (wanted != m_convolutionWanted)
+	{
+		for (auto& convolver : m_convolver)
+			convolver.setEnabled(wanted);
+
+		m_convolutionWanted = wanted;
+	}
+}
+
+void EarlyReflectionsEngine::processChannels(float* const* channels, int firstChannel, int lastChannel, int numSamples)
+{
+	const float mix = m_mix;
+	const float mixInverse = 1.0f - mix;
+	const float volume = m_volume;
+	const int blockSize = m_blockSize;
+
+	for (int channel = firstChannel; channel < lastChannel; ++channel)
+	{
+		float* channelBuffer = channels[channel];
+		float* wet = m_wetBuffer[channel];
+
+		for (int offset = 0; offset < numSamples; offset += blockSize)
+		{
+			const int count = std::min(blockSize, numSamples - offset);
+			float* dry = channelBuffer + offset;
+
+			if (m_rateFactor > 1)
+			{
+				float* reducedInput = m_reducedInput[channel];
+				float* reducedOutput = m_reducedOutput[channel];
+
+				const int reducedCount = m_decimator[channel].process(dry, count, reducedInput);
+				m_delayLine[channel].processBlock(reducedInput, reducedOutput, reducedCount);
+				m_interpolator[channel].process(reducedOutput, wet, count);
+			}
+			else
+				m_delayLine[channel].processBlock(dry, wet, count);
+
+			for (int sample = 0; sample < count; ++sample)
+			{
+				dry[sample] = volume * (mix * wet[sample] + mixInverse * dry[sample]);
+			}
+		}
+	}
+}
+
+void EarlyReflectionsEngine::updateIdle(float* const* channels, int numChannels, int numSamples)
+{
+	float peak = 0.0f;
+
+	for (int channel = 0; channel < numChannels; ++channel)
+		peak = std::max(peak, getPeak(channels[channel], numSamples));
+
+	if (peak > SILENCE_LEVEL)
+	{
+		// The delay lines were cleared when they went idle, so processing the
+		// whole block from silence resumes on the exact sample
+		m_silentSamples = 0;
+		m_idle = false;
+		return;
+	}
+
+	if (m_idle)
+		return;
+
+	m_silentSamples += numSamples;
+
+	// Once the input has been silent for the whole tail, the wet output of the
+	// previous block confirms the delay lines have decayed
+	if (m_silentSamples < m_tailLength * m_sampleRate)
+		return;
+
+	for (int channel = 0; channel < numChannels; ++channel)
+	{
+		const float* wet = m_wetBuffer[channel];
+
+		for (int sample = 0; sample < std::min(numSamples, m_blockSize); ++sample)
+			if (std::abs(wet[sample]) > SILENCE_LEVEL)
+				return;
+	}
+
+	reset();
+	m_idle = true;
+}
+
+void EarlyReflectionsEngine::processIdle(float* const* channels, int numChannels, int numSamples)
+{
+	// Silent input, only the dry part of the mix is left
+	const float gain = m_volume * (1.0f - m_mix);
+
+	for (int channel = 0; channel < numChannels; ++channel)
+	{
+		float* buffer = channels[channel];
+
+		for (int sample = 0; sample < numSamples; ++sample)
+			buffer[sample] *= gain;
+	}
+}
+
+void EarlyReflectionsEngine::updateSharedHistory(float* const* channels, int numChannels, int numSamples)
+{
+	bool identical = m_resonance == 0.0f;
+
+	for (int channel = 1; channel < numChannels && identical; ++channel)
+		identical = std::memcmp(channels[channel], channels[0], numSamples * sizeof(float)) == 0;
+
+	if (!identical)
+	{
+		// Every channel continues from the shared history on its own ring
+		if (m_sharedHistory)
+		{
+			for (int channel = 1; channel < (int)m_delayLine.size(); ++channel)
+				m_delayLine[channel].copyHistory(m_delayLine[0]);
+		}
+
+		m_sharedHistory = false;
+		m_identicalSamples = 0;
+		return;
+	}
+
+	// Sharing starts once identical input has filled every ring, so the
+	// history it continues from is exactly the one each channel had
+	if (m_identicalSamples >= m_sharedRingSize)
+		m_sharedHistory = true;
+	else
+		m_identicalSamples += numSamples;
+}
+
+void EarlyReflectionsEngine::processShared(float* const* channels, int numChannels, int numSamples)
+{
+	const float mix = m_mix;
+	const float mixInverse = 1.0f - mix;
+	const float volume = m_volume;
+	const int blockSize = m_blockSize;
+
+	for (int offset = 0; offset < numSamples; offset += blockSize)
+	{
+		const int count = std::min(blockSize, numSamples - offset);
+
+		// Only the first channel writes its ring, the others read their taps
+		// from it
+		m_delayLine[0].processBlock(channels[0] + offset, m_wetBuffer[0], count);
+
+		for (int channel = 1; channel < numChannels; ++channel)
+			m_delayLine[channel].processBlockShared(m_delayLine[0], m_wetBuffer[channel], count);
+
+		for (int channel = 0; channel < numChannels; ++channel)
+		{
+			float* dry = channels[channel] + offset;
+			const float* wet = m_wetBuffer[channel];
+
+			for (int sample = 0; sample < count; ++sample)
+			{
+				dry[sample] = volume * (mix * wet[sample] + mixInverse * dry[sample]);
+			}
+		}
+	}
+}
+
+void EarlyReflectionsEngine::processInterleaved(float* const* channels, int numSamples)
+{
+	const float mix = m_mix;
+	const float mixInverse = 1.0f - mix;
+	const float volume = m_volume;
+	const int blockSize = m_blockSize;
+
+	for (int offset = 0; offset < numSamples; offset += blockSize)
+	{
+		const int count = std::min(blockSize, numSamples - offset);
+		float* dry[2] = { channels[0] + offset, channels[1] + offset };
+
+		m_interleavedDelay.processBlock(dry, m_wetBuffer.data(), count);
+
+		for (int channel = 0; channel < 2; ++channel)
+		{
+			const float* wet = m_wetBuffer[channel];
+
+			for (int sample = 0; sample < count; ++sample)
+			{
+				dry[channel][sample] = volume * (mix * wet[sample] + mixInverse * dry[channel][sample]);
+			}
+		}
+	}
+}
+
+float EarlyReflectionsEngine::getWetDamping(float a0) const
+{
+	// The one-pole pole p = 1 - a0 applies once per sample, at a reduced
+	// rate p^factor keeps the same time constant and so the same tone
+	if (m_rateFactor == 1)
+		return a0;
+
+	return 1.0f - std::pow(1.0f - a0, (float)m_rateFactor);
+}
+
+void EarlyReflectionsEngine::applyTaps(const EngineConfig& config)
+{
+	const int count = config.tapCount;
+
+	std::copy(config.tapFactors, config.tapFactors + count, m_configFactors.begin());
+	std::copy(config.tapGains, config.tapGains + count, m_configGains.begin());
+	std::copy(config.tapGroups, config.tapGroups + count, m_configGroups.begin());
+
+	// A new table replaces the old one at once, only the kept taps go in
+	for (int i = 0; i < count; i++)
+	{
+		m_tapTarget[i] = config.tapActive[i] != 0 ? 1.0f : 0.0f;
+		m_tapWeight[i] = m_tapTarget[i];
+	}
+
+	m_configTapCount = count;
+	m_groupCount = config.groupCount;
+	m_fading = false;
+
+	layoutTaps();
+
+	m_tapsVersion = config.tapsVersion;
+	m_pruneVersion = config.pruneVersion;
+}
+
+void EarlyReflectionsEngine::applyPruning(const EngineConfig& config)
+{
+	// Same table, other taps kept. The delay lines take the union of the old
+	// and the new taps until the fade is done.
+	for (int i = 0; i < m_configTapCount; i++)
+	{
+		m_tapTarget[i] = config.tapActive[i] != 0 ? 1.0f : 0.0f;
+
+		if (m_tapTarget[i] != m_tapWeight[i])
+			m_fading = true;
+	}
+
+	if (m_fading)
+		layoutTaps();
+
+	m_pruneVersion = config.pruneVersion;
+}
+
+void EarlyReflectionsEngine::layoutTaps()
+{
+	float* tapFactors = m_tapFactors.data();
+	float* tapGains = m_tapGains.data();
+	int* tapDelays = m_tapDelays.data();
+	int* tapGroups = m_tapGroups.data();
+	int* layoutIndex = m_layoutIndex.data();
+
+	// Kept for impulse response requests that have to be posted again
+	int count = 0;
+
+	for (int i = 0; i < m_configTapCount; i++)
+	{
+		if (m_tapWeight[i] <= 0.0f && m_tapTarget[i] <= 0.0f)
+			continue;
+
+		tapFactors[count] = m_configFactors[i];
+		tapGains[count] = m_configGains[i] * m_tapWeight[i];
+		tapGroups[count] = m_configGroups[i];
+		layoutIndex[count] = i;
+		count++;
+	}
+
+	// Per channel tap delays, decorrelated against the first channel,
+	// which is computed last so its delays stay in the scratch. The
+	// decorrelation follows the tap number in the whole table.
+	for (int channel = (int)m_delayLine.size() - 1; channel >= 0; channel--)
+	{
+		for (int i = 0; i < count; i++)
+			tapDelays[i] = TapLayout::getTapDelay(m_delayScale, channel, layoutIndex[i], tapFactors[i]) - m_tapOffset;
+
+		m_delayLine[channel].setTapDelays(tapDelays, tapGains, count, tapGroups);
+	}
+
+	m_interleavedDelay.setTaps(tapFactors, tapGains, count, tapGroups);
+
+	m_tapCount = count;
+
+	// The direct taps play the fade, an impulse response of the final set is
+	// requested once it is done
+	if (m_fading)
+	{
+		m_irVersion++;
+		m_irRequestPending = false;
+	}
+	else
+		updateConvolution(count, m_groupCount);
+}
+
+void EarlyReflectionsEngine::stepFade(int numSamples)
+{
+	const float step = m_fadeIncrement * numSamples;
+	bool done = true;
+
+	for (int i = 0; i < m_tapCount; i++)
+	{
+		const int tap = m_layoutIndex[i];
+		const float target = m_tapTarget[tap];
+		float weight = m_tapWeight[tap];
+
+		weight = target > weight ? std::min(target, weight + step) : std::max(target, weight - step);
+		done = done && weight == target;
+
+		m_tapWeight[tap] = weight;
+		m_tapGains[i] = m_configGains[tap] * weight;
+	}
+
+	for (auto& delayLine : m_delayLine)
+		delayLine.setTapGains(m_tapGains.data());
+
+	m_interleavedDelay.setTapGains(m_tapGains.data());
+
+	// The taps that faded out leave the delay lines
+	if (done)
+	{
+		m_fading = false;
+		layoutTaps();
+	}
+}
+
+void EarlyReflectionsEngine::finishFade()
+{
+	std::copy(m_tapTarget.begin(), m_tapTarget.begin() + m_configTapCount, m_tapWeight.begin());
+	m_fading = false;
+	layoutTaps();
+}
+
+void EarlyReflectionsEngine::applyDamping(const EngineConfig& config)
+{
+	// The base damping covers resonance and every group
+	const float a0 = getWetDamping(config.groupDamping[0]);
+
+	for (auto& delayLine : m_delayLine)
+		delayLine.setDamping(a0);
+
+	m_interleavedDelay.setDamping(a0);
+
+	for (int group = 1; group < config.groupCount; group++)
+	{
+		const float groupA0 = getWetDamping(config.groupDamping[group]);
+
+		for (auto& delayLine : m_delayLine)
+			delayLine.setGroupDamping(group, groupA0);
+
+		m_interleavedDelay.setGroupDamping(group, groupA0);
+	}
+
+	m_dampingVersion = config.dampingVersion;
+}
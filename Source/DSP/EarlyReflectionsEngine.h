@@ -0,0 +1,234 @@
+/*
+  ==============================================================================
+
+    Complete early reflections processing without any plugin or GUI code.
+    The plugin processor and the offline tools both drive this class, so
+    they run exactly the same algorithm.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "DelayArena.h"
+#include "EngineConfig.h"
+#include "Fft.h"
+#include "ImpulseResponseRenderer.h"
+#include "InterleavedMultiTapDelay.h"
+#include "MultiTapDelay.h"
+#include "PartitionedConvolver.h"
+#include "PolyphaseResampler.h"
+#include "ReflectionModes.h"
+#include "RoomGeometry.h"
+#include "TapLayout.h"
+#include "WorkerPool.h"
+
+//==============================================================================
+// Planar keeps one ring per channel, Interleaved keeps stereo frames in one
+// ring and processes both channels together. Mono always runs planar.
+enum class EngineLayout
+{
+	Planar,
+	Interleaved
+};
+
+// Without resonance the wet path is a fixed sparse FIR. Automatic moves
+// dense tap tables to FFT convolution when it is cheaper than direct taps,
+// Off and Always force one path where convolution is possible at all.
+enum class ConvolutionMode
+{
+	Automatic,
+	Off,
+	Always
+};
+
+// Reduced runs the reflections at the highest power of two fraction of the
+// sample rate that stays at MIN_REDUCED_RATE or above, e.g. 48 kHz at 96
+// and 192 kHz, and resamples the wet signal around them. Full below 88.2 kHz.
+enum class WetRate
+{
+	Full,
+	Reduced
+};
+
+//==============================================================================
+class EarlyReflectionsEngine
+{
+public:
+	EarlyReflectionsEngine();
+
+	// Third order ambisonics needs 16, 9.1.6 needs 16, leave headroom
+	static const int MAX_CHANNELS = 64;
+	static const int MINIMUM_BUFFER_SIZE = 10;
+	static const int ROOM_SIZE_MAX = 2;
+
+	// Convolution partitions are the block size, so it needs power of two
+	// blocks in this range and the planar layout
+	static const int MIN_PARTITION_SIZE = 32;
+	static const int MAX_PARTITION_SIZE = 4096;
+
+	static constexpr double MIN_REDUCED_RATE = 44100.0;
+
+	// -120 dBFS. Input below it counts as silence, and once the tail has
+	// decayed below it the delay lines are skipped until signal returns.
+	static constexpr float SILENCE_LEVEL = 1.0e-6f;
+	// Decorrelation, ring slack and resampler ringing beyond the last tap
+	static constexpr double TAIL_MARGIN = 0.005;
+	// Taps the level of detail adds or drops fade over this time, with the
+	// gains updated every FADE_STEP samples
+	static constexpr double FADE_SECONDS = 0.02;
+	static const int FADE_STEP = 64;
+
+	// Takes effect on the next prepare()
+	void setLayout(EngineLayout layout) { m_layout = layout; }
+	void setWetRate(WetRate rate) { m_wetRate = rate; }
+	void setConvolutionMode(ConvolutionMode mode) { m_convolutionMode = mode; }
+	// Identical channels share one history by default, tools can turn it off
+	void setHistorySharing(bool enabled) { m_historySharing = enabled; }
+	// Takes effect on the next prepare(). Compact storage halves the delay
+	// memory and runs the planar layout.
+	void setDelayStorage(DelayStorage storage) { m_storage = storage; }
+
+	void prepare(double sampleRate, int maxBlockSize, int numChannels);
+	void release();
+	void reset();
+	// Derives the configuration on the calling thread, for the tools
+	void setParameters(const EngineParameters& parameters);
+	// Real time safe. Only the parts whose version changed since the last
+	// call reach the delay lines.
+	void setConfig(const EngineConfig& config);
+	// Tap set of the Custom mode, the shared default room until the first
+	// call. Not on the audio thread, it may drop the last reference.
+	void setCustomTaps(std::shared_ptr<const TapSet> taps);
+	// With a pool, channel groups are processed in parallel. Offline only,
+	// the pool allocates and blocks.
+	void process(float* const* channels, int numChannels, int numSamples, WorkerPool* pool = nullptr);
+
+	// Seconds until the output of a full scale input has decayed below
+	// SILENCE_LEVEL, infinite at full resonance
+	static double getTailLength(const EngineConfig& config);
+	double getTailLength() const { return m_tailLength; }
+	// True while silent input skips the delay lines
+	bool isIdle() const { return m_idle; }
+	// Taps in the delay lines and mode of the current configuration, fading
+	// taps count as active
+	int getActiveTapCount() const { return m_tapCount; }
+	// True while taps fade in or out after a level of detail change
+	bool isFading() const { return m_fading; }
+	ReflectionMode getMode() const { return m_mode; }
+	// True while identical input lets every channel read the first ring
+	bool isHistoryShared() const { return m_sharedHistory; }
+
+	// Sample rate divisor of the wet path, 1 at full rate
+	int getWetRateFactor() const { return m_rateFactor; }
+	// Delay lines and scratch in bytes
+	size_t getMemoryUsage() const { return m_arena.getUsed() * sizeof(float); }
+
+private:
+	void applyTaps(const EngineConfig& config);
+	void applyPruning(const EngineConfig& config);
+	void applyDamping(const EngineConfig& config);
+	void layoutTaps();
+	void stepFade(int numSamples);
+	void finishFade();
+	void processActive(float* const* channels, int numChannels, int numSamples, WorkerPool* pool);
+	void processChannels(float* const* channels, int firstChannel, int lastChannel, int numSamples);
+	void processInterleaved(float* const* channels, int numSamples);
+	void processIdle(float* const* channels, int numChannels, int numSamples);
+	void processShared(float* const* channels, int numChannels, int numSamples);
+	void updateSharedHistory(float* const* channels, int numChannels, int numSamples);
+	void updateIdle(float* const* channels, int numChannels, int numSamples);
+	void updateConvolution(int tapCount, int groupCount);
+	float getWetDamping(float a0) const;
+	void beginConvolutionBlock();
+	void endConvolutionBlock();
+
+	// All delay memory lives in the arena and is kept across prepare calls
+	DelayArena m_arena;
+	std::vector<MultiTapDelay> m_delayLine;
+	InterleavedMultiTapDelay<2> m_interleavedDelay;
+	std::vector<float*> m_wetBuffer;
+	int m_delayScale = 0;
+
+	// Reduced rate wet path, decimated input and delay line output per channel
+	WetRate m_wetRate = WetRate::Full;
+	int m_rateFactor = 1;
+	int m_wetBlockSize = 0;
+	int m_tapOffset = 0;
+	PolyphaseFilter m_rateFilter;
+	std::vector<PolyphaseDecimator> m_decimator;
+	std::vector<PolyphaseInterpolator> m_interpolator;
+	std::vector<float*> m_reducedInput;
+	std::vector<float*> m_reducedOutput;
+
+	EngineLayout m_layout = EngineLayout::Planar;
+	bool m_interleaved = false;
+	DelayStorage m_storage = DelayStorage::Float;
+	DelayStorage m_preparedStorage = DelayStorage::Float;
+	double m_sampleRate = 0.0;
+	int m_blockSize = 0;
+	int m_numChannels = 0;
+	bool m_prepared = false;
+
+	float m_mix = 0.5f;
+	float m_volume = 1.0f;
+
+	std::shared_ptr<const TapSet> m_customTaps;
+	EngineConfigBuilder m_configBuilder;
+
+	// FFT convolution of dense tap tables, one convolver per planar channel
+	std::shared_ptr<const Fft> m_fft;
+	std::vector<PartitionedConvolver> m_convolver;
+	ImpulseResponseRenderer m_irRenderer;
+	ConvolutionMode m_convolutionMode = ConvolutionMode::Automatic;
+	bool m_convolutionAvailable = false;
+	bool m_convolutionWanted = false;
+	bool m_irRequestPending = false;
+	unsigned int m_irVersion = 0;
+	int m_partitions = 0;
+	std::vector<unsigned char> m_segmentUsed;
+
+	// Tap table scratch, sized once so parameter changes never allocate
+	std::vector<float> m_tapFactors;
+	std::vector<float> m_tapGains;
+	std::vector<int> m_tapDelays;
+	std::vector<int> m_tapGroups;
+
+	// Whole tap table of the configuration and the fade weight of every tap.
+	// The scratch above holds the taps with a weight or target above zero,
+	// m_layoutIndex maps them back.
+	std::vector<float> m_configFactors;
+	std::vector<float> m_configGains;
+	std::vector<int> m_configGroups;
+	std::vector<float> m_tapWeight;
+	std::vector<float> m_tapTarget;
+	std::vector<int> m_layoutIndex;
+	int m_configTapCount = 0;
+	int m_groupCount = 1;
+	bool m_fading = false;
+	float m_fadeIncrement = 0.0f;
+
+	// Versions of the configuration in the delay lines
+	unsigned int m_tapsVersion = 0;
+	unsigned int m_dampingVersion = 0;
+	unsigned int m_pruneVersion = 0;
+	float m_resonance = 0.0f;
+	ReflectionMode m_mode = ReflectionMode::Room;
+	bool m_configApplied = false;
+	int m_tapCount = 0;
+
+	// Identical input on every channel without resonance, the first ring
+	// holds the history of all of them once it has been filled that way
+	bool m_historySharing = true;
+	bool m_sharedHistory = false;
+	long long m_identicalSamples = 0;
+	int m_sharedRingSize = 0;
+
+	// Silence bypass
+	double m_tailLength = 0.0;
+	long long m_silentSamples = 0;
+	bool m_idle = false;
+};
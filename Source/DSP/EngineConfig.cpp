@@ -0,0 +1,162 @@
+/*
+  ==============================================================================
+
+    Everything the engine takes from the parameters, derived once.
+
+  ==============================================================================
+*/
+
+#include "EngineConfig.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "AbsorbtionTable.h"
+
+//==============================================================================
+EngineConfigBuilder::EngineConfigBuilder()
+{
+}
+
+const EngineConfig& EngineConfigBuilder::update(const EngineParameters& parameters, const TapSet& customTaps)
+{
+	EngineConfig& config = m_config;
+	const EngineParameters& last = config.parameters;
+
+	const unsigned int customVersion = parameters.mode == ReflectionMode::Custom ? customTaps.version : 0;
+	const bool modeChanged = !m_valid || parameters.mode != last.mode || customVersion != m_customVersion;
+	const bool tapsChanged = modeChanged || parameters.size != last.size || parameters.attenuation != last.attenuation;
+	const bool dampingChanged = modeChanged || parameters.absorbtion != last.absorbtion;
+
+	const ReflectionPattern pattern = parameters.mode == ReflectionMode::Custom
+		? ReflectionPattern { customTaps.times, customTaps.gains, customTaps.count, customTaps.volumeCompensation,
+							  customTaps.groups, customTaps.groupAbsorbtion, customTaps.groupCount }
+		: ReflectionModes::getPattern(parameters.mode);
+
+	if (tapsChanged)
+	{
+		const float size = 0.01f + 0.99f * parameters.size;
+		const float attenuationInverse = 1.0f - parameters.attenuation;
+		const int count = std::min(pattern.count, (int)MultiTapDelay::MAX_TAPS);
+
+		for (int i = 0; i < count; i++)
+		{
+			const float gain = pattern.gains[i];
+			config.tapGains[i] = pattern.volumeCompensation * (gain + (1.0f - gain) * attenuationInverse);
+			config.tapFactors[i] = size * pattern.times[i] / ReflectionModes::TIME_MAX;
+			config.tapGroups[i] = pattern.groups != nullptr ? std::min(std::max(pattern.groups[i], 0), MultiTapDelay::MAX_DAMPING_GROUPS - 1) : 0;
+		}
+
+		config.tapCount = count;
+		config.groupCount = std::min(std::max(pattern.groupCount, 1), (int)MultiTapDelay::MAX_DAMPING_GROUPS);
+		config.tapsVersion++;
+	}
+
+	if (dampingChanged)
+	{
+		const float a0 = AbsorbtionTable::lookup(parameters.absorbtion);
+		std::fill(config.groupDamping, config.groupDamping + MultiTapDelay::MAX_DAMPING_GROUPS, a0);
+
+		// Groups beyond the first add their own absorbtion
+		for (int group = 1; group < config.groupCount; group++)
+			config.groupDamping[group] = AbsorbtionTable::lookup(std::min(1.0f, parameters.absorbtion + pattern.groupAbsorbtion[group]));
+
+		config.dampingVersion++;
+	}
+
+	if (!m_valid || parameters.volume != last.volume)
+		config.volume = parameters.volume > -100.0f ? std::pow(10.0f, parameters.volume * 0.05f) : 0.0f;
+
+	const bool pruneChanged = tapsChanged || parameters.quality != last.quality
+		|| parameters.mix != last.mix || parameters.resonance != last.resonance;
+
+	config.resonance = parameters.resonance;
+	config.mix = parameters.mix;
+	config.parameters = parameters;
+
+	if (pruneChanged && pruneTaps(config))
+		config.pruneVersion++;
+
+	m_customVersion = customVersion;
+	m_valid = true;
+
+	return config;
+}
+
+//==============================================================================
+float EngineConfigBuilder::getPruneThreshold(TapQuality quality)
+{
+	switch (quality)
+	{
+	case TapQuality::Balanced:	return 1.0e-6f;	// -60 dB
+	case TapQuality::Eco:		return 1.0e-4f;	// -40 dB
+	default:					return 0.0f;
+	}
+}
+
+int EngineConfigBuilder::getTapLimit(TapQuality quality)
+{
+	switch (quality)
+	{
+	case TapQuality::Balanced:	return 1024;
+	case TapQuality::Eco:		return 256;
+	default:					return MultiTapDelay::MAX_TAPS;
+	}
+}
+
+bool EngineConfigBuilder::pruneTaps(EngineConfig& config)
+{
+	const int count = config.tapCount;
+	const TapQuality quality = config.parameters.quality;
+
+	std::fill(m_tapActive, m_tapActive + count, (unsigned char)1);
+	int kept = count;
+
+	if (quality != TapQuality::Full)
+	{
+		// Energy of the output for a white input, the volume scales both sides
+		const float mix = config.mix;
+		float wetEnergy = 0.0f;
+		for (int i = 0; i < count; i++)
+			wetEnergy += config.tapGains[i] * config.tapGains[i];
+
+		const float reference = (1.0f - mix) * (1.0f - mix) + mix * mix * wetEnergy;
+		const float threshold = getPruneThreshold(quality) * reference;
+		const int limit = getTapLimit(quality);
+
+		// The resonance loop feeds every tap back at the same weight, so a
+		// weak tap is not a quiet one there and only the limit applies
+		const bool resonant = config.resonance > 0.0f;
+
+		for (int i = 0; i < count; i++)
+			m_tapOrder[i] = i;
+
+		std::sort(m_tapOrder, m_tapOrder + count, [&config](int a, int b)
+		{
+			return std::abs(config.tapGains[a]) < std::abs(config.tapGains[b]);
+		});
+
+		float dropped = 0.0f;
+
+		for (int i = 0; i < count; i++)
+		{
+			const int tap = m_tapOrder[i];
+			const float energy = mix * mix * config.tapGains[tap] * config.tapGains[tap];
+
+			if (kept <= limit && (resonant || dropped + energy > threshold))
+				break;
+
+			m_tapActive[tap] = 0;
+			dropped += energy;
+			kept--;
+		}
+	}
+
+	const bool changed = kept != config.activeTapCount
+		|| !std::equal(m_tapActive, m_tapActive + count, config.tapActive);
+
+	std::copy(m_tapActive, m_tapActive + count, config.tapActive);
+	config.activeTapCount = kept;
+
+	return changed;
+}
@@ -0,0 +1,102 @@
+/*
+  ==============================================================================
+
+    Everything the engine takes from the parameters, derived once.
+
+    EngineConfigBuilder turns parameter values into the tap table, damping
+    coefficients and output gains of an EngineConfig. The plugin builds
+    them off the audio thread and hands them over whole, the engine only
+    compares versions and copies what changed into its delay lines.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "MultiTapDelay.h"
+#include "ReflectionModes.h"
+#include "RoomGeometry.h"
+
+//==============================================================================
+// Level of detail of the tap table. Full plays every tap. Balanced and Eco
+// drop the taps that add least to the output, up to an energy threshold
+// below the output, and cap the number of taps per delay line.
+enum class TapQuality
+{
+	Full,
+	Balanced,
+	Eco
+};
+
+//==============================================================================
+// Values as exposed by the plugin parameters
+struct EngineParameters
+{
+	float size = 0.5f;
+	float absorbtion = 0.0f;
+	float attenuation = 1.0f;
+	float resonance = 0.0f;
+	float mix = 0.5f;
+	float volume = 0.0f;
+	ReflectionMode mode = ReflectionMode::Room;
+	TapQuality quality = TapQuality::Full;
+};
+
+// Fixed size, so building one never allocates
+struct EngineConfig
+{
+	EngineParameters parameters;
+
+	// Tap delays as fractions of the engine delay scale
+	float tapFactors[MultiTapDelay::MAX_TAPS] = {};
+	float tapGains[MultiTapDelay::MAX_TAPS] = {};
+	int tapGroups[MultiTapDelay::MAX_TAPS] = {};
+	int tapCount = 0;
+	int groupCount = 1;
+
+	// Taps the level of detail keeps. The engine fades the others out and
+	// takes them out of its delay lines.
+	unsigned char tapActive[MultiTapDelay::MAX_TAPS] = {};
+	int activeTapCount = 0;
+
+	// One-pole coefficient of every damping group at the session rate
+	float groupDamping[MultiTapDelay::MAX_DAMPING_GROUPS] = {};
+
+	float resonance = 0.0f;
+	float mix = 0.5f;
+	float volume = 1.0f;
+
+	// Bumped whenever the tap table, the damping or the kept taps change
+	unsigned int tapsVersion = 0;
+	unsigned int dampingVersion = 0;
+	unsigned int pruneVersion = 0;
+};
+
+//==============================================================================
+class EngineConfigBuilder
+{
+public:
+	EngineConfigBuilder();
+
+	// Real time safe. Only what changed since the last call is derived
+	// again, customTaps is used by the Custom mode.
+	const EngineConfig& update(const EngineParameters& parameters, const TapSet& customTaps);
+
+	const EngineConfig& getConfig() const { return m_config; }
+
+	// Energy below the output the dropped taps may add up to, and the most
+	// taps kept
+	static float getPruneThreshold(TapQuality quality);
+	static int getTapLimit(TapQuality quality);
+
+private:
+	// Returns true when the kept taps changed
+	bool pruneTaps(EngineConfig& config);
+
+	EngineConfig m_config;
+	// Tap indices by ascending energy, scratch of pruneTaps
+	int m_tapOrder[MultiTapDelay::MAX_TAPS] = {};
+	unsigned char m_tapActive[MultiTapDelay::MAX_TAPS] = {};
+	unsigned int m_customVersion = 0;
+	bool m_valid = false;
+};
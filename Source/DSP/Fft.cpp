@@ -0,0 +1,206 @@
+/*
+  ==============================================================================
+
+    Real FFT for the partitioned convolution.
+
+  ==============================================================================
+*/
+
+#include "Fft.h"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+#include "SharedCache.h"
+
+#if defined(_MSC_VER)
+ #define ER_RESTRICT __restrict
+#else
+ #define ER_RESTRICT __restrict__
+#endif
+
+//==============================================================================
+// One run of radix-2 butterflies, twiddles contiguous so it vectorises
+static inline void butterflies(float* ER_RESTRICT aRe, float* ER_RESTRICT aIm,
+							   float* ER_RESTRICT bRe, float* ER_RESTRICT bIm,
+							   const float* ER_RESTRICT wRe, const float* ER_RESTRICT wIm, int count)
+{
+	for (int k = 0; k < count; k++)
+	{
+		const float tr = bRe[k] * wRe[k] - bIm[k] * wIm[k];
+		const float ti = bRe[k] * wIm[k] + bIm[k] * wRe[k];
+
+		bRe[k] = aRe[k] - tr;
+		bIm[k] = aIm[k] - ti;
+		aRe[k] += tr;
+		aIm[k] += ti;
+	}
+}
+
+Fft::Fft()
+{
+}
+
+std::shared_ptr<const Fft> Fft::getShared(int size)
+{
+	static SharedCache<int, Fft> cache;
+
+	return cache.get(size, [size]
+	{
+		Fft* fft = new Fft();
+		fft->init(size);
+		return fft;
+	});
+}
+
+void Fft::init(int size)
+{
+	const double pi = 3.14159265358979323846;
+
+	m_size = size;
+	m_half = size / 2;
+
+	// Complex transform of half the size
+	const int n = m_half;
+	int bits = 0;
+	while ((1 << bits) < n)
+		bits++;
+
+	m_bitReverse.assign(n, 0);
+	for (int i = 0; i < n; i++)
+	{
+		int reversed = 0;
+		for (int b = 0; b < bits; b++)
+			if (i & (1 << b))
+				reversed |= 1 << (bits - 1 - b);
+		m_bitReverse[i] = reversed;
+	}
+
+	// Twiddles of every stage one after the other, stage length L starts
+	// at L / 2 - 1 and holds e^(-2 pi i k / L) for k < L / 2
+	m_cos.assign(std::max(n - 1, 1), 0.0f);
+	m_sin.assign(std::max(n - 1, 1), 0.0f);
+	for (int length = 2; length <= n; length <<= 1)
+	{
+		for (int k = 0; k < length / 2; k++)
+		{
+			m_cos[length / 2 - 1 + k] = (float)std::cos(2.0 * pi * k / length);
+			m_sin[length / 2 - 1 + k] = (float)-std::sin(2.0 * pi * k / length);
+		}
+	}
+
+	// Twiddles of the real split, e^(-2 pi i k / size)
+	m_splitCos.assign(n + 1, 0.0f);
+	m_splitSin.assign(n + 1, 0.0f);
+	for (int k = 0; k <= n; k++)
+	{
+		m_splitCos[k] = (float)std::cos(2.0 * pi * k / size);
+		m_splitSin[k] = (float)-std::sin(2.0 * pi * k / size);
+	}
+}
+
+void Fft::transform(float* re, float* im) const
+{
+	const int n = m_half;
+
+	for (int i = 0; i < n; i++)
+	{
+		const int j = m_bitReverse[i];
+		if (j > i)
+		{
+			std::swap(re[i], re[j]);
+			std::swap(im[i], im[j]);
+		}
+	}
+
+	// The first stage needs no twiddles
+	for (int a = 0; a + 1 < n; a += 2)
+	{
+		const float tr = re[a + 1];
+		const float ti = im[a + 1];
+
+		re[a + 1] = re[a] - tr;
+		im[a + 1] = im[a] - ti;
+		re[a] += tr;
+		im[a] += ti;
+	}
+
+	for (int length = 4; length <= n; length <<= 1)
+	{
+		const int halfLength = length / 2;
+		const float* wRe = m_cos.data() + halfLength - 1;
+		const float* wIm = m_sin.data() + halfLength - 1;
+
+		for (int start = 0; start < n; start += length)
+			butterflies(re + start, im + start, re + start + halfLength, im + start + halfLength, wRe, wIm, halfLength);
+	}
+}
+
+void Fft::forward(const float* in, float* re, float* im, float* work) const
+{
+	const int n = m_half;
+	float* zr = work;
+	float* zi = work + n;
+
+	// Even samples as real part, odd samples as imaginary part
+	for (int i = 0; i < n; i++)
+	{
+		zr[i] = in[2 * i];
+		zi[i] = in[2 * i + 1];
+	}
+
+	transform(zr, zi);
+
+	// X[k] = E[k] + W^k O[k], with E and O recovered from Z[k] and Z[n - k]
+	for (int k = 0; k <= n; k++)
+	{
+		const int a = k == n ? 0 : k;
+		const int b = k == 0 ? 0 : n - k;
+
+		const float evenRe = 0.5f * (zr[a] + zr[b]);
+		const float evenIm = 0.5f * (zi[a] - zi[b]);
+		const float oddRe = 0.5f * (zi[a] + zi[b]);
+		const float oddIm = -0.5f * (zr[a] - zr[b]);
+
+		const float wr = m_splitCos[k];
+		const float wi = m_splitSin[k];
+
+		re[k] = evenRe + wr * oddRe - wi * oddIm;
+		im[k] = evenIm + wr * oddIm + wi * oddRe;
+	}
+}
+
+void Fft::inverse(const float* re, const float* im, float* out, float* work) const
+{
+	const int n = m_half;
+	float* zr = work;
+	float* zi = work + n;
+
+	// Z[k] = E[k] + i O[k], conjugated to run the forward transform backwards
+	for (int k = 0; k < n; k++)
+	{
+		const float evenRe = 0.5f * (re[k] + re[n - k]);
+		const float evenIm = 0.5f * (im[k] - im[n - k]);
+		const float diffRe = 0.5f * (re[k] - re[n - k]);
+		const float diffIm = 0.5f * (im[k] + im[n - k]);
+
+		// O[k] = diff / W^k, W^k on the unit circle
+		const float wr = m_splitCos[k];
+		const float wi = m_splitSin[k];
+		const float oddRe = diffRe * wr + diffIm * wi;
+		const float oddIm = diffIm * wr - diffRe * wi;
+
+		zr[k] = evenRe - oddIm;
+		zi[k] = -(evenIm + oddRe);
+	}
+
+	transform(zr, zi);
+
+	const float scale = 1.0f / n;
+	for (int i = 0; i < n; i++)
+	{
+		out[2 * i] = zr[i] * scale;
+		out[2 * i + 1] = -zi[i] * scale;
+	}
+}
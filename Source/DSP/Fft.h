@@ -0,0 +1,53 @@
+/*
+  ==============================================================================
+
+    Real FFT for the partitioned convolution. A real transform of size N
+    runs as a complex radix-2 transform of N/2 points plus one split pass.
+    Spectra are split into real and imaginary arrays of N/2 + 1 bins.
+
+    Tables are built by init(), off the audio thread. The transforms are
+    const and work in caller scratch, so one instance serves every channel
+    and worker thread. getShared() hands out one instance per size for the
+    whole process.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <memory>
+#include <vector>
+
+//==============================================================================
+class Fft
+{
+public:
+	Fft();
+
+	// Size must be a power of two, at least 4
+	void init(int size);
+	// Initialised transform of a size, shared by every plugin instance. Not
+	// on the audio thread.
+	static std::shared_ptr<const Fft> getShared(int size);
+	int getSize() const { return m_size; }
+	int getBins() const { return m_size / 2 + 1; }
+	// Scratch floats the transforms need
+	int getWorkSize() const { return m_size; }
+
+	void forward(const float* in, float* re, float* im, float* work) const;
+	// Scaled by 1 / size, so inverse(forward(x)) == x
+	void inverse(const float* re, const float* im, float* out, float* work) const;
+
+	static bool isPowerOfTwo(int n) { return n > 0 && (n & (n - 1)) == 0; }
+
+private:
+	void transform(float* re, float* im) const;
+
+	int m_size = 0;
+	int m_half = 0;
+	std::vector<int> m_bitReverse;
+	std::vector<float> m_cos;
+	std::vector<float> m_sin;
+	std::vector<float> m_splitCos;
+	std::vector<float> m_splitSin;
+};
@@ -0,0 +1,326 @@
+/*
+  ==============================================================================
+
+    Renders tap tables into partitioned impulse responses on a background
+    thread.
+
+  ==============================================================================
+*/
+
+#include "ImpulseResponseRenderer.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <tuple>
+
+#include "MultiTapDelay.h"
+#include "TapLayout.h"
+
+//==============================================================================
+// The thread all renderers of the process share
+class ImpulseResponseRenderer::Worker
+{
+public:
+	Worker()
+	{
+		m_thread = std::thread([this] { run(); });
+	}
+
+	~Worker()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_exit = true;
+		}
+
+		m_wake.notify_all();
+		m_thread.join();
+	}
+
+	// Started by the first caller, ends with the last owner
+	static std::shared_ptr<Worker> getShared()
+	{
+		static std::mutex mutex;
+		static std::weak_ptr<Worker> shared;
+
+		std::lock_guard<std::mutex> lock(mutex);
+		std::shared_ptr<Worker> worker = shared.lock();
+
+		if (worker == nullptr)
+		{
+			worker = std::make_shared<Worker>();
+			shared = worker;
+		}
+
+		return worker;
+	}
+
+	void add(ImpulseResponseRenderer* renderer)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_renderers.push_back(renderer);
+	}
+
+	// Waits while the worker renders for it
+	void remove(ImpulseResponseRenderer* renderer)
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_renderers.erase(std::remove(m_renderers.begin(), m_renderers.end(), renderer), m_renderers.end());
+		m_done.wait(lock, [this, renderer] { return m_current != renderer; });
+	}
+
+	// Audio thread, never blocks on the mutex
+	void wake()
+	{
+		m_signalled.store(true);
+		m_wake.notify_one();
+	}
+
+	std::mutex m_mutex;
+
+private:
+	void run()
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+
+		for (;;)
+		{
+			m_wake.wait(lock, [this] { return m_exit || m_signalled.load(); });
+
+			if (m_exit)
+				return;
+
+			// Requests after this point wake the next round
+			m_signalled.store(false);
+
+			for (size_t i = 0; i < m_renderers.size(); i++)
+			{
+				ImpulseResponseRenderer* renderer = m_renderers[i];
+
+				int expected = Ready;
+				if (!renderer->m_slotState.compare_exchange_strong(expected, Busy))
+					continue;
+
+				m_request = renderer->m_slot;
+				renderer->m_slotState.store(Free);
+
+				const Config config = renderer->m_config;
+				if (config.partitionSize <= 0)
+					continue;
+
+				m_current = renderer;
+				lock.unlock();
+
+				RenderedIR* rendered = render(m_request, config);
+
+				lock.lock();
+
+				if (config.generation == renderer->m_config.generation)
+					renderer->m_published.publish(rendered);
+				else
+					delete rendered;
+
+				m_current = nullptr;
+				m_done.notify_all();
+			}
+		}
+	}
+
+	std::condition_variable m_wake;
+	std::condition_variable m_done;
+	std::atomic<bool> m_signalled { false };
+	bool m_exit = false;
+
+	// Guarded by m_mutex
+	std::vector<ImpulseResponseRenderer*> m_renderers;
+	ImpulseResponseRenderer* m_current = nullptr;
+
+	// Copy of the slot the worker renders from
+	Request m_request;
+
+	std::thread m_thread;
+};
+
+//==============================================================================
+ImpulseResponseRenderer::ImpulseResponseRenderer()
+{
+	m_slot.factors.resize(MultiTapDelay::MAX_TAPS);
+	m_slot.gains.resize(MultiTapDelay::MAX_TAPS);
+	m_slot.groups.resize(MultiTapDelay::MAX_TAPS);
+	m_slot.indices.resize(MultiTapDelay::MAX_TAPS);
+}
+
+ImpulseResponseRenderer::~ImpulseResponseRenderer()
+{
+	if (m_worker != nullptr)
+		m_worker->remove(this);
+}
+
+void ImpulseResponseRenderer::prepare(int partitionSize, int delayScale, int delayOffset, const std::vector<int>& maxDelays)
+{
+	if (m_worker == nullptr)
+	{
+		m_worker = Worker::getShared();
+		m_worker->add(this);
+	}
+
+	std::lock_guard<std::mutex> lock(m_worker->m_mutex);
+
+	if (partitionSize != m_config.partitionSize)
+		m_config.fft = Fft::getShared(2 * partitionSize);
+
+	m_config.partitionSize = partitionSize;
+	m_config.delayScale = delayScale;
+	m_config.delayOffset = delayOffset;
+	m_config.maxDelays = maxDelays;
+	m_config.generation++;
+	m_slotState.store(Free);
+}
+
+bool ImpulseResponseRenderer::request(const float* factors, const float* gains, const int* groups, int count, unsigned int version,
+									  const int* indices)
+{
+	int expected = Free;
+	if (!m_slotState.compare_exchange_strong(expected, Busy))
+	{
+		// A request nobody picked up yet is replaced
+		expected = Ready;
+		if (!m_slotState.compare_exchange_strong(expected, Busy))
+			return false;
+	}
+
+	count = std::min(count, (int)MultiTapDelay::MAX_TAPS);
+
+	std::copy(factors, factors + count, m_slot.factors.begin());
+	std::copy(gains, gains + count, m_slot.gains.begin());
+
+	if (groups != nullptr)
+		std::copy(groups, groups + count, m_slot.groups.begin());
+	else
+		std::fill(m_slot.groups.begin(), m_slot.groups.begin() + count, 0);
+
+	for (int i = 0; i < count; i++)
+		m_slot.indices[i] = indices != nullptr ? indices[i] : i;
+
+	m_slot.count = count;
+	m_slot.version = version;
+
+	m_slotState.store(Ready);
+
+	if (m_worker != nullptr)
+		m_worker->wake();
+
+	return true;
+}
+
+const RenderedIR* ImpulseResponseRenderer::acquire()
+{
+	// Until the worker took the request, in case it missed the wake
+	if (m_worker != nullptr && m_slotState.load() == Ready)
+		m_worker->wake();
+
+	return m_published.acquire();
+}
+
+//==============================================================================
+RenderedIR* ImpulseResponseRenderer::render(const Request& request, const Config& config)
+{
+	Key key = { config.partitionSize, config.delayScale, config.delayOffset, config.maxDelays,
+				std::vector<float>(request.factors.begin(), request.factors.begin() + request.count),
+				std::vector<float>(request.gains.begin(), request.gains.begin() + request.count),
+				std::vector<int>(request.groups.begin(), request.groups.begin() + request.count),
+				std::vector<int>(request.indices.begin(), request.indices.begin() + request.count) };
+
+	RenderedIR* rendered = new RenderedIR();
+	rendered->ir = getCache().get(key, [&request, &config] { return renderIR(request, config); });
+	rendered->version = request.version;
+
+	return rendered;
+}
+
+SharedCache<ImpulseResponseRenderer::Key, ConvolutionIR>& ImpulseResponseRenderer::getCache()
+{
+	static SharedCache<Key, ConvolutionIR> cache;
+	return cache;
+}
+
+bool ImpulseResponseRenderer::Key::operator<(const Key& other) const
+{
+	return std::tie(partitionSize, delayScale, delayOffset, maxDelays, factors, gains, groups, indices)
+		 < std::tie(other.partitionSize, other.delayScale, other.delayOffset, other.maxDelays,
+					other.factors, other.gains, other.groups, other.indices);
+}
+
+ConvolutionIR* ImpulseResponseRenderer::renderIR(const Request& request, const Config& config)
+{
+	const int partitionSize = config.partitionSize;
+	const int numChannels = (int)config.maxDelays.size();
+	const Fft& fft = *config.fft;
+
+	ConvolutionIR* ir = new ConvolutionIR();
+	ir->partitionSize = partitionSize;
+	ir->bins = fft.getBins();
+	ir->channels.resize(numChannels);
+
+	std::vector<float> time(2 * partitionSize);
+	std::vector<float> work(fft.getWorkSize());
+
+	struct Impulse
+	{
+		int group;
+		int delay;
+		float gain;
+	};
+
+	std::vector<Impulse> impulses(request.count);
+
+	for (int channel = 0; channel < numChannels; channel++)
+	{
+		// Same delays as the delay line of this channel
+		for (int i = 0; i < request.count; i++)
+		{
+			const int delay = TapLayout::getTapDelay(config.delayScale, channel, request.indices[i], request.factors[i]) - config.delayOffset;
+			const int group = std::min(std::max(request.groups[i], 0), MultiTapDelay::MAX_DAMPING_GROUPS - 1);
+			impulses[i] = { group, std::min(std::max(delay, 1), config.maxDelays[channel]), request.gains[i] };
+		}
+
+		std::sort(impulses.begin(), impulses.end(), [](const Impulse& a, const Impulse& b)
+		{
+			return a.group != b.group ? a.group < b.group : a.delay < b.delay;
+		});
+
+		ConvolutionIR::Channel& irChannel = ir->channels[channel];
+		irChannel.firstGroup = (int)ir->groups.size();
+
+		for (size_t i = 0; i < impulses.size(); )
+		{
+			ConvolutionIR::Group group = { impulses[i].group, (int)ir->segments.size(), 0 };
+
+			// One spectrum per partition that holds at least one impulse
+			while (i < impulses.size() && impulses[i].group == group.group)
+			{
+				const int partition = impulses[i].delay / partitionSize;
+				std::fill(time.begin(), time.end(), 0.0f);
+
+				for (; i < impulses.size() && impulses[i].group == group.group
+					   && impulses[i].delay / partitionSize == partition; i++)
+					time[impulses[i].delay - partition * partitionSize] += impulses[i].gain;
+
+				const size_t offset = ir->spectra.size();
+				ir->spectra.resize(offset + 2 * ir->bins);
+				fft.forward(time.data(), ir->spectra.data() + offset, ir->spectra.data() + offset + ir->bins, work.data());
+
+				ir->segments.push_back({ partition, offset });
+				ir->maxPartition = std::max(ir->maxPartition, partition);
+				group.segmentCount++;
+			}
+
+			ir->groups.push_back(group);
+			irChannel.groupCount++;
+		}
+	}
+
+	return ir;
+}
@@ -0,0 +1,131 @@
+/*
+  ==============================================================================
+
+    Renders tap tables into partitioned impulse responses on a background
+    thread for the convolution path.
+
+    The audio thread posts a request into a preallocated slot with a
+    compare-and-swap, and gets finished IRs back through an
+    AtomicPublisher. It never locks or allocates; it only notifies the
+    worker, without the mutex, so a wake that comes just before the
+    worker sleeps is lost. acquire() notifies again on every block while
+    the request waits. A request that finds the slot busy is simply posted
+    again on a later block.
+
+    One worker thread serves every renderer in the process. The first
+    prepare() starts it, and it ends with the last renderer. It sleeps
+    until a request comes in and holds its mutex only to hand a slot over
+    and to publish, never while rendering.
+
+    Rendered IRs are shared by every instance in the process, keyed by the
+    configuration and the tap table. An instance asking for an IR another
+    one already holds gets that one without rendering it again.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "AtomicPublisher.h"
+#include "Fft.h"
+#include "PartitionedConvolver.h"
+#include "SharedCache.h"
+
+//==============================================================================
+// A shared IR and the version of the request it answers
+struct RenderedIR
+{
+	std::shared_ptr<const ConvolutionIR> ir;
+	unsigned int version = 0;
+};
+
+//==============================================================================
+class ImpulseResponseRenderer
+{
+public:
+	ImpulseResponseRenderer();
+	~ImpulseResponseRenderer();
+
+	// Not while the audio thread posts requests. delayOffset is subtracted
+	// from every tap and maxDelays holds the longest delay the ring of each
+	// channel allows, taps are clamped like the delay lines.
+	void prepare(int partitionSize, int delayScale, int delayOffset, const std::vector<int>& maxDelays);
+
+	// Audio thread, returns false when the slot is busy. indices are the tap
+	// numbers of the decorrelation, nullptr numbers the taps in order.
+	bool request(const float* factors, const float* gains, const int* groups, int count, unsigned int version,
+				 const int* indices = nullptr);
+
+	// Audio thread, see AtomicPublisher
+	const RenderedIR* acquire();
+	void release() { m_published.release(); }
+
+private:
+	enum SlotState
+	{
+		Free,
+		Busy,
+		Ready
+	};
+
+	struct Request
+	{
+		std::vector<float> factors;
+		std::vector<float> gains;
+		std::vector<int> groups;
+		std::vector<int> indices;
+		int count = 0;
+		unsigned int version = 0;
+	};
+
+	// What prepare() sets, copied with every request the worker takes
+	struct Config
+	{
+		std::shared_ptr<const Fft> fft;
+		int partitionSize = 0;
+		int delayScale = 0;
+		int delayOffset = 0;
+		std::vector<int> maxDelays;
+		// Counts the prepares, an IR of an earlier one is dropped
+		unsigned int generation = 0;
+	};
+
+	// Everything the rendered IR depends on
+	struct Key
+	{
+		int partitionSize;
+		int delayScale;
+		int delayOffset;
+		std::vector<int> maxDelays;
+		std::vector<float> factors;
+		std::vector<float> gains;
+		std::vector<int> groups;
+		std::vector<int> indices;
+
+		bool operator<(const Key& other) const;
+	};
+
+	class Worker;
+
+	static RenderedIR* render(const Request& request, const Config& config);
+	static ConvolutionIR* renderIR(const Request& request, const Config& config);
+
+	static SharedCache<Key, ConvolutionIR>& getCache();
+
+	AtomicPublisher<RenderedIR> m_published;
+
+	Request m_slot;
+	std::atomic<int> m_slotState { Free };
+
+	// Guarded by the mutex of the worker
+	Config m_config;
+
+	std::shared_ptr<Worker> m_worker;
+
+	ImpulseResponseRenderer(const ImpulseResponseRenderer&) = delete;
+	ImpulseResponseRenderer& operator=(const ImpulseResponseRenderer&) = delete;
+};
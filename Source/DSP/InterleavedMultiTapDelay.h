@@ -0,0 +1,443 @@
+/*
+  ==============================================================================
+
+    MultiTapDelay variant that keeps the history of all channels in one
+    interleaved ring of frames. Every channel shares the tap gains, damping
+    groups and resonance and only differs in its tap delays, so one pass
+    over the tap table serves all channels, each damping filter updates all
+    channels per frame and the ring is a single memory stream. The ring
+    holds the undamped input like MultiTapDelay, and every channel has the
+    ResonanceCombs of the same taps.
+
+    CHANNELS is a template parameter; the SSE2 path covers stereo frames and
+    wider layouts fall back to the generic loops.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "AbsorbtionTable.h"
+#include "CircularBuffer.h"
+#include "DelayArena.h"
+#include "Denormals.h"
+#include "MultiTapDelay.h"
+#include "ResonanceCombs.h"
+
+#if defined(_M_X64) || defined(__x86_64__)
+ #include <emmintrin.h>
+ #define ER_INTERLEAVED_SSE2 1
+#endif
+
+//==============================================================================
+template <int CHANNELS>
+class InterleavedMultiTapDelay
+{
+public:
+	static const int MAX_TAPS = MultiTapDelay::MAX_TAPS;
+	static const int MAX_DAMPING_GROUPS = MultiTapDelay::MAX_DAMPING_GROUPS;
+
+	static size_t getRequiredStorage(const int* delayScales, int blockSize, int tapCapacity = MAX_TAPS)
+	{
+		const int frames = getFrames(delayScales, blockSize);
+
+		return DelayArena::roundUp((size_t)frames * CHANNELS)
+			 + 3 * DelayArena::roundUp((size_t)blockSize * CHANNELS)
+			 + DelayArena::roundUp((size_t)ResonanceCombs::LINES_PER_PASS * blockSize)
+			 + CHANNELS * ResonanceCombs::getRequiredStorage(frames - blockSize - 1)
+			 + DelayArena::roundUpFor<Tap>(tapCapacity);
+	}
+
+	void init(DelayArena& arena, const int* delayScales, int blockSize, int tapCapacity = MAX_TAPS)
+	{
+		m_size = getFrames(delayScales, blockSize);
+		m_buffer = arena.allocate((size_t)m_size * CHANNELS);
+		m_blockSize = blockSize;
+		m_inputBlock = arena.allocate((size_t)blockSize * CHANNELS);
+		m_wetBlock = arena.allocate((size_t)blockSize * CHANNELS);
+		m_groupBlock = arena.allocate((size_t)blockSize * CHANNELS);
+		m_lineBlock = arena.allocate((size_t)ResonanceCombs::LINES_PER_PASS * blockSize);
+		m_taps = arena.allocateFor<Tap>(tapCapacity);
+		m_tapCapacity = tapCapacity;
+
+		for (int channel = 0; channel < CHANNELS; channel++)
+			m_delayScale[channel] = delayScales[channel];
+
+		for (auto& combs : m_combs)
+			combs.init(arena, m_size - m_blockSize - 1);
+
+		clear();
+	}
+
+	void clear()
+	{
+		m_head = 0;
+		memset(m_buffer, 0, (size_t)m_size * CHANNELS * sizeof(float));
+
+		for (auto& combs : m_combs)
+			combs.clear();
+
+		for (auto& group : m_groups)
+			std::fill(group.last, group.last + CHANNELS, 0.0f);
+	}
+
+	// Real time safe, the table is sorted in place
+	void setTaps(const float* factors, const float* gains, int count, const int* groups = nullptr)
+	{
+		count = std::min(count, m_tapCapacity);
+		const int maxDelay = m_size - m_blockSize - 1;
+
+		for (int i = 0; i < count; i++)
+		{
+			Tap& tap = m_taps[i];
+
+			for (int channel = 0; channel < CHANNELS; channel++)
+			{
+				const int delay = (int)(2.0f + m_delayScale[channel] * factors[i] * 0.98f);
+				tap.delay[channel] = std::min(std::max(delay, 1), maxDelay);
+			}
+
+			tap.gain = gains[i];
+			tap.index = i;
+			tap.group = groups != nullptr ? std::min(std::max(groups[i], 0), MAX_DAMPING_GROUPS - 1) : 0;
+		}
+
+		std::sort(m_taps, m_taps + count, [](const Tap& a, const Tap& b)
+		{
+			return a.group != b.group ? a.group < b.group : a.delay[0] < b.delay[0];
+		});
+
+		m_tapCount = count;
+		m_activeGroupCount = 0;
+
+		int i = 0;
+		for (int g = 0; g < MAX_DAMPING_GROUPS; g++)
+		{
+			DampingGroup& group = m_groups[g];
+			group.begin = i;
+
+			while (i < count && m_taps[i].group == g)
+				i++;
+
+			group.count = i - group.begin;
+
+			if (group.count > 0)
+				m_activeGroups[m_activeGroupCount++] = g;
+			else
+				std::fill(group.last, group.last + CHANNELS, 0.0f);
+		}
+
+		selectLines();
+	}
+
+	// New gains for the taps of the last setTaps call, in its order
+	void setTapGains(const float* gains)
+	{
+		for (int i = 0; i < m_tapCount; i++)
+			m_taps[i].gain = gains[m_taps[i].index];
+	}
+
+	// Base damping of every group
+	void setDamping(float a0)
+	{
+		for (int group = 0; group < MAX_DAMPING_GROUPS; group++)
+			setGroupDamping(group, a0);
+	}
+
+	void setGroupDamping(int group, float a0)
+	{
+		m_groups[group].a0 = a0;
+		m_groups[group].b1 = 1.0f - a0;
+	}
+
+	void setFeedback(float feedback)
+	{
+		m_feedback = feedback;
+	}
+
+	// Planar in and out, out receives the wet signal only
+	void processBlock(const float* const* in, float* const* out, int count)
+	{
+		for (int offset = 0; offset < count; offset += m_blockSize)
+		{
+			const int span = std::min(count - offset, m_blockSize);
+
+			for (int j = 0; j < span; j++)
+				for (int channel = 0; channel < CHANNELS; channel++)
+					m_inputBlock[j * CHANNELS + channel] = in[channel][offset + j];
+
+			// Whole blocks are written before the taps are read
+			writeFrames(m_inputBlock, span);
+
+			const int start = m_head >= span ? m_head - span : m_head - span + m_size;
+			readGroups(start, span);
+
+			for (int j = 0; j < span; j++)
+				for (int channel = 0; channel < CHANNELS; channel++)
+					out[channel][offset + j] = m_wetBlock[j * CHANNELS + channel];
+
+			for (int channel = 0; channel < CHANNELS; channel++)
+				addResonance(channel, start, out[channel] + offset, span);
+		}
+	}
+
+private:
+	struct Tap
+	{
+		int delay[CHANNELS];
+		float gain;
+		int group;
+		int index;
+	};
+
+	struct DampingGroup
+	{
+		int begin = 0;
+		int count = 0;
+		float a0 = 1.0f;
+		float b1 = 0.0f;
+		float last[CHANNELS] = {};
+	};
+
+	// One block longer than the longest tap, see MultiTapDelay::getRingSize
+	static int getFrames(const int* delayScales, int blockSize)
+	{
+		int frames = 0;
+		for (int channel = 0; channel < CHANNELS; channel++)
+			frames = std::max(frames, MultiTapDelay::getRingSize(delayScales[channel], blockSize));
+		return frames;
+	}
+
+	// dst[j][c] += gain * src[c][j], where src[c] points at channel c of a frame
+	static void accumulateFrames(float* dst, const float* const* src, float gain, int frames)
+	{
+		int j = 0;
+
+	   #if ER_INTERLEAVED_SSE2
+		if (CHANNELS == 2)
+		{
+			// Two frames per register, lane c taken from the run of channel c
+			const __m128 vGain = _mm_set1_ps(gain);
+			const __m128 leftMask = _mm_castsi128_ps(_mm_set_epi32(0, -1, 0, -1));
+			const float* left = src[0];
+			const float* right = src[1] - 1;
+
+			for (; j + 1 < frames; j += 2)
+			{
+				const __m128 a = _mm_and_ps(leftMask, _mm_loadu_ps(left + 2 * j));
+				const __m128 b = _mm_andnot_ps(leftMask, _mm_loadu_ps(right + 2 * j));
+				const __m128 acc = _mm_loadu_ps(dst + 2 * j);
+				_mm_storeu_ps(dst + 2 * j, _mm_add_ps(acc, _mm_mul_ps(vGain, _mm_or_ps(a, b))));
+			}
+		}
+	   #endif
+
+		for (; j < frames; j++)
+			for (int channel = 0; channel < CHANNELS; channel++)
+				dst[j * CHANNELS + channel] += gain * src[channel][j * CHANNELS];
+	}
+
+	void accumulateTap(float* dst, int head, const int* delays, float gain, int count)
+	{
+		int start[CHANNELS];
+		int bounds[CHANNELS + 2];
+		int boundCount = 0;
+
+		bounds[boundCount++] = 0;
+		bounds[boundCount++] = count;
+
+		for (int channel = 0; channel < CHANNELS; channel++)
+		{
+			start[channel] = head - delays[channel];
+			if (start[channel] < 0)
+				start[channel] += m_size;
+
+			if (m_size - start[channel] < count)
+				bounds[boundCount++] = m_size - start[channel];
+		}
+
+		std::sort(bounds, bounds + boundCount);
+
+		// Between two wrap points every channel reads one contiguous run
+		for (int b = 0; b + 1 < boundCount; b++)
+		{
+			const int from = bounds[b];
+			const int to = bounds[b + 1];
+			if (from == to)
+				continue;
+
+			const float* src[CHANNELS];
+			for (int channel = 0; channel < CHANNELS; channel++)
+			{
+				int frame = start[channel] + from;
+				if (frame >= m_size)
+					frame -= m_size;
+				src[channel] = m_buffer + (size_t)frame * CHANNELS + channel;
+			}
+
+			accumulateFrames(dst + from * CHANNELS, src, gain, to - from);
+		}
+	}
+
+	// Wet block from the frames starting at head, every group damped once
+	void readGroups(int head, int count)
+	{
+		const int samples = count * CHANNELS;
+
+		std::fill(m_wetBlock, m_wetBlock + samples, 0.0f);
+
+		for (int a = 0; a < m_activeGroupCount; a++)
+		{
+			DampingGroup& group = m_groups[m_activeGroups[a]];
+
+			std::fill(m_groupBlock, m_groupBlock + samples, 0.0f);
+
+			for (int i = group.begin; i < group.begin + group.count; i++)
+				accumulateTap(m_groupBlock, head, m_taps[i].delay, m_taps[i].gain, count);
+
+			for (int j = 0; j < count; j++)
+			{
+				for (int channel = 0; channel < CHANNELS; channel++)
+				{
+					group.last[channel] = group.a0 * m_groupBlock[j * CHANNELS + channel] + group.b1 * group.last[channel];
+					m_wetBlock[j * CHANNELS + channel] += group.last[channel];
+				}
+			}
+
+			for (int channel = 0; channel < CHANNELS; channel++)
+				group.last[channel] = flushDenormal(group.last[channel]);
+		}
+	}
+
+	// Same selection as MultiTapDelay::selectLines, by the strongest gains
+	// and then in the order of the table
+	void selectLines()
+	{
+		const int maxLines = ResonanceCombs::MAX_LINES;
+
+		m_lineCount = 0;
+
+		for (int i = 0; i < m_tapCount; i++)
+		{
+			const float gain = std::abs(m_taps[i].gain);
+			int line = m_lineCount;
+
+			if (m_lineCount < maxLines)
+				m_lineCount++;
+			else if (gain > std::abs(m_taps[m_lineTap[maxLines - 1]].gain))
+				line = maxLines - 1;
+			else
+				continue;
+
+			for (; line > 0 && std::abs(m_taps[m_lineTap[line - 1]].gain) < gain; line--)
+				m_lineTap[line] = m_lineTap[line - 1];
+
+			m_lineTap[line] = i;
+		}
+
+		std::sort(m_lineTap, m_lineTap + m_lineCount, [this](int a, int b)
+		{
+			return m_taps[a].index < m_taps[b].index;
+		});
+	}
+
+	// count samples of channel from the frames starting at frame
+	void readChannel(float* dst, int channel, int frame, int count) const
+	{
+		for (int j = 0; j < count; j++)
+		{
+			dst[j] = m_buffer[(size_t)frame * CHANNELS + channel];
+
+			if (++frame == m_size)
+				frame = 0;
+		}
+	}
+
+	// Comb lines of one channel for the frames written from start on
+	void addResonance(int channel, int start, float* out, int count)
+	{
+		ResonanceCombs& combs = m_combs[channel];
+
+		if (!combs.begin(m_feedback))
+			return;
+
+		for (int first = 0; first < m_lineCount; first += ResonanceCombs::LINES_PER_PASS)
+		{
+			const int lineCount = std::min(m_lineCount - first, ResonanceCombs::LINES_PER_PASS);
+			ResonanceCombs::Line lines[ResonanceCombs::LINES_PER_PASS];
+
+			for (int k = 0; k < lineCount; k++)
+			{
+				const Tap& tap = m_taps[m_lineTap[first + k]];
+				const DampingGroup& group = m_groups[tap.group];
+				const int delay = tap.delay[channel];
+				float* lineBlock = m_lineBlock + k * m_blockSize;
+
+				int frame = start - delay;
+				if (frame < 0)
+					frame += m_size;
+
+				if (combs.isStarting())
+				{
+					const int history = std::min(m_blockSize, m_size - count - delay - 1);
+
+					if (history > 0)
+					{
+						readChannel(lineBlock, channel, frame >= history ? frame - history : frame - history + m_size, history);
+						combs.prime(first + k, lineBlock, history, group.a0, group.b1);
+					}
+				}
+
+				readChannel(lineBlock, channel, frame, count);
+				lines[k] = { lineBlock, delay, tap.gain, group.a0, group.b1 };
+			}
+
+			combs.process(first, lines, lineCount, out, count);
+		}
+
+		combs.end(count);
+	}
+
+	void writeFrames(const float* frames, int count)
+	{
+		const int first = std::min(count, m_size - m_head);
+		memcpy(m_buffer + (size_t)m_head * CHANNELS, frames, (size_t)first * CHANNELS * sizeof(float));
+		memcpy(m_buffer, frames + first * CHANNELS, (size_t)(count - first) * CHANNELS * sizeof(float));
+
+		m_head += count;
+		if (m_head >= m_size)
+			m_head -= m_size;
+	}
+
+	// Ring of m_size frames
+	float* m_buffer = nullptr;
+	int m_size = 0;
+	int m_head = 0;
+	int m_delayScale[CHANNELS] = {};
+
+	// Tap table in arena memory, grouped and sorted by the first channel's delay
+	Tap* m_taps = nullptr;
+	int m_tapCapacity = 0;
+	int m_tapCount = 0;
+
+	DampingGroup m_groups[MAX_DAMPING_GROUPS];
+	int m_activeGroups[MAX_DAMPING_GROUPS] = {};
+	int m_activeGroupCount = 0;
+
+	// Interleaved block scratch
+	float* m_inputBlock = nullptr;
+	float* m_wetBlock = nullptr;
+	float* m_groupBlock = nullptr;
+	float* m_lineBlock = nullptr;
+	int m_blockSize = 0;
+
+	// Resonant taps, indices into m_taps
+	ResonanceCombs m_combs[CHANNELS];
+	int m_lineTap[ResonanceCombs::MAX_LINES] = {};
+	int m_lineCount = 0;
+	float m_feedback = 0.0f;
+};
@@ -0,0 +1,423 @@
+/*
+  ==============================================================================
+
+    Sparse multi-tap delay with grouped damping.
+
+  ==============================================================================
+*/
+
+#include "MultiTapDelay.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "Denormals.h"
+#include "ReflectionModes.h"
+
+//==============================================================================
+// Adds the taps FIRST to FIRST + COUNT - 1 to dst, in chunks of up to eight
+// the compiler unrolls and vectorizes over the samples. Every sample takes
+// its taps in table order, the same sums as one accumulate per tap.
+template <int FIRST, int COUNT>
+static inline void sumTaps(const float* const* taps, const float* gains, float* ER_RESTRICT dst, int count)
+{
+	const int CHUNK = 8;
+
+	if constexpr (COUNT > CHUNK)
+	{
+		sumTaps<FIRST, CHUNK>(taps, gains, dst, count);
+		sumTaps<FIRST + CHUNK, COUNT - CHUNK>(taps, gains, dst, count);
+	}
+	else
+	{
+		for (int j = 0; j < count; j++)
+		{
+			float sum = dst[j];
+			for (int k = FIRST; k < FIRST + COUNT; k++)
+				sum += gains[k] * taps[k][j];
+			dst[j] = sum;
+		}
+	}
+}
+
+//==============================================================================
+MultiTapDelay::MultiTapDelay()
+{
+}
+
+void MultiTapDelay::setTaps(const float* factors, const float* gains, int count, const int* groups)
+{
+	count = std::min(count, m_tapCapacity);
+
+	for (int i = 0; i < count; i++)
+		m_tapScratch[i] = { m_buffer.delayFromFactor(factors[i]), gains[i], groups != nullptr ? groups[i] : 0, i };
+
+	layoutTaps(count);
+}
+
+void MultiTapDelay::setTapDelays(const int* delays, const float* gains, int count, const int* groups)
+{
+	count = std::min(count, m_tapCapacity);
+
+	for (int i = 0; i < count; i++)
+		m_tapScratch[i] = { delays[i], gains[i], groups != nullptr ? groups[i] : 0, i };
+
+	layoutTaps(count);
+}
+
+void MultiTapDelay::setTapGains(const float* gains)
+{
+	for (int a = 0; a < m_activeGroupCount; a++)
+	{
+		const DampingGroup& group = m_groups[m_activeGroups[a]];
+
+		for (int slot = group.begin; slot < group.begin + group.count; slot++)
+			m_tapGain[slot] = gains[m_tapIndex[slot]];
+	}
+}
+
+void MultiTapDelay::layoutTaps(int count)
+{
+	const int maxDelay = getMaxDelay();
+
+	for (int i = 0; i < count; i++)
+	{
+		Tap& tap = m_tapScratch[i];
+		tap.delay = std::min(std::max(tap.delay, 1), maxDelay);
+		tap.group = std::min(std::max(tap.group, 0), MAX_DAMPING_GROUPS - 1);
+	}
+
+	std::sort(m_tapScratch, m_tapScratch + count, [](const Tap& a, const Tap& b)
+	{
+		return a.group != b.group ? a.group < b.group : a.delay < b.delay;
+	});
+
+	m_tapCount = count;
+	m_activeGroupCount = 0;
+
+	int slot = 0;
+	int i = 0;
+
+	for (int g = 0; g < MAX_DAMPING_GROUPS; g++)
+	{
+		DampingGroup& group = m_groups[g];
+		group.begin = slot;
+		group.count = 0;
+
+		for (; i < count && m_tapScratch[i].group == g; i++, slot++)
+		{
+			m_tapDelay[slot] = m_tapScratch[i].delay;
+			m_tapIndex[slot] = m_tapScratch[i].index;
+			m_tapGain[slot] = m_tapScratch[i].gain;
+			group.count++;
+		}
+
+		// An emptied group starts from silence when it is used again
+		if (group.count > 0)
+			m_activeGroups[m_activeGroupCount++] = g;
+		else
+			group.last = 0.0f;
+	}
+
+	selectRead();
+	selectLines();
+}
+
+void MultiTapDelay::selectRead()
+{
+	struct FixedRead
+	{
+		int taps;
+		ReadFunction read;
+	};
+
+	// One specialization per fixed mode, picked when the layout changes
+	static const FixedRead fixedReads[] =
+	{
+		{ ReflectionModes::N_ROOM_DELAY_LINES, &MultiTapDelay::readFixed<ReflectionModes::N_ROOM_DELAY_LINES> },
+		{ ReflectionModes::N_HALL_DELAY_LINES, &MultiTapDelay::readFixed<ReflectionModes::N_HALL_DELAY_LINES> },
+		{ ReflectionModes::N_HALL_ECO_DELAY_LINES, &MultiTapDelay::readFixed<ReflectionModes::N_HALL_ECO_DELAY_LINES> }
+	};
+
+	m_read = &MultiTapDelay::readGroups;
+
+	// The specializations read float history of a single group
+	if (m_activeGroupCount != 1 || m_buffer.isCompact())
+		return;
+
+	for (const FixedRead& fixed : fixedReads)
+	{
+		if (fixed.taps == m_tapCount)
+		{
+			m_read = fixed.read;
+			return;
+		}
+	}
+}
+
+void MultiTapDelay::selectLines()
+{
+	const int maxLines = ResonanceCombs::MAX_LINES;
+
+	// The strongest taps resonate, all of them in a fixed mode
+	m_lineCount = 0;
+
+	for (int a = 0; a < m_activeGroupCount; a++)
+	{
+		const int g = m_activeGroups[a];
+		const DampingGroup& group = m_groups[g];
+
+		for (int slot = group.begin; slot < group.begin + group.count; slot++)
+		{
+			int line = m_lineCount;
+
+			if (m_lineCount < maxLines)
+				m_lineCount++;
+			else if (std::abs(m_tapGain[slot]) > std::abs(m_tapGain[m_lineSlot[maxLines - 1]]))
+				line = maxLines - 1;
+			else
+				continue;
+
+			// Kept sorted by falling gain
+			for (; line > 0 && std::abs(m_tapGain[m_lineSlot[line - 1]]) < std::abs(m_tapGain[slot]); line--)
+			{
+				m_lineSlot[line] = m_lineSlot[line - 1];
+				m_lineGroup[line] = m_lineGroup[line - 1];
+			}
+
+			m_lineSlot[line] = slot;
+			m_lineGroup[line] = g;
+		}
+	}
+
+	// A line keeps its tap while the table only changes its delays
+	for (int line = 1; line < m_lineCount; line++)
+	{
+		const int slot = m_lineSlot[line];
+		const int g = m_lineGroup[line];
+		int other = line;
+
+		for (; other > 0 && m_tapIndex[m_lineSlot[other - 1]] > m_tapIndex[slot]; other--)
+		{
+			m_lineSlot[other] = m_lineSlot[other - 1];
+			m_lineGroup[other] = m_lineGroup[other - 1];
+		}
+
+		m_lineSlot[other] = slot;
+		m_lineGroup[other] = g;
+	}
+}
+
+void MultiTapDelay::processBlock(const float* in, float* out, int count)
+{
+	for (int offset = 0; offset < count; offset += m_blockSize)
+	{
+		const int span = std::min(count - offset, m_blockSize);
+		processWriteFirst(in + offset, out + offset, span);
+	}
+}
+
+void MultiTapDelay::processWriteFirst(const float* in, float* out, int count)
+{
+	// The history is the plain input, so the whole block goes into the ring
+	// first and every tap reads one run of it
+	m_buffer.writeBlock(in, count);
+
+	int start = m_buffer.getHead() - count;
+	if (start < 0)
+		start += m_buffer.getSize();
+
+	if (m_convolver != nullptr && m_convolver->push(m_buffer, count)
+		&& m_impulseResponse != nullptr && m_convolver->canConvolve(*m_impulseResponse))
+		readGroupsConvolved(out, count);
+	else
+		(this->*m_read)(m_buffer, out, start, count);
+
+	addResonance(m_buffer, out, start, count);
+}
+
+void MultiTapDelay::processBlockShared(const MultiTapDelay& source, float* out, int count)
+{
+	const CircularBuffer& ring = source.m_buffer;
+
+	int start = ring.getHead() - count;
+	if (start < 0)
+		start += ring.getSize();
+
+	// The convolver takes the spectrum of the shared input
+	if (m_convolver != nullptr && source.m_convolver != nullptr && m_convolver->pushShared(*source.m_convolver, count)
+		&& m_impulseResponse != nullptr && m_convolver->canConvolve(*m_impulseResponse))
+		readGroupsConvolved(out, count);
+	else
+		(this->*m_read)(ring, out, start, count);
+
+	addResonance(ring, out, start, count);
+}
+
+void MultiTapDelay::addResonance(const CircularBuffer& ring, float* out, int start, int count)
+{
+	if (!m_combs.begin(m_feedback))
+		return;
+
+	const int size = ring.getSize();
+
+	for (int first = 0; first < m_lineCount; first += ResonanceCombs::LINES_PER_PASS)
+	{
+		const int lineCount = std::min(m_lineCount - first, ResonanceCombs::LINES_PER_PASS);
+		ResonanceCombs::Line lines[ResonanceCombs::LINES_PER_PASS];
+
+		for (int k = 0; k < lineCount; k++)
+		{
+			const int line = first + k;
+			const int delay = m_tapDelay[m_lineSlot[line]];
+			const DampingGroup& group = m_groups[m_lineGroup[line]];
+			float* lineBlock = m_lineBlock + k * m_blockSize;
+
+			int readIdx = start - delay;
+			if (readIdx < 0)
+				readIdx += size;
+
+			// A line that starts takes up the damped input where it stands
+			if (m_combs.isStarting())
+			{
+				const int history = std::min(m_blockSize, size - count - delay - 1);
+
+				if (history > 0)
+				{
+					ring.read(lineBlock, readIdx >= history ? readIdx - history : readIdx - history + size, history);
+					m_combs.prime(line, lineBlock, history, group.a0, group.b1);
+				}
+			}
+
+			ring.read(lineBlock, readIdx, count);
+			lines[k] = { lineBlock, delay, m_tapGain[m_lineSlot[line]], group.a0, group.b1 };
+		}
+
+		m_combs.process(first, lines, lineCount, out, count);
+	}
+
+	m_combs.end(count);
+}
+
+void MultiTapDelay::readGroups(const CircularBuffer& ring, float* out, int start, int count)
+{
+	const int size = ring.getSize();
+	float* groupBlock = m_groupBlock;
+
+	std::fill(out, out + count, 0.0f);
+
+	// Each group sums its taps, one or two contiguous runs per tap split at
+	// the wrap point, then damps the sum once
+	for (int a = 0; a < m_activeGroupCount; a++)
+	{
+		DampingGroup& group = m_groups[m_activeGroups[a]];
+
+		std::fill(groupBlock, groupBlock + count, 0.0f);
+
+		for (int i = group.begin; i < group.begin + group.count; i++)
+		{
+			int readIdx = start - m_tapDelay[i];
+			if (readIdx < 0)
+				readIdx += size;
+
+			ring.accumulate(groupBlock, readIdx, count, m_tapGain[i]);
+		}
+
+		float last = group.last;
+
+		for (int j = 0; j < count; j++)
+		{
+			last = group.a0 * groupBlock[j] + group.b1 * last;
+			out[j] += last;
+		}
+
+		group.last = flushDenormal(last);
+	}
+}
+
+template <int TAPS>
+void MultiTapDelay::readFixed(const CircularBuffer& ring, float* out, int start, int count)
+{
+	const float* buffer = ring.getData();
+	const int size = ring.getSize();
+	float* groupBlock = m_groupBlock;
+
+	DampingGroup& group = m_groups[m_activeGroups[0]];
+	const float a0 = group.a0;
+	const float b1 = group.b1;
+
+	int readIdx[TAPS];
+	float gains[TAPS];
+
+	for (int k = 0; k < TAPS; k++)
+	{
+		readIdx[k] = start - m_tapDelay[group.begin + k];
+		if (readIdx[k] < 0)
+			readIdx[k] += size;
+
+		gains[k] = m_tapGain[group.begin + k];
+	}
+
+	float last = group.last;
+
+	// Runs end where a tap wraps, within one every tap is a plain pointer
+	while (count > 0)
+	{
+		int run = count;
+		for (int k = 0; k < TAPS; k++)
+			run = std::min(run, size - readIdx[k]);
+
+		const float* taps[TAPS];
+		for (int k = 0; k < TAPS; k++)
+			taps[k] = buffer + readIdx[k];
+
+		std::fill(groupBlock, groupBlock + run, 0.0f);
+		sumTaps<0, TAPS>(taps, gains, groupBlock, run);
+
+		for (int j = 0; j < run; j++)
+		{
+			last = a0 * groupBlock[j] + b1 * last;
+			out[j] = last;
+		}
+
+		out += run;
+		count -= run;
+
+		for (int k = 0; k < TAPS; k++)
+		{
+			readIdx[k] += run;
+			if (readIdx[k] == size)
+				readIdx[k] = 0;
+		}
+	}
+
+	group.last = flushDenormal(last);
+}
+
+void MultiTapDelay::readGroupsConvolved(float* out, int count)
+{
+	const ConvolutionIR& ir = *m_impulseResponse;
+	const ConvolutionIR::Channel& channel = ir.channels[m_impulseResponseChannel];
+	float* groupBlock = m_groupBlock;
+
+	std::fill(out, out + count, 0.0f);
+
+	// Same group filters as the direct path, only the sums are convolved
+	for (int g = channel.firstGroup; g < channel.firstGroup + channel.groupCount; g++)
+	{
+		const ConvolutionIR::Group& irGroup = ir.groups[g];
+		DampingGroup& group = m_groups[irGroup.group];
+
+		m_convolver->convolve(ir, irGroup, groupBlock);
+
+		float last = group.last;
+
+		for (int j = 0; j < count; j++)
+		{
+			last = group.a0 * groupBlock[j] + group.b1 * last;
+			out[j] += last;
+		}
+
+		group.last = flushDenormal(last);
+	}
+}
@@ -0,0 +1,212 @@
+/*
+  ==============================================================================
+
+    Sparse multi-tap delay. One ring buffer per channel is read by a table
+    of up to MAX_TAPS taps, from the handful of a preset to the thousands
+    of a high order image-source room.
+
+    The ring holds the undamped input, and damping is a one-pole per group
+    of taps with the same absorbtion, applied to the summed output of the
+    group. The filter is linear, so with one group this is the same as
+    damping the input once before it enters the ring, and every additional
+    group costs one filter per sample instead of one per tap. Resonance
+    turns the taps into damped combs of their own delay, see
+    ResonanceCombs, which add their recirculation on top.
+
+    The table is sorted by group, then by delay, so a block walks the ring
+    in cache order and a tap costs one multiply-add per sample. Single
+    group tables with the tap count of a fixed mode are read by a
+    specialization for that count, picked once when the taps are laid out.
+    It adds up to eight unrolled taps per pass over the block instead of
+    one, with the same result as the generic read.
+
+    The ring can keep its history in compact 16 bit storage, see
+    CircularBuffer. Dense tables without resonance can hand the group sums
+    to a PartitionedConvolver instead, and delays fed the same input can
+    all read their taps from one shared ring.
+
+    Every block is written to the ring before its taps are read.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "AbsorbtionTable.h"
+#include "CircularBuffer.h"
+#include "DelayArena.h"
+#include "PartitionedConvolver.h"
+#include "ResonanceCombs.h"
+#include "TapKernels.h"
+
+//==============================================================================
+class MultiTapDelay
+{
+public:
+	MultiTapDelay();
+
+	static const int MAX_TAPS = 2048;
+	static const int MAX_DAMPING_GROUPS = 8;
+
+	// The ring is one block longer than the longest tap, so a block can be
+	// written before its taps are read
+	static int getRingSize(int delayScale, int blockSize, DelayStorage storage = DelayStorage::Float)
+	{
+		return CircularBuffer::roundSize(CircularBuffer::sizeForDelayScale(delayScale) + blockSize, storage);
+	}
+
+	static size_t getRequiredStorage(int delayScale, int blockSize, int tapCapacity = MAX_TAPS,
+									 DelayStorage storage = DelayStorage::Float)
+	{
+		return DelayArena::roundUp(CircularBuffer::getStorageSize(getRingSize(delayScale, blockSize, storage), storage))
+			 + DelayArena::roundUp(blockSize)
+			 + DelayArena::roundUp((size_t)ResonanceCombs::LINES_PER_PASS * blockSize)
+			 + ResonanceCombs::getRequiredStorage(getRingSize(delayScale, blockSize, storage) - blockSize - 1)
+			 + 2 * DelayArena::roundUpFor<int>(tapCapacity)
+			 + DelayArena::roundUp(tapCapacity)
+			 + DelayArena::roundUpFor<Tap>(tapCapacity);
+	}
+
+	void init(DelayArena& arena, int delayScale, int blockSize, int tapCapacity = MAX_TAPS,
+			  DelayStorage storage = DelayStorage::Float)
+	{
+		const int size = getRingSize(delayScale, blockSize, storage);
+
+		m_buffer.init(arena.allocate(CircularBuffer::getStorageSize(size, storage)), size, delayScale, storage);
+		m_blockSize = blockSize;
+		m_lineBlock = arena.allocate((size_t)ResonanceCombs::LINES_PER_PASS * blockSize);
+		m_groupBlock = arena.allocate(blockSize);
+		m_combs.init(arena, getMaxDelay());
+
+		m_tapCapacity = tapCapacity;
+		m_tapDelay = arena.allocateFor<int>(tapCapacity);
+		m_tapIndex = arena.allocateFor<int>(tapCapacity);
+		m_tapGain = arena.allocate(tapCapacity);
+		m_tapScratch = arena.allocateFor<Tap>(tapCapacity);
+	}
+	void processBlock(const float* in, float* out, int count);
+	// Reads these taps from the ring of source, which has just processed the
+	// same input block of at most the block size. The own ring is left as it
+	// was.
+	void processBlockShared(const MultiTapDelay& source, float* out, int count);
+	// Continues from the history of source after shared blocks
+	void copyHistory(const MultiTapDelay& source) { m_buffer.copyFrom(source.m_buffer); }
+	void clear()
+	{
+		m_buffer.clear();
+		m_combs.clear();
+
+		for (auto& group : m_groups)
+			group.last = 0.0f;
+	}
+	void setAbsorbtion(float absorbtion)
+	{
+		setDamping(AbsorbtionTable::lookup(absorbtion));
+	}
+	// Base damping of every group
+	void setDamping(float a0)
+	{
+		for (int group = 0; group < MAX_DAMPING_GROUPS; group++)
+			setGroupDamping(group, a0);
+	}
+	void setGroupDamping(int group, float a0)
+	{
+		m_groups[group].a0 = a0;
+		m_groups[group].b1 = 1.0f - a0;
+	}
+	// Groups are indices below MAX_DAMPING_GROUPS, nullptr puts every tap in
+	// group 0. Real time safe, the table is sorted in place.
+	void setTaps(const float* factors, const float* gains, int count, const int* groups = nullptr);
+	void setTapDelays(const int* delays, const float* gains, int count, const int* groups = nullptr);
+	// New gains for the taps of the last setTaps call, in its order. Keeps
+	// the layout, so it is cheap enough for every few samples of a fade.
+	void setTapGains(const float* gains);
+	// The CPU's widest tap read kernels by default
+	void setKernels(const TapKernels& kernels) { m_buffer.setKernels(kernels); }
+	void set(float absorbtion, float feedback)
+	{
+		setAbsorbtion(absorbtion);
+		m_feedback = feedback;
+	}
+	void setFeedback(float feedback)
+	{
+		m_feedback = feedback;
+	}
+	int getTapCount() const { return m_tapCount; }
+	int getMaxDelay() const { return m_buffer.getSize() - m_blockSize - 1; }
+
+	// Optional, owned by the engine. Full blocks use the impulse response
+	// when it is set and the convolver history is complete.
+	void setConvolver(PartitionedConvolver* convolver) { m_convolver = convolver; }
+	void setImpulseResponse(const ConvolutionIR* ir, int channel)
+	{
+		m_impulseResponse = ir;
+		m_impulseResponseChannel = channel;
+	}
+
+private:
+	struct Tap
+	{
+		int delay;
+		float gain;
+		int group;
+		int index;
+	};
+
+	struct DampingGroup
+	{
+		int begin = 0;
+		int count = 0;
+		float a0 = 1.0f;
+		float b1 = 0.0f;
+		float last = 0.0f;
+	};
+
+	// Reads the taps of a block from the ring into out
+	typedef void (MultiTapDelay::*ReadFunction)(const CircularBuffer& ring, float* out, int start, int count);
+
+	void layoutTaps(int count);
+	void selectRead();
+	void selectLines();
+	void processWriteFirst(const float* in, float* out, int count);
+	void readGroups(const CircularBuffer& ring, float* out, int start, int count);
+	// One group of TAPS taps in float storage, all taps of a sample in one pass
+	template <int TAPS>
+	void readFixed(const CircularBuffer& ring, float* out, int start, int count);
+	void readGroupsConvolved(float* out, int count);
+	// Adds the resonance of the block of count samples from the ring index start
+	void addResonance(const CircularBuffer& ring, float* out, int start, int count);
+
+	CircularBuffer m_buffer = CircularBuffer();
+
+	ReadFunction m_read = &MultiTapDelay::readGroups;
+
+	// Tap table in arena memory, grouped and sorted by delay
+	int* m_tapDelay = nullptr;
+	// Position of each slot in the table as it was set
+	int* m_tapIndex = nullptr;
+	float* m_tapGain = nullptr;
+	Tap* m_tapScratch = nullptr;
+	int m_tapCapacity = 0;
+	int m_tapCount = 0;
+
+	DampingGroup m_groups[MAX_DAMPING_GROUPS];
+	int m_activeGroups[MAX_DAMPING_GROUPS] = {};
+	int m_activeGroupCount = 0;
+
+	PartitionedConvolver* m_convolver = nullptr;
+	const ConvolutionIR* m_impulseResponse = nullptr;
+	int m_impulseResponseChannel = 0;
+
+	// Block scratch
+	float* m_lineBlock = nullptr;
+	float* m_groupBlock = nullptr;
+	int m_blockSize = 0;
+
+	// Resonant taps as slots of the table, in the order the taps were set
+	ResonanceCombs m_combs;
+	int m_lineSlot[ResonanceCombs::MAX_LINES] = {};
+	int m_lineGroup[ResonanceCombs::MAX_LINES] = {};
+	int m_lineCount = 0;
+	float m_feedback = 0.0f;
+};
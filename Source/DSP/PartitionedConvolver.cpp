@@ -0,0 +1,166 @@
+/*
+  ==============================================================================
+
+    Uniformly partitioned overlap-save convolution of one channel.
+
+  ==============================================================================
+*/
+
+#include "PartitionedConvolver.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(_MSC_VER)
+ #define ER_RESTRICT __restrict
+#else
+ #define ER_RESTRICT __restrict__
+#endif
+
+//==============================================================================
+static inline void complexMultiplyAdd(float* ER_RESTRICT accRe, float* ER_RESTRICT accIm,
+									  const float* ER_RESTRICT aRe, const float* ER_RESTRICT aIm,
+									  const float* ER_RESTRICT bRe, const float* ER_RESTRICT bIm, int count)
+{
+	for (int i = 0; i < count; i++)
+	{
+		accRe[i] += aRe[i] * bRe[i] - aIm[i] * bIm[i];
+		accIm[i] += aRe[i] * bIm[i] + aIm[i] * bRe[i];
+	}
+}
+
+PartitionedConvolver::PartitionedConvolver()
+{
+}
+
+size_t PartitionedConvolver::getRequiredStorage(int partitionSize, int partitions)
+{
+	const size_t bins = (size_t)partitionSize + 1;
+
+	return 2 * partitions * DelayArena::roundUp(bins)
+		 + 2 * DelayArena::roundUp(bins)
+		 + 3 * DelayArena::roundUp(2 * (size_t)partitionSize);
+}
+
+void PartitionedConvolver::init(DelayArena& arena, const Fft& fft, int partitionSize, int partitions)
+{
+	m_fft = &fft;
+	m_partitionSize = partitionSize;
+	m_partitions = partitions;
+	m_bins = partitionSize + 1;
+
+	// History slots start on cache lines, like every arena slice
+	const size_t stride = DelayArena::roundUp(m_bins);
+	m_historyRe = arena.allocate(partitions * stride);
+	m_historyIm = arena.allocate(partitions * stride);
+	m_accumulatorRe = arena.allocate(m_bins);
+	m_accumulatorIm = arena.allocate(m_bins);
+	m_window = arena.allocate(2 * partitionSize);
+	m_time = arena.allocate(2 * partitionSize);
+	m_work = arena.allocate(2 * partitionSize);
+
+	m_current = 0;
+	m_valid = 0;
+}
+
+void PartitionedConvolver::setEnabled(bool enabled)
+{
+	if (!enabled)
+		m_valid = 0;
+
+	m_enabled = enabled;
+}
+
+bool PartitionedConvolver::push(const CircularBuffer& ring, int count)
+{
+	if (!m_enabled || m_fft == nullptr)
+		return false;
+
+	if (count != m_partitionSize)
+	{
+		m_valid = 0;
+		return false;
+	}
+
+	// Overlap-save window, the previous and the new block straight from the
+	// ring, so the history never depends on what the last block did
+	const int length = 2 * m_partitionSize;
+
+	int start = ring.getHead() - length;
+	if (start < 0)
+		start += ring.getSize();
+
+	ring.read(m_window, start, length);
+
+	m_current = m_current + 1 < m_partitions ? m_current + 1 : 0;
+
+	const size_t stride = DelayArena::roundUp(m_bins);
+	m_fft->forward(m_window, m_historyRe + m_current * stride, m_historyIm + m_current * stride, m_work);
+	m_valid = std::min(m_valid + 1, m_partitions);
+
+	return true;
+}
+
+bool PartitionedConvolver::pushShared(const PartitionedConvolver& source, int count)
+{
+	if (!m_enabled || m_fft == nullptr)
+		return false;
+
+	if (count != m_partitionSize || source.m_valid == 0)
+	{
+		m_valid = 0;
+		return false;
+	}
+
+	m_current = m_current + 1 < m_partitions ? m_current + 1 : 0;
+
+	const size_t stride = DelayArena::roundUp(m_bins);
+	const float* re = source.m_historyRe + source.m_current * stride;
+	const float* im = source.m_historyIm + source.m_current * stride;
+	std::copy(re, re + m_bins, m_historyRe + m_current * stride);
+	std::copy(im, im + m_bins, m_historyIm + m_current * stride);
+
+	// Never ahead of the history it copies from
+	m_valid = std::min(m_valid + 1, source.m_valid);
+
+	return true;
+}
+
+void PartitionedConvolver::convolve(const ConvolutionIR& ir, const ConvolutionIR::Group& group, float* out)
+{
+	const size_t stride = DelayArena::roundUp(m_bins);
+
+	std::fill(m_accumulatorRe, m_accumulatorRe + m_bins, 0.0f);
+	std::fill(m_accumulatorIm, m_accumulatorIm + m_bins, 0.0f);
+
+	for (int s = group.firstSegment; s < group.firstSegment + group.segmentCount; s++)
+	{
+		const ConvolutionIR::Segment& segment = ir.segments[s];
+
+		int slot = m_current - segment.partition;
+		if (slot < 0)
+			slot += m_partitions;
+
+		const float* irRe = ir.spectra.data() + segment.offset;
+		const float* irIm = irRe + ir.bins;
+
+		complexMultiplyAdd(m_accumulatorRe, m_accumulatorIm, irRe, irIm,
+						   m_historyRe + slot * stride, m_historyIm + slot * stride, m_bins);
+	}
+
+	// The first half of the window wraps around, the second half is the block
+	m_fft->inverse(m_accumulatorRe, m_accumulatorIm, m_time, m_work);
+	std::copy(m_time + m_partitionSize, m_time + 2 * m_partitionSize, out);
+}
+
+double PartitionedConvolver::estimateCost(int partitionSize, int groups, int segments)
+{
+	// In direct tap-sample units, measured with er_bench: a transform of n
+	// points and a complex multiply-add per bin each cost about three
+	// direct multiply-adds per n log2 n and per bin. One forward transform
+	// per block, one inverse per group.
+	const double n = 2.0 * partitionSize;
+	const double transform = 3.0 * n * std::log2(n);
+
+	return transform * (1 + groups) + 3.0 * (partitionSize + 1) * segments;
+}
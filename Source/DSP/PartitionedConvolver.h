@@ -0,0 +1,107 @@
+/*
+  ==============================================================================
+
+    Uniformly partitioned overlap-save convolution of one channel.
+
+    The partition is the engine block size, so a full block is convolved
+    with no added latency: the history of the last blocks is kept as a
+    delay line of spectra, every non empty IR partition adds one complex
+    multiply-add per bin and one inverse FFT per damping group gives the
+    block. The convolution replaces the sparse tap sums of MultiTapDelay
+    only, the damping filters stay where they are, so both paths share
+    their state and can take over from each other at any block.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <vector>
+
+#include "CircularBuffer.h"
+#include "DelayArena.h"
+#include "Fft.h"
+
+//==============================================================================
+// Rendered off the audio thread from a tap table, immutable once published.
+// Every channel lists its damping groups, every group its non empty
+// partitions with their spectra (bins real values, then bins imaginary).
+struct ConvolutionIR
+{
+	struct Segment
+	{
+		int partition;
+		size_t offset;
+	};
+
+	struct Group
+	{
+		int group;
+		int firstSegment;
+		int segmentCount;
+	};
+
+	struct Channel
+	{
+		int firstGroup = 0;
+		int groupCount = 0;
+	};
+
+	int partitionSize = 0;
+	int bins = 0;
+	int maxPartition = 0;
+
+	std::vector<Channel> channels;
+	std::vector<Group> groups;
+	std::vector<Segment> segments;
+	std::vector<float> spectra;
+};
+
+//==============================================================================
+class PartitionedConvolver
+{
+public:
+	PartitionedConvolver();
+
+	static size_t getRequiredStorage(int partitionSize, int partitions);
+	void init(DelayArena& arena, const Fft& fft, int partitionSize, int partitions);
+
+	// Disabled, push() skips the transforms and the history runs empty
+	void setEnabled(bool enabled);
+	bool isEnabled() const { return m_enabled; }
+
+	// After the ring received a block, transforms its last two blocks.
+	// Returns false and empties the history for any other block length.
+	bool push(const CircularBuffer& ring, int count);
+	// Same input as source, which has just pushed this block. Copies its
+	// spectrum instead of transforming the block again.
+	bool pushShared(const PartitionedConvolver& source, int count);
+	void invalidate() { m_valid = 0; }
+
+	// True once the history covers every partition of the IR
+	bool canConvolve(const ConvolutionIR& ir) const { return m_enabled && m_valid > ir.maxPartition; }
+	void convolve(const ConvolutionIR& ir, const ConvolutionIR::Group& group, float* out);
+
+	// Cost of one block in direct tap-sample units, compare with taps * partitionSize
+	static double estimateCost(int partitionSize, int groups, int segments);
+
+private:
+	const Fft* m_fft = nullptr;
+	int m_partitionSize = 0;
+	int m_partitions = 0;
+	int m_bins = 0;
+	bool m_enabled = false;
+
+	// Spectra of the last m_partitions blocks, m_current is the newest
+	float* m_historyRe = nullptr;
+	float* m_historyIm = nullptr;
+	int m_current = 0;
+	int m_valid = 0;
+
+	// Scratch
+	float* m_window = nullptr;
+	float* m_accumulatorRe = nullptr;
+	float* m_accumulatorIm = nullptr;
+	float* m_time = nullptr;
+	float* m_work = nullptr;
+};
@@ -0,0 +1,124 @@
+/*
+  ==============================================================================
+
+    Binary plugin state.
+
+  ==============================================================================
+*/
+
+#include "PluginState.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+//==============================================================================
+// Byte by byte, so the layout is the same on every host
+static void putUInt32(unsigned char* data, uint32_t value)
+{
+	data[0] = (unsigned char)value;
+	data[1] = (unsigned char)(value >> 8);
+	data[2] = (unsigned char)(value >> 16);
+	data[3] = (unsigned char)(value >> 24);
+}
+
+static uint32_t getUInt32(const unsigned char* data)
+{
+	return (uint32_t)data[0] | ((uint32_t)data[1] << 8) | ((uint32_t)data[2] << 16) | ((uint32_t)data[3] << 24);
+}
+
+static void putFloat(unsigned char* data, float value)
+{
+	uint32_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+	putUInt32(data, bits);
+}
+
+static float getFloat(const unsigned char* data)
+{
+	const uint32_t bits = getUInt32(data);
+	float value;
+	memcpy(&value, &bits, sizeof(value));
+	return value;
+}
+
+static float clamp(float value, float low, float high)
+{
+	return std::min(std::max(value, low), high);
+}
+
+//==============================================================================
+void PluginState::write(void* data) const
+{
+	unsigned char* bytes = static_cast<unsigned char*>(data);
+
+	putUInt32(bytes, MAGIC);
+	bytes[4] = (unsigned char)VERSION;
+	bytes[5] = (unsigned char)(VERSION >> 8);
+	bytes[6] = (unsigned char)FIELDS_SIZE;
+	bytes[7] = (unsigned char)(FIELDS_SIZE >> 8);
+
+	// Version 1
+	unsigned char* fields = bytes + HEADER_SIZE;
+	putFloat(fields + 0, size);
+	putFloat(fields + 4, absorbtion);
+	putFloat(fields + 8, attenuation);
+	putFloat(fields + 12, resonance);
+	putFloat(fields + 16, mix);
+	putFloat(fields + 20, volume);
+	fields[24] = (unsigned char)buttons;
+	fields[25] = (unsigned char)quality;
+	fields[26] = reducedRate ? 1 : 0;
+	fields[27] = 0;
+	putFloat(fields + 28, room.width);
+	putFloat(fields + 32, room.depth);
+	putFloat(fields + 36, room.height);
+	putUInt32(fields + 40, (uint32_t)room.order);
+	putFloat(fields + 44, room.wallAbsorption);
+}
+
+bool PluginState::read(const void* data, size_t dataSize)
+{
+	const unsigned char* bytes = static_cast<const unsigned char*>(data);
+
+	if (bytes == nullptr || dataSize < (size_t)HEADER_SIZE || getUInt32(bytes) != MAGIC)
+		return false;
+
+	const int version = bytes[4] | (bytes[5] << 8);
+	const int fieldsSize = bytes[6] | (bytes[7] << 8);
+
+	if (version < 1 || fieldsSize < VERSION_1_SIZE || (size_t)(HEADER_SIZE + fieldsSize) > dataSize)
+		return false;
+
+	const unsigned char* fields = bytes + HEADER_SIZE;
+	const float values[] = { getFloat(fields + 0), getFloat(fields + 4), getFloat(fields + 8),
+							 getFloat(fields + 12), getFloat(fields + 16), getFloat(fields + 20),
+							 getFloat(fields + 28), getFloat(fields + 32), getFloat(fields + 36),
+							 getFloat(fields + 44) };
+
+	for (float value : values)
+		if (!std::isfinite(value))
+			return false;
+
+	size = clamp(values[0], 0.0f, 1.0f);
+	absorbtion = clamp(values[1], 0.0f, 1.0f);
+	attenuation = clamp(values[2], 0.0f, 1.0f);
+	resonance = clamp(values[3], 0.0f, 1.0f);
+	mix = clamp(values[4], 0.0f, 1.0f);
+	volume = clamp(values[5], VOLUME_MIN, VOLUME_MAX);
+
+	// The lowest mode set wins like in the plugin, none falls back to A
+	const unsigned int modes = fields[24] & 0xfu;
+	buttons = modes != 0 ? modes & (0u - modes) : 1u;
+
+	quality = std::min((int)fields[25], QUALITY_COUNT - 1);
+	reducedRate = fields[26] != 0;
+
+	room.width = clamp(values[6], RoomGeometry::MIN_DIMENSION, RoomGeometry::MAX_DIMENSION);
+	room.depth = clamp(values[7], RoomGeometry::MIN_DIMENSION, RoomGeometry::MAX_DIMENSION);
+	room.height = clamp(values[8], RoomGeometry::MIN_DIMENSION, RoomGeometry::MAX_DIMENSION);
+	room.order = (int)std::min(std::max(getUInt32(fields + 40), 1u), (uint32_t)RoomGeometry::MAX_ORDER);
+	room.wallAbsorption = clamp(values[9], 0.0f, 1.0f);
+
+	return true;
+}
@@ -0,0 +1,61 @@
+/*
+  ==============================================================================
+
+    Binary plugin state.
+
+    SIZE bytes of fixed little endian layout: the magic, the version and
+    the byte size of the fields, then the fields in the order they were
+    added. Later versions only append fields, so every reader takes the
+    fields it knows from newer states and keeps the defaults for what an
+    older one lacks. Reading and writing never allocate, loading a session
+    full of instances is a copy per instance instead of an XML parse.
+
+    States saved before this format are XML, the plugin reads those too.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "RoomGeometry.h"
+
+//==============================================================================
+struct PluginState
+{
+	static const uint32_t MAGIC = 0x74735245;	// "ERst"
+	static const int VERSION = 1;
+	static const int HEADER_SIZE = 8;
+	// Fields every version has, and all fields of this version
+	static const int VERSION_1_SIZE = 48;
+	static const int FIELDS_SIZE = VERSION_1_SIZE;
+	static const int SIZE = HEADER_SIZE + FIELDS_SIZE;
+
+	// Ranges of the plugin parameters that are not 0 to 1
+	static constexpr float VOLUME_MIN = -12.0f;
+	static constexpr float VOLUME_MAX = 12.0f;
+	static const int QUALITY_COUNT = 3;
+
+	// Parameter values as the plugin exposes them
+	float size = 0.5f;
+	float absorbtion = 0.0f;
+	float attenuation = 1.0f;
+	float resonance = 0.0f;
+	float mix = 0.5f;
+	float volume = 0.0f;
+	// Mode buttons A to D from bit 0 up
+	unsigned int buttons = 1;
+	int quality = 0;
+
+	bool reducedRate = false;
+	RoomGeometry room;
+
+	// Writes SIZE bytes
+	void write(void* data) const;
+	// False when the data is no binary state or is damaged, this state is
+	// then left as it was. Values out of range are clamped into it like the
+	// parameters clamp an XML state, and exactly one mode button is kept.
+	bool read(const void* data, size_t size);
+};
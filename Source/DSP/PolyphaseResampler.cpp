@@ -0,0 +1,226 @@
+/*
+  ==============================================================================
+
+    Integer factor decimation and interpolation around the wet path.
+
+  ==============================================================================
+*/
+
+#include "PolyphaseResampler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#if defined(_MSC_VER)
+ #define ER_RESTRICT __restrict
+#else
+ #define ER_RESTRICT __restrict__
+#endif
+
+//==============================================================================
+// Eight independent partial sums, so the compiler can keep them in one
+// vector register without reassociating, count is a multiple of eight
+static inline float dot(const float* ER_RESTRICT a, const float* ER_RESTRICT b, int count)
+{
+	float sum[8] = {};
+	for (int i = 0; i < count; i += 8)
+		for (int lane = 0; lane < 8; lane++)
+			sum[lane] += a[i + lane] * b[i + lane];
+
+	return ((sum[0] + sum[4]) + (sum[1] + sum[5])) + ((sum[2] + sum[6]) + (sum[3] + sum[7]));
+}
+
+static inline void accumulate(float* ER_RESTRICT dst, const float* ER_RESTRICT src, float gain, int count)
+{
+	for (int i = 0; i < count; i++)
+		dst[i] += gain * src[i];
+}
+
+// Modified Bessel function of the first kind, order zero
+static double besselI0(double x)
+{
+	double term = 1.0;
+	double sum = 1.0;
+	for (int k = 1; k < 50 && term > sum * 1e-12; k++)
+	{
+		const double half = x / (2.0 * k);
+		term *= half * half;
+		sum += term;
+	}
+	return sum;
+}
+
+//==============================================================================
+PolyphaseFilter::PolyphaseFilter()
+{
+}
+
+int PolyphaseFilter::getFactor(double sampleRate, double minimumRate)
+{
+	int factor = 1;
+	while (factor * 2 <= MAX_FACTOR && sampleRate / (factor * 2) >= minimumRate)
+		factor *= 2;
+	return factor;
+}
+
+size_t PolyphaseFilter::getRequiredStorage(int factor)
+{
+	return 2 * DelayArena::roundUp((size_t)factor * TAPS_PER_PHASE);
+}
+
+void PolyphaseFilter::init(DelayArena& arena, int factor)
+{
+	const double pi = 3.14159265358979323846;
+
+	m_factor = std::max(1, std::min(factor, (int)MAX_FACTOR));
+
+	const int length = getLength();
+	m_reversed = arena.allocate(length);
+	m_phases = arena.allocate(length);
+
+	// Windowed sinc, cutoff in cycles per input sample
+	const double cutoff = 0.5 * CUTOFF / m_factor;
+	const double center = 0.5 * (length - 1);
+	const double windowNorm = besselI0(KAISER_BETA);
+
+	std::vector<double> h(length);
+	double sum = 0.0;
+
+	for (int k = 0; k < length; k++)
+	{
+		const double t = k - center;
+		const double sinc = t == 0.0 ? 2.0 * cutoff : std::sin(2.0 * pi * cutoff * t) / (pi * t);
+		const double r = 2.0 * t / (length - 1);
+		const double window = besselI0(KAISER_BETA * std::sqrt(std::max(0.0, 1.0 - r * r))) / windowNorm;
+
+		h[k] = sinc * window;
+		sum += h[k];
+	}
+
+	// Unity gain at DC, every interpolation phase sums to about one
+	for (int k = 0; k < length; k++)
+	{
+		h[k] /= sum;
+		m_reversed[length - 1 - k] = (float)h[k];
+	}
+
+	for (int phase = 0; phase < m_factor; phase++)
+	{
+		float* taps = m_phases + phase * TAPS_PER_PHASE;
+
+		for (int j = 0; j < TAPS_PER_PHASE; j++)
+			taps[TAPS_PER_PHASE - 1 - j] = (float)(m_factor * h[phase + j * m_factor]);
+	}
+}
+
+//==============================================================================
+PolyphaseDecimator::PolyphaseDecimator()
+{
+}
+
+size_t PolyphaseDecimator::getRequiredStorage(int factor, int maxCount)
+{
+	return DelayArena::roundUp((size_t)factor * PolyphaseFilter::TAPS_PER_PHASE - 1 + maxCount);
+}
+
+void PolyphaseDecimator::init(DelayArena& arena, const PolyphaseFilter& filter, int maxCount)
+{
+	m_filter = &filter;
+	m_history = arena.allocate(filter.getLength() - 1 + maxCount);
+	clear();
+}
+
+void PolyphaseDecimator::clear()
+{
+	std::fill(m_history, m_history + m_filter->getLength() - 1, 0.0f);
+	m_phase = 0;
+}
+
+int PolyphaseDecimator::process(const float* in, int count, float* out)
+{
+	const int factor = m_filter->getFactor();
+	const int length = m_filter->getLength();
+	const float* taps = m_filter->getReversed();
+	float* history = m_history;
+
+	std::copy(in, in + count, history + length - 1);
+
+	// Input i sits at history[length - 1 + i], so the output completed by
+	// input i is the dot product of the reversed filter with history[i...]
+	int produced = 0;
+	for (int i = factor - 1 - m_phase; i < count; i += factor)
+		out[produced++] = dot(taps, history + i, length);
+
+	std::copy(history + count, history + count + length - 1, history);
+	m_phase = (m_phase + count) % factor;
+
+	return produced;
+}
+
+//==============================================================================
+PolyphaseInterpolator::PolyphaseInterpolator()
+{
+}
+
+size_t PolyphaseInterpolator::getRequiredStorage(int factor, int maxCount)
+{
+	const int maxConsumed = (maxCount + factor - 1) / factor;
+	return DelayArena::roundUp(PolyphaseFilter::TAPS_PER_PHASE + maxConsumed) + DelayArena::roundUp(maxConsumed);
+}
+
+void PolyphaseInterpolator::init(DelayArena& arena, const PolyphaseFilter& filter, int maxCount)
+{
+	const int maxConsumed = (maxCount + filter.getFactor() - 1) / filter.getFactor();
+
+	m_filter = &filter;
+	m_history = arena.allocate(PolyphaseFilter::TAPS_PER_PHASE + maxConsumed);
+	m_phaseBlock = arena.allocate(maxConsumed);
+	clear();
+}
+
+void PolyphaseInterpolator::clear()
+{
+	std::fill(m_history, m_history + PolyphaseFilter::TAPS_PER_PHASE, 0.0f);
+	m_phase = 0;
+}
+
+void PolyphaseInterpolator::process(const float* in, float* out, int count)
+{
+	const int taps = PolyphaseFilter::TAPS_PER_PHASE;
+	const int factor = m_filter->getFactor();
+	const int consumed = (m_phase + count) / factor;
+	float* history = m_history;
+	float* phaseBlock = m_phaseBlock;
+
+	std::copy(in, in + consumed, history + taps);
+
+	// Output i lies (phase + i + 1) % factor samples after the latest reduced
+	// rate sample, history[taps - 1 + (phase + i + 1) / factor]. The zero
+	// stuffed samples in between only select the polyphase branch, so every
+	// branch filters one contiguous run of the history, a tap at a time.
+	for (int branch = 0; branch < factor; branch++)
+	{
+		int first = (branch - m_phase - 1) % factor;
+		if (first < 0)
+			first += factor;
+
+		if (first >= count)
+			continue;
+
+		const int outputs = (count - first + factor - 1) / factor;
+		const float* window = history + (m_phase + first + 1) / factor;
+		const float* coefficients = m_filter->getPhase(branch);
+
+		std::fill(phaseBlock, phaseBlock + outputs, 0.0f);
+
+		for (int t = 0; t < taps; t++)
+			accumulate(phaseBlock, window + t, coefficients[t], outputs);
+
+		for (int k = 0; k < outputs; k++)
+			out[first + k * factor] = phaseBlock[k];
+	}
+
+	std::copy(history + consumed, history + consumed + taps, history);
+	m_phase = (m_phase + count) % factor;
+}
@@ -0,0 +1,98 @@
+/*
+  ==============================================================================
+
+    Integer factor decimation and interpolation around the wet path.
+
+    Both directions share one Kaiser windowed sinc low pass of
+    TAPS_PER_PHASE * factor taps, evaluated only at the output positions
+    that are actually needed. A decimator and an interpolator fed the same
+    block lengths stay in the same phase, so every reduced rate sample the
+    decimator emits is consumed by the interpolator on the same input
+    sample.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "DelayArena.h"
+
+//==============================================================================
+class PolyphaseFilter
+{
+public:
+	PolyphaseFilter();
+
+	static const int TAPS_PER_PHASE = 24;
+	static const int MAX_FACTOR = 8;
+	static_assert(TAPS_PER_PHASE % 8 == 0, "Dot products run eight lanes wide");
+
+	// Passband edge as a fraction of the reduced Nyquist frequency, the
+	// transition band may alias into the top of the reduced band only
+	static constexpr float CUTOFF = 0.95f;
+	static constexpr float KAISER_BETA = 6.0f;
+
+	// Largest power of two that keeps the reduced rate at minimumRate or above
+	static int getFactor(double sampleRate, double minimumRate);
+
+	static size_t getRequiredStorage(int factor);
+	void init(DelayArena& arena, int factor);
+
+	int getFactor() const { return m_factor; }
+	int getLength() const { return m_factor * TAPS_PER_PHASE; }
+	// Group delay of decimation plus interpolation, in reduced rate samples
+	int getLatency() const { return TAPS_PER_PHASE - 1; }
+
+	// Whole filter reversed, for the decimator
+	const float* getReversed() const { return m_reversed; }
+	// Taps of one interpolation phase reversed and scaled by the factor
+	const float* getPhase(int phase) const { return m_phases + phase * TAPS_PER_PHASE; }
+
+private:
+	float* m_reversed = nullptr;
+	float* m_phases = nullptr;
+	int m_factor = 1;
+};
+
+//==============================================================================
+class PolyphaseDecimator
+{
+public:
+	PolyphaseDecimator();
+
+	static size_t getRequiredStorage(int factor, int maxCount);
+	void init(DelayArena& arena, const PolyphaseFilter& filter, int maxCount);
+	void clear();
+
+	// Returns the number of reduced rate samples written, at most
+	// (count + factor - 1) / factor
+	int process(const float* in, int count, float* out);
+
+private:
+	const PolyphaseFilter* m_filter = nullptr;
+	// Last length - 1 inputs followed by the current block
+	float* m_history = nullptr;
+	int m_phase = 0;
+};
+
+//==============================================================================
+class PolyphaseInterpolator
+{
+public:
+	PolyphaseInterpolator();
+
+	static size_t getRequiredStorage(int factor, int maxCount);
+	void init(DelayArena& arena, const PolyphaseFilter& filter, int maxCount);
+	void clear();
+
+	// Consumes the reduced rate samples a decimator produced for the same count
+	void process(const float* in, float* out, int count);
+
+private:
+	const PolyphaseFilter* m_filter = nullptr;
+	// Last TAPS_PER_PHASE reduced rate inputs followed by the current block
+	float* m_history = nullptr;
+	// Outputs of one polyphase branch
+	float* m_phaseBlock = nullptr;
+	int m_phase = 0;
+};
@@ -0,0 +1,209 @@
+/*
+  ==============================================================================
+
+    Reflection energy and levels for the editor display.
+
+  ==============================================================================
+*/
+
+#include "ReflectionMeter.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "EarlyReflectionsEngine.h"
+
+//==============================================================================
+// Eight partial sums, a single running sum is a serial dependency the
+// compiler does not vectorize without fast math
+static float getSumOfSquares(const float* samples, int count)
+{
+	float lanes[8] = {};
+	int sample = 0;
+
+	for (; sample + 8 <= count; sample += 8)
+		for (int lane = 0; lane < 8; lane++)
+			lanes[lane] += samples[sample + lane] * samples[sample + lane];
+
+	float sum = 0.0f;
+	for (; sample < count; sample++)
+		sum += samples[sample] * samples[sample];
+
+	for (float lane : lanes)
+		sum += lane;
+
+	return sum;
+}
+
+//==============================================================================
+ReflectionMeter::ReflectionMeter()
+{
+}
+
+double ReflectionMeter::getMaxSeconds()
+{
+	return ReflectionModes::TIME_MAX * EarlyReflectionsEngine::ROOM_SIZE_MAX;
+}
+
+void ReflectionMeter::prepare(double sampleRate)
+{
+	m_sliceSamples = std::max(1, (int)std::lround(sampleRate * SLICE_SECONDS));
+	m_frameSamples = std::max(1, (int)(sampleRate / FRAME_RATE));
+	m_frameSlices = std::max(1, m_frameSamples / m_sliceSamples);
+
+	// The longest tap plus one frame window
+	m_maxTapSlice = (int)std::ceil(getMaxSeconds() / SLICE_SECONDS);
+	m_sliceTotals.assign((size_t)(m_maxTapSlice + m_frameSlices + 2), 0.0);
+
+	m_tapSlice.assign(MultiTapDelay::MAX_TAPS, 0);
+	m_tapBin.assign(MultiTapDelay::MAX_TAPS, 0);
+	m_tapEnergyGain.assign(MultiTapDelay::MAX_TAPS, 0.0f);
+
+	// Starts over from silence on the next block
+	m_measuring = false;
+}
+
+bool ReflectionMeter::updateActive()
+{
+	const bool active = m_active.load(std::memory_order_acquire) && !m_sliceTotals.empty();
+
+	if (active && !m_measuring)
+	{
+		std::fill(m_sliceTotals.begin(), m_sliceTotals.end(), 0.0);
+		m_sliceHead = 0;
+		m_sliceCount = 0;
+		m_sliceSum = 0.0f;
+		m_frameCount = 0;
+		m_inputSum = 0.0;
+		m_outputSum = 0.0;
+		m_inputValues = 0;
+		m_outputValues = 0;
+		m_tapsValid = false;
+	}
+
+	m_measuring = active;
+	return active;
+}
+
+void ReflectionMeter::setConfig(const EngineConfig& config)
+{
+	if (!updateActive() || (m_tapsValid && config.tapsVersion == m_tapsVersion && config.pruneVersion == m_pruneVersion))
+		return;
+
+	const double slicesPerFactor = getMaxSeconds() / SLICE_SECONDS;
+
+	std::fill(m_frame.pattern, m_frame.pattern + ReflectionFrame::BINS, 0.0f);
+
+	const int count = std::min(config.tapCount, (int)MultiTapDelay::MAX_TAPS);
+	m_tapCount = 0;
+
+	// Only what the engine plays, taps the level of detail pruned are gone
+	for (int i = 0; i < count; i++)
+	{
+		if (!config.tapActive[i])
+			continue;
+
+		const float factor = std::min(std::max(config.tapFactors[i], 0.0f), 1.0f);
+		const float energyGain = config.tapGains[i] * config.tapGains[i];
+		const int tap = m_tapCount++;
+
+		m_tapSlice[tap] = std::min((int)(factor * slicesPerFactor + 0.5), m_maxTapSlice);
+		m_tapBin[tap] = std::min((int)(factor * ReflectionFrame::BINS), ReflectionFrame::BINS - 1);
+		m_tapEnergyGain[tap] = energyGain;
+		m_frame.pattern[m_tapBin[tap]] += energyGain;
+	}
+
+	m_frame.tapsVersion++;
+	m_tapsVersion = config.tapsVersion;
+	m_pruneVersion = config.pruneVersion;
+	m_tapsValid = true;
+}
+
+void ReflectionMeter::measureInput(const float* const* channels, int numChannels, int numSamples)
+{
+	if (!m_measuring || numChannels <= 0)
+		return;
+
+	// Runs up to the end of the current slice
+	for (int offset = 0; offset < numSamples; )
+	{
+		const int run = std::min(numSamples - offset, m_sliceSamples - m_sliceCount);
+		float sum = 0.0f;
+
+		for (int channel = 0; channel < numChannels; channel++)
+			sum += getSumOfSquares(channels[channel] + offset, run);
+
+		m_sliceSum += sum;
+		m_sliceCount += run;
+		m_inputSum += sum;
+		m_inputValues += (long long)run * numChannels;
+		offset += run;
+
+		if (m_sliceCount == m_sliceSamples)
+		{
+			const int slices = (int)m_sliceTotals.size();
+			const int previous = m_sliceHead > 0 ? m_sliceHead - 1 : slices - 1;
+
+			m_sliceTotals[m_sliceHead] = m_sliceTotals[previous] + m_sliceSum / ((double)m_sliceSamples * numChannels);
+			m_sliceHead = m_sliceHead + 1 < slices ? m_sliceHead + 1 : 0;
+			m_sliceCount = 0;
+			m_sliceSum = 0.0f;
+		}
+	}
+}
+
+void ReflectionMeter::measureOutput(const float* const* channels, int numChannels, int numSamples)
+{
+	if (!m_measuring || numChannels <= 0)
+		return;
+
+	float sum = 0.0f;
+
+	for (int channel = 0; channel < numChannels; channel++)
+		sum += getSumOfSquares(channels[channel], numSamples);
+
+	m_outputSum += sum;
+	m_outputValues += (long long)numSamples * numChannels;
+	m_frameCount += numSamples;
+
+	if (m_frameCount >= m_frameSamples)
+	{
+		pushFrame();
+		m_frameCount = 0;
+	}
+}
+
+void ReflectionMeter::pushFrame()
+{
+	const int slices = (int)m_sliceTotals.size();
+	const int newest = m_sliceHead > 0 ? m_sliceHead - 1 : slices - 1;
+	const double windowScale = 1.0 / m_frameSlices;
+
+	std::fill(m_frame.tapEnergy, m_frame.tapEnergy + ReflectionFrame::BINS, 0.0f);
+
+	// Each tap played the input of one frame window, as far back as its delay
+	for (int i = 0; i < m_tapCount; i++)
+	{
+		int end = newest - m_tapSlice[i];
+		if (end < 0)
+			end += slices;
+
+		int begin = end - m_frameSlices;
+		if (begin < 0)
+			begin += slices;
+
+		const double energy = (m_sliceTotals[end] - m_sliceTotals[begin]) * windowScale;
+		m_frame.tapEnergy[m_tapBin[i]] += m_tapEnergyGain[i] * (float)energy;
+	}
+
+	m_frame.inputEnergy = m_inputValues > 0 ? (float)(m_inputSum / m_inputValues) : 0.0f;
+	m_frame.outputEnergy = m_outputValues > 0 ? (float)(m_outputSum / m_outputValues) : 0.0f;
+
+	m_inputSum = 0.0;
+	m_outputSum = 0.0;
+	m_inputValues = 0;
+	m_outputValues = 0;
+
+	// A reader that fell behind only misses frames, it draws the latest one
+	m_queue.push(m_frame);
+}
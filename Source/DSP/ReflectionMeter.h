@@ -0,0 +1,105 @@
+/*
+  ==============================================================================
+
+    Reflection energy and levels for the editor display.
+
+    The audio thread keeps a running total of the input energy in 1 ms
+    slices over the longest reflection time. FRAME_RATE times a second it
+    takes the input energy each tap played during the last frame, weighs it
+    with the squared tap gain, sums the taps into BINS bins of reflection
+    time and pushes one ReflectionFrame with the input and output levels
+    into a wait-free queue. Nothing is measured while no display is active.
+
+    The tap energies follow the input and the tap gains only, damping and
+    resonance show in the output level.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <atomic>
+#include <vector>
+
+#include "EngineConfig.h"
+#include "SpscQueue.h"
+
+//==============================================================================
+struct ReflectionFrame
+{
+	static const int BINS = 64;
+
+	// Mean square of the reflections arriving now, per bin of reflection time
+	float tapEnergy[BINS] = {};
+	// Summed squared tap gains per bin, the shape of the pattern
+	float pattern[BINS] = {};
+	// Changes with the tap table and with the taps the engine pruned
+	unsigned int tapsVersion = 0;
+
+	// Mean square over the frame, all channels
+	float inputEnergy = 0.0f;
+	float outputEnergy = 0.0f;
+};
+
+//==============================================================================
+class ReflectionMeter
+{
+public:
+	ReflectionMeter();
+
+	static const int FRAME_RATE = 30;
+	static const int QUEUE_SIZE = 16;
+	static constexpr double SLICE_SECONDS = 0.001;
+
+	// Longest reflection time, the right edge of the last bin
+	static double getMaxSeconds();
+
+	// Not while the audio thread measures
+	void prepare(double sampleRate);
+
+	// Reader side, the audio thread skips all measuring while inactive
+	void setActive(bool active) { m_active.store(active, std::memory_order_release); }
+
+	// Audio thread, once per block in this order
+	void setConfig(const EngineConfig& config);
+	void measureInput(const float* const* channels, int numChannels, int numSamples);
+	void measureOutput(const float* const* channels, int numChannels, int numSamples);
+
+	// One reader thread at a time, false when no frame is waiting
+	bool pop(ReflectionFrame& frame) { return m_queue.pop(frame); }
+
+private:
+	bool updateActive();
+	void pushFrame();
+
+	SpscQueue<ReflectionFrame, QUEUE_SIZE> m_queue;
+	std::atomic<bool> m_active { false };
+	bool m_measuring = false;
+
+	// Running total of the input mean square per slice, a window is the
+	// difference of two totals
+	std::vector<double> m_sliceTotals;
+	int m_maxTapSlice = 0;
+	int m_frameSlices = 1;
+	int m_sliceHead = 0;
+	int m_sliceSamples = 48;
+	int m_sliceCount = 0;
+	float m_sliceSum = 0.0f;
+
+	// Tap table of the current config in slices and bins
+	std::vector<int> m_tapSlice;
+	std::vector<int> m_tapBin;
+	std::vector<float> m_tapEnergyGain;
+	int m_tapCount = 0;
+	unsigned int m_tapsVersion = 0;
+	unsigned int m_pruneVersion = 0;
+	bool m_tapsValid = false;
+
+	ReflectionFrame m_frame;
+	int m_frameSamples = 1600;
+	int m_frameCount = 0;
+	double m_inputSum = 0.0;
+	double m_outputSum = 0.0;
+	long long m_inputValues = 0;
+	long long m_outputValues = 0;
+};
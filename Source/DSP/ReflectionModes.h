@@ -0,0 +1,159 @@
+/*
+  ==============================================================================
+
+    Reflection patterns of the Room, Hall and HallEco modes.
+
+    Room times calculation:
+
+	// Room Delay
+	const float speedOfSound = 343.0f;
+
+	// Max dimensions
+	const float h = pow(m_roomSizeMax / 3.65f, 1.0f / 3.0f);
+	const float w = 1.6f * h;
+	const float d = 2.66f * h;
+
+	// Axial
+	const float axialHeightTime = h / speedOfSound;
+	const float axialWidthTime = w / speedOfSound;
+	const float axialDepthTime = d / speedOfSound;
+
+	// Tangential
+	const float tangentialHorizontal1Time = sqrt(d * d + 4.0f * w * w) / speedOfSound;
+	const float tangentialHorizontal2Time = sqrt(w * w + 4.0f * d * d) / speedOfSound;
+
+	const float tangentialVertical1Time = sqrt(d * d + 4.0f * h * h) / speedOfSound;
+	const float tangentialVertical2Time = sqrt(w * w + 4.0f * h * h) / speedOfSound;
+
+	Room gains calculation:
+
+	gain = 0.1224249 + 0.8558602 * exp(-40.69983 * time);
+
+  ==============================================================================
+*/
+
+#pragma once
+
+//==============================================================================
+enum class ReflectionMode
+{
+	Room,
+	Hall,
+	HallEco,
+	Custom
+};
+
+// Taps may be split into damping groups, each with an absorbtion added to
+// the Absorbtion parameter. Group 0 adds nothing, the fixed modes only use it.
+struct ReflectionPattern
+{
+	const float* times;
+	const float* gains;
+	int count;
+	float volumeCompensation;
+	const int* groups = nullptr;
+	const float* groupAbsorbtion = nullptr;
+	int groupCount = 1;
+};
+
+//==============================================================================
+namespace ReflectionModes
+{
+	constexpr int N_ROOM_DELAY_LINES = 7;
+	constexpr int N_HALL_ECO_DELAY_LINES = 6;
+	constexpr int N_HALL_DELAY_LINES = 18;
+
+	constexpr float roomDelayTimes[N_ROOM_DELAY_LINES] = {
+													0.0145f,
+													0.0187f,
+													0.0233f,
+													0.0242f,
+													0.0387f,
+													0.0303f,
+													0.0405f,
+	};
+
+	constexpr float roomDelayGains[N_ROOM_DELAY_LINES] = {
+													0.5968f,
+													0.5228f,
+													0.4540f,
+													0.4421f,
+													0.2996f,
+													0.3718f,
+													0.2871f
+	};
+
+	constexpr float hallEcoDelayTimes[N_HALL_ECO_DELAY_LINES] = {
+													0.0199f,
+													0.0354f,
+													0.0389f,
+													0.0414f,
+													0.0699f,
+													0.0796f,
+	};
+
+	constexpr float hallEcoDelayGains[N_HALL_ECO_DELAY_LINES] = {
+													1.200f,
+													0.818f,
+													0.635f,
+													0.719f,
+													0.267f,
+													0.242f
+	};
+
+	constexpr float hallDelayTimes[N_HALL_DELAY_LINES] = {
+													0.0043f,
+													0.0215f,
+													0.0225f,
+													0.0268f,
+													0.0270f,
+													0.0298f,
+													0.0458f,
+													0.0485f,
+													0.0572f,
+													0.0587f,
+													0.0595f,
+													0.0612f,
+													0.0707f,
+													0.0708f,
+													0.0726f,
+													0.0741f,
+													0.0753f,
+													0.0797f
+	};
+
+	constexpr float hallDelayGains[N_HALL_DELAY_LINES] = {
+													0.841f,
+													0.504f,
+													0.491f,
+													0.379f,
+													0.380f,
+													0.346f,
+													0.289f,
+													0.272f,
+													0.192f,
+													0.193f,
+													0.217f,
+													0.181f,
+													0.180f,
+													0.181f,
+													0.176f,
+													0.142f,
+													0.167f,
+													0.134f
+	};
+
+	// Longest tap of all modes, the Size parameter scales every pattern against it
+	constexpr float TIME_MAX = hallDelayTimes[N_HALL_DELAY_LINES - 1];
+
+	// Custom has no fixed table, the engine supplies its own tap set
+	inline ReflectionPattern getPattern(ReflectionMode mode)
+	{
+		if (mode == ReflectionMode::Hall)
+			return { hallDelayTimes, hallDelayGains, N_HALL_DELAY_LINES, 0.75f };
+		else if (mode == ReflectionMode::HallEco)
+			return { hallEcoDelayTimes, hallEcoDelayGains, N_HALL_ECO_DELAY_LINES, 0.6f };
+		else
+			return { roomDelayTimes, roomDelayGains, N_ROOM_DELAY_LINES, 1.0f };
+	}
+}
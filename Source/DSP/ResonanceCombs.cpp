@@ -0,0 +1,186 @@
+/*
+  ==============================================================================
+
+    Resonance combs of the multi-tap delays.
+
+  ==============================================================================
+*/
+
+#include "ResonanceCombs.h"
+
+#include <algorithm>
+
+#include "Denormals.h"
+
+//==============================================================================
+ResonanceCombs::ResonanceCombs()
+{
+}
+
+void ResonanceCombs::init(DelayArena& arena, int maxDelay)
+{
+	m_size = maxDelay + 1;
+	m_stride = DelayArena::roundUp((size_t)m_size);
+	m_lines = arena.allocate(MAX_LINES * m_stride);
+
+	clear();
+}
+
+void ResonanceCombs::clear()
+{
+	clearLines();
+
+	m_active = false;
+	m_starting = false;
+	m_drain = 0;
+}
+
+void ResonanceCombs::clearLines()
+{
+	if (m_lines != nullptr)
+		std::fill(m_lines, m_lines + MAX_LINES * m_stride, 0.0f);
+
+	std::fill(m_input, m_input + MAX_LINES, 0.0f);
+	std::fill(m_excess, m_excess + MAX_LINES, 0.0f);
+	m_head = 0;
+	m_dirty = false;
+}
+
+bool ResonanceCombs::begin(float feedback)
+{
+	m_feedback = feedback;
+
+	if (feedback != 0.0f)
+	{
+		// Leftovers of the last run would play again
+		if (!m_active && m_dirty)
+			clearLines();
+
+		m_starting = !m_active;
+		m_active = true;
+		m_dirty = true;
+		m_drain = m_size;
+	}
+
+	return m_active;
+}
+
+void ResonanceCombs::prime(int line, const float* history, int count, float a0, float b1)
+{
+	float input = m_input[line];
+
+	for (int j = 0; j < count; j++)
+		input = a0 * history[j] + b1 * input;
+
+	m_input[line] = flushDenormal(input);
+}
+
+void ResonanceCombs::process(int firstLine, const Line* lines, int lineCount, float* out, int count)
+{
+	switch (lineCount)
+	{
+		case 1: processLines<1>(firstLine, lines, out, count); break;
+		case 2: processLines<2>(firstLine, lines, out, count); break;
+		case 3: processLines<3>(firstLine, lines, out, count); break;
+		case 4: processLines<4>(firstLine, lines, out, count); break;
+		case 5: processLines<5>(firstLine, lines, out, count); break;
+		case 6: processLines<6>(firstLine, lines, out, count); break;
+		default: break;
+	}
+}
+
+template <int LINES>
+void ResonanceCombs::processLines(int firstLine, const Line* lines, float* out, int count)
+{
+	static_assert(LINES <= LINES_PER_PASS, "One pass at most");
+
+	float* ring[LINES];
+	const float* delayed[LINES];
+	int read[LINES];
+	float gain[LINES];
+	float feedbackA0[LINES];
+	float a0[LINES];
+	float b1[LINES];
+	float input[LINES];
+	float excess[LINES];
+
+	for (int k = 0; k < LINES; k++)
+	{
+		ring[k] = m_lines + (firstLine + k) * m_stride;
+		delayed[k] = lines[k].delayed;
+		read[k] = m_head - lines[k].delay;
+		if (read[k] < 0)
+			read[k] += m_size;
+		gain[k] = lines[k].gain;
+		feedbackA0[k] = m_feedback * lines[k].a0;
+		a0[k] = lines[k].a0;
+		b1[k] = lines[k].b1;
+		input[k] = m_input[firstLine + k];
+		excess[k] = m_excess[firstLine + k];
+	}
+
+	// What goes back into the rings stays out of the subnormal range, silence
+	// decays to exact zeros
+	int write = m_head;
+
+	for (int j = 0; j < count; )
+	{
+		// Up to the next wrap of any ring
+		int run = std::min(count - j, m_size - write);
+		for (int k = 0; k < LINES; k++)
+			run = std::min(run, m_size - read[k]);
+
+		for (int n = 0; n < run; n++)
+		{
+			float sum = 0.0f;
+
+			for (int k = 0; k < LINES; k++)
+			{
+				const float excessDelayed = ring[k][read[k] + n];
+
+				input[k] = a0[k] * delayed[k][j + n] + b1[k] * input[k];
+				excess[k] = feedbackA0[k] * (input[k] + excessDelayed) + b1[k] * excess[k];
+				ring[k][write + n] = flushDenormal(excess[k]);
+				sum += gain[k] * excessDelayed;
+			}
+
+			out[j + n] += sum;
+		}
+
+		for (int k = 0; k < LINES; k++)
+		{
+			read[k] += run;
+			if (read[k] == m_size)
+				read[k] = 0;
+		}
+
+		write += run;
+		if (write == m_size)
+			write = 0;
+
+		j += run;
+	}
+
+	for (int k = 0; k < LINES; k++)
+	{
+		m_input[firstLine + k] = flushDenormal(input[k]);
+		m_excess[firstLine + k] = flushDenormal(excess[k]);
+	}
+}
+
+void ResonanceCombs::end(int count)
+{
+	m_head += count % m_size;
+	if (m_head >= m_size)
+		m_head -= m_size;
+
+	m_starting = false;
+
+	// Without feedback the lines only play out what is left in them
+	if (m_feedback == 0.0f)
+	{
+		m_drain -= count;
+		if (m_drain <= 0)
+			m_active = false;
+	}
+}
@@ -0,0 +1,97 @@
+/*
+  ==============================================================================
+
+    Resonance of the multi-tap delays: every resonant tap is a damped comb
+    of its own delay, the line of the original plugin with its feedback.
+
+    A line of delay d and gain g sounds g * y(t - d) with
+    y = LP(x + feedback * y(t - d)). The damped input LP(x) delayed by d is
+    what the tap already plays without resonance, so the delay keeps its
+    undamped ring and its group filters, and a line only adds the excess
+    e = y - LP(x):
+
+        u(t) = LP(x(t - d))
+        e(t) = LP(feedback * (u(t) + e(t - d)))
+        out  += g * e(t - d)
+
+    Each line keeps u, e and a ring of e. Lines run while there is
+    resonance and one ring length after it was turned off, so what is
+    still on the way plays out like it did in the separate lines.
+
+    Up to MAX_LINES taps resonate, all taps of a fixed mode. Denser tables
+    resonate on their strongest taps.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "DelayArena.h"
+
+//==============================================================================
+class ResonanceCombs
+{
+public:
+	ResonanceCombs();
+
+	// Lines of the largest fixed mode
+	static const int MAX_LINES = 18;
+	// Lines run side by side, each recursion waits on its own last sample
+	static const int LINES_PER_PASS = 6;
+
+	struct Line
+	{
+		// delayed[n] = x(t - delay + n)
+		const float* delayed;
+		int delay;
+		float gain;
+		// Damping one-pole
+		float a0;
+		float b1;
+	};
+
+	static size_t getRequiredStorage(int maxDelay)
+	{
+		return MAX_LINES * DelayArena::roundUp((size_t)maxDelay + 1);
+	}
+
+	void init(DelayArena& arena, int maxDelay);
+	void clear();
+
+	// Once per block before the lines, false while there is nothing to add.
+	// The first active block after silence wants prime() for every line.
+	bool begin(float feedback);
+	bool isStarting() const { return m_starting; }
+
+	// Runs the input filter of a line over the count samples before its
+	// first block, history[n] = x(t - d - count + n)
+	void prime(int line, const float* history, int count, float a0, float b1);
+
+	// Adds the resonance of up to LINES_PER_PASS lines from firstLine on to
+	// out, delays at most maxDelay
+	void process(int firstLine, const Line* lines, int lineCount, float* out, int count);
+
+	// After all lines of the block
+	void end(int count);
+
+private:
+	void clearLines();
+
+	template <int LINES>
+	void processLines(int firstLine, const Line* lines, float* out, int count);
+
+	float* m_lines = nullptr;
+	size_t m_stride = 0;
+	int m_size = 0;
+	int m_head = 0;
+
+	float m_feedback = 0.0f;
+	int m_drain = 0;
+	bool m_active = false;
+	bool m_starting = false;
+	// Lines hold samples of an earlier run
+	bool m_dirty = false;
+
+	float m_input[MAX_LINES] = {};
+	float m_excess[MAX_LINES] = {};
+};
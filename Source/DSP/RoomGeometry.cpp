@@ -0,0 +1,131 @@
+/*
+  ==============================================================================
+
+    Tap set generator for custom shoebox rooms.
+
+  ==============================================================================
+*/
+
+#include "RoomGeometry.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <tuple>
+#include <vector>
+
+#include "ReflectionModes.h"
+#include "SharedCache.h"
+
+//==============================================================================
+namespace
+{
+	struct ImageTap
+	{
+		float time;
+		float gain;
+		int reflections;
+	};
+
+	float roomGainFit(float time)
+	{
+		return 0.1224249f + 0.8558602f * std::exp(-40.69983f * time);
+	}
+
+	float roomGainSum()
+	{
+		float sum = 0.0f;
+		for (int i = 0; i < ReflectionModes::N_ROOM_DELAY_LINES; i++)
+			sum += ReflectionModes::roomDelayGains[i];
+
+		return sum;
+	}
+}
+
+// A first order image is one dimension away, a room past TIME_MAX in every
+// dimension would have no taps at all
+static_assert(RoomGeometry::MAX_DIMENSION / RoomGeometryGenerator::SPEED_OF_SOUND < ReflectionModes::TIME_MAX,
+			  "The largest room must keep its first order reflections");
+
+void RoomGeometryGenerator::generate(const RoomGeometry& room, TapSet& taps)
+{
+	const float width = std::min(std::max(room.width, RoomGeometry::MIN_DIMENSION), RoomGeometry::MAX_DIMENSION);
+	const float depth = std::min(std::max(room.depth, RoomGeometry::MIN_DIMENSION), RoomGeometry::MAX_DIMENSION);
+	const float height = std::min(std::max(room.height, RoomGeometry::MIN_DIMENSION), RoomGeometry::MAX_DIMENSION);
+	const int order = std::min(std::max(room.order, 1), RoomGeometry::MAX_ORDER);
+	const float wallAbsorption = std::min(std::max(room.wallAbsorption, 0.0f), 0.99f);
+	const float reflectionGain = std::sqrt(1.0f - wallAbsorption);
+
+	// Mirrored images share their path length, only the positive octant is
+	// needed. Runs on the generator thread, so the list may allocate.
+	std::vector<ImageTap> images;
+
+	for (int x = 0; x <= order; x++)
+	{
+		for (int y = 0; x + y <= order; y++)
+		{
+			for (int z = 0; x + y + z <= order; z++)
+			{
+				if (x + y + z == 0)
+					continue;
+
+				const float dx = x * width;
+				const float dy = y * depth;
+				const float dz = z * height;
+				const float time = std::sqrt(dx * dx + dy * dy + dz * dz) / SPEED_OF_SOUND;
+
+				if (time > ReflectionModes::TIME_MAX)
+					continue;
+
+				images.push_back({ time, roomGainFit(time) * std::pow(reflectionGain, (float)(x + y + z)), x + y + z });
+			}
+		}
+	}
+
+	// Strongest first, then back into time order
+	const int count = std::min((int)images.size(), (int)MultiTapDelay::MAX_TAPS);
+	std::partial_sort(images.begin(), images.begin() + count, images.end(),
+					  [](const ImageTap& a, const ImageTap& b) { return a.gain > b.gain; });
+	std::sort(images.begin(), images.begin() + count, [](const ImageTap& a, const ImageTap& b) { return a.time < b.time; });
+
+	// One damping group per reflection count, the last one takes the rest
+	taps.groupCount = std::min(order, (int)MultiTapDelay::MAX_DAMPING_GROUPS);
+
+	for (int group = 0; group < taps.groupCount; group++)
+		taps.groupAbsorbtion[group] = std::min(1.0f, GROUP_ABSORBTION * wallAbsorption * group);
+
+	float gainSum = 0.0f;
+	for (int i = 0; i < count; i++)
+	{
+		taps.times[i] = images[i].time;
+		taps.gains[i] = images[i].gain;
+		taps.groups[i] = std::min(images[i].reflections, taps.groupCount) - 1;
+		gainSum += images[i].gain;
+	}
+
+	// Never louder than the Room mode
+	taps.count = count;
+	taps.volumeCompensation = gainSum > 0.0f ? std::min(1.0f, roomGainSum() / gainSum) : 1.0f;
+}
+
+std::shared_ptr<const TapSet> RoomGeometryGenerator::getShared(const RoomGeometry& room)
+{
+	static SharedCache<RoomGeometry, TapSet> cache;
+	static std::atomic<unsigned int> version { 0 };
+
+	return cache.get(room, [&room]
+	{
+		TapSet* taps = new TapSet();
+		generate(room, *taps);
+		taps->version = ++version;
+		return taps;
+	});
+}
+
+//==============================================================================
+bool RoomGeometry::operator<(const RoomGeometry& other) const
+{
+	return std::tie(width, depth, height, order, wallAbsorption)
+		 < std::tie(other.width, other.depth, other.height, other.order, other.wallAbsorption);
+}
@@ -0,0 +1,75 @@
+/*
+  ==============================================================================
+
+    Tap set generator for custom shoebox rooms.
+
+    Image sources of order up to RoomGeometry::order are placed around a
+    source and listener sitting together in the middle of the room, the
+    same setup the Room mode times were derived from. Each unique image
+    becomes a tap: its time is the path length over the speed of sound,
+    its gain the Room gain fit scaled by the wall absorption of every
+    reflection on the way. Higher orders also land in damping groups with
+    more absorbtion, so late reflections lose their highs first.
+
+    getShared() keeps one tap set per room for the whole process, every
+    instance set to the same room holds the same copy.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <memory>
+
+#include "MultiTapDelay.h"
+
+//==============================================================================
+// Dimensions in meters, absorption is the energy absorbed per reflection
+struct RoomGeometry
+{
+	float width = 4.0f;
+	float depth = 6.5f;
+	float height = 2.5f;
+	int order = 3;
+	float wallAbsorption = 0.3f;
+
+	static constexpr int MAX_ORDER = 24;
+	static constexpr float MIN_DIMENSION = 1.0f;
+	// The first order images of the largest room still fit in TIME_MAX
+	static constexpr float MAX_DIMENSION = 27.0f;
+
+	// Exact values, the parameters already sit on their own grid
+	bool operator<(const RoomGeometry& other) const;
+};
+
+// Times in seconds, fixed capacity so it can be copied on the audio thread.
+// The version tells the engine whether it already holds this set.
+struct TapSet
+{
+	float times[MultiTapDelay::MAX_TAPS] = {};
+	float gains[MultiTapDelay::MAX_TAPS] = {};
+	int groups[MultiTapDelay::MAX_TAPS] = {};
+	float groupAbsorbtion[MultiTapDelay::MAX_DAMPING_GROUPS] = {};
+	int groupCount = 1;
+	int count = 0;
+	float volumeCompensation = 1.0f;
+	unsigned int version = 0;
+};
+
+//==============================================================================
+namespace RoomGeometryGenerator
+{
+	constexpr float SPEED_OF_SOUND = 343.0f;
+
+	// Absorbtion added per reflection beyond the first, relative to the
+	// wall absorption
+	constexpr float GROUP_ABSORBTION = 0.25f;
+
+	// Keeps the strongest taps that fit in TIME_MAX, sorted by time
+	void generate(const RoomGeometry& room, TapSet& taps);
+
+	// Generated once per room in the process and shared. Every set gets its
+	// own version, the same room only shares it while the set is alive. Not
+	// on the audio thread.
+	std::shared_ptr<const TapSet> getShared(const RoomGeometry& room);
+}
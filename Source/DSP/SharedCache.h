@@ -0,0 +1,106 @@
+/*
+  ==============================================================================
+
+    Process wide cache of immutable objects, shared by all plugin instances.
+
+    Objects are created on first use and handed out as shared pointers to
+    const, the cache itself only keeps weak pointers. An object lives as
+    long as one instance holds it, so a session of many instances with the
+    same settings keeps one copy, and a new instance picks up the warm one
+    instead of computing it again. When two threads ask for the same key at
+    once, one creates the object and the other waits for it.
+
+    Locks and allocates, never call it on the audio thread.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <mutex>
+
+//==============================================================================
+template <typename Key, typename T>
+class SharedCache
+{
+public:
+	SharedCache() = default;
+
+	// create() returns a new T for the key, it runs without the lock held
+	template <typename Create>
+	std::shared_ptr<const T> get(const Key& key, Create create)
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+
+		for (;;)
+		{
+			auto it = m_entries.find(key);
+
+			if (it == m_entries.end())
+				break;
+
+			if (std::shared_ptr<const T> object = it->second.object.lock())
+				return object;
+
+			if (!it->second.pending)
+				break;
+
+			m_created.wait(lock);
+		}
+
+		m_entries[key].pending = true;
+		lock.unlock();
+
+		std::shared_ptr<const T> object;
+
+		try
+		{
+			object = std::shared_ptr<const T>(create());
+		}
+		catch (...)
+		{
+			lock.lock();
+			m_entries.erase(key);
+			m_created.notify_all();
+			throw;
+		}
+
+		lock.lock();
+		removeExpired();
+		m_entries[key] = { object, false };
+		m_created.notify_all();
+
+		return object;
+	}
+
+	// Objects alive in the process
+	size_t size()
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		removeExpired();
+		return m_entries.size();
+	}
+
+private:
+	struct Entry
+	{
+		std::weak_ptr<const T> object;
+		bool pending = false;
+	};
+
+	void removeExpired()
+	{
+		for (auto it = m_entries.begin(); it != m_entries.end(); )
+			it = !it->second.pending && it->second.object.expired() ? m_entries.erase(it) : std::next(it);
+	}
+
+	std::mutex m_mutex;
+	std::condition_variable m_created;
+	std::map<Key, Entry> m_entries;
+
+	SharedCache(const SharedCache&) = delete;
+	SharedCache& operator=(const SharedCache&) = delete;
+};
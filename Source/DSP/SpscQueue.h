@@ -0,0 +1,73 @@
+/*
+  ==============================================================================
+
+    Wait-free queue from one producer thread to one consumer thread.
+
+    Fixed capacity, no allocation after construction. Each side owns one
+    index and only reads the other, so push and pop are a load, a copy and
+    a store. A full queue rejects the push, the producer never waits.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+
+//==============================================================================
+template <typename T, int Capacity>
+class SpscQueue
+{
+public:
+	static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+	SpscQueue()
+		: m_items(new T[Capacity])
+	{
+	}
+
+	// Producer. False when the queue is full, the item is dropped.
+	bool push(const T& item)
+	{
+		const unsigned int write = m_write.load(std::memory_order_relaxed);
+
+		if (write - m_read.load(std::memory_order_acquire) >= (unsigned int)Capacity)
+			return false;
+
+		m_items[write & MASK] = item;
+		m_write.store(write + 1, std::memory_order_release);
+		return true;
+	}
+
+	// Consumer. False when the queue is empty.
+	bool pop(T& item)
+	{
+		const unsigned int read = m_read.load(std::memory_order_relaxed);
+
+		if (read == m_write.load(std::memory_order_acquire))
+			return false;
+
+		item = m_items[read & MASK];
+		m_read.store(read + 1, std::memory_order_release);
+		return true;
+	}
+
+	// Either side, a snapshot that may be stale by the time it is used
+	int getNumReady() const
+	{
+		return (int)(m_write.load(std::memory_order_acquire) - m_read.load(std::memory_order_acquire));
+	}
+
+private:
+	static const unsigned int MASK = (unsigned int)Capacity - 1;
+
+	std::unique_ptr<T[]> m_items;
+
+	// On their own cache lines, each is written by one side only
+	alignas(64) std::atomic<unsigned int> m_write { 0 };
+	alignas(64) std::atomic<unsigned int> m_read { 0 };
+
+	SpscQueue(const SpscQueue&) = delete;
+	SpscQueue& operator=(const SpscQueue&) = delete;
+};
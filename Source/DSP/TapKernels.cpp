@@ -0,0 +1,129 @@
+/*
+  ==============================================================================
+
+    Tap read kernels of CircularBuffer.
+
+  ==============================================================================
+*/
+
+#include "TapKernels.h"
+
+#if defined(_M_X64) || defined(__x86_64__)
+ #define ER_KERNELS_X64 1
+ #include <immintrin.h>
+ #if defined(_MSC_VER)
+  #include <intrin.h>
+ #endif
+#elif defined(__aarch64__) || defined(_M_ARM64)
+ #define ER_KERNELS_NEON 1
+#endif
+
+#if defined(_MSC_VER)
+ #define ER_RESTRICT __restrict
+#else
+ #define ER_RESTRICT __restrict__
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+ #define ER_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#else
+ #define ER_TARGET_AVX2
+#endif
+
+//==============================================================================
+// The compiler vectorizes both with the SIMD of the baseline instruction
+// set, SSE2 on x86-64 and NEON on arm64
+static void accumulateScalar(float* ER_RESTRICT dst, const float* ER_RESTRICT src, float gain, int count)
+{
+	for (int i = 0; i < count; i++)
+		dst[i] += gain * src[i];
+}
+
+static void accumulateCompactScalar(float* dst, const int16_t* src, float gain, int count)
+{
+	for (int i = 0; i < count; i++)
+		dst[i] += gain * (float)src[i];
+}
+
+#if ER_KERNELS_X64
+//==============================================================================
+// Eight samples per load and one fused multiply-add, twice the SSE2 width
+ER_TARGET_AVX2 static void accumulateAVX2(float* dst, const float* src, float gain, int count)
+{
+	const __m256 vGain = _mm256_set1_ps(gain);
+	int i = 0;
+
+	for (; i + 8 <= count; i += 8)
+		_mm256_storeu_ps(dst + i, _mm256_fmadd_ps(vGain, _mm256_loadu_ps(src + i), _mm256_loadu_ps(dst + i)));
+
+	for (; i < count; i++)
+		dst[i] += gain * src[i];
+}
+
+// Eight samples per load, twice the SSE2 width, and the reason compact
+// storage can beat float on dense tables
+ER_TARGET_AVX2 static void accumulateCompactAVX2(float* dst, const int16_t* src, float gain, int count)
+{
+	const __m256 vGain = _mm256_set1_ps(gain);
+	int i = 0;
+
+	for (; i + 8 <= count; i += 8)
+	{
+		const __m256i samples = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i*)(src + i)));
+		const __m256 converted = _mm256_cvtepi32_ps(samples);
+		_mm256_storeu_ps(dst + i, _mm256_fmadd_ps(vGain, converted, _mm256_loadu_ps(dst + i)));
+	}
+
+	for (; i < count; i++)
+		dst[i] += gain * (float)src[i];
+}
+
+static bool cpuHasAVX2()
+{
+   #if defined(_MSC_VER)
+	int info[4];
+	__cpuid(info, 0);
+	if (info[0] < 7)
+		return false;
+
+	__cpuid(info, 1);
+	const bool fma = (info[2] & (1 << 12)) != 0;
+	const bool osxsave = (info[2] & (1 << 27)) != 0;
+	if (!fma || !osxsave || (_xgetbv(0) & 0x6) != 0x6)
+		return false;
+
+	__cpuidex(info, 7, 0);
+	return (info[1] & (1 << 5)) != 0;
+   #else
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+   #endif
+}
+#endif
+
+//==============================================================================
+const TapKernels& getScalarTapKernels()
+{
+	static const TapKernels kernels = { accumulateScalar, accumulateCompactScalar, "Scalar" };
+	return kernels;
+}
+
+static TapKernels selectTapKernels()
+{
+   #if ER_KERNELS_X64
+	if (cpuHasAVX2())
+		return { accumulateAVX2, accumulateCompactAVX2, "AVX2" };
+
+	return { accumulateScalar, accumulateCompactScalar, "SSE2" };
+   #elif ER_KERNELS_NEON
+	return { accumulateScalar, accumulateCompactScalar, "NEON" };
+   #else
+	return getScalarTapKernels();
+   #endif
+}
+
+const TapKernels& getTapKernels()
+{
+	static const TapKernels kernels = selectTapKernels();
+	return kernels;
+}
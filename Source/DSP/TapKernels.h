@@ -0,0 +1,33 @@
+/*
+  ==============================================================================
+
+    Tap read kernels of CircularBuffer. A tap of a block is one run of the
+    ring added to the output with the tap gain, from float or from compact
+    16 bit storage. Every block read of MultiTapDelay goes through them.
+
+    getTapKernels() picks the widest variant the CPU supports at runtime, so
+    the same binary runs on every x86-64 machine. The scalar variant is the
+    reference the others must match.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <cstdint>
+
+//==============================================================================
+struct TapKernels
+{
+	// Adds gain times count samples to dst
+	typedef void (*AccumulateFunction)(float* dst, const float* src, float gain, int count);
+	// Adds gain times count 16 bit samples to dst
+	typedef void (*AccumulateCompactFunction)(float* dst, const int16_t* src, float gain, int count);
+
+	AccumulateFunction accumulate;
+	AccumulateCompactFunction accumulateCompact;
+	const char* name;
+};
+
+const TapKernels& getTapKernels();
+const TapKernels& getScalarTapKernels();
@@ -0,0 +1,43 @@
+/*
+  ==============================================================================
+
+    Maps tap factors to per channel delays in samples. Every channel but
+    the first lengthens its taps by a multiple of DECORRELATION_SAMPLES,
+    the right channel of stereo by exactly one, the others by a fixed hash
+    of channel and tap, so multichannel renders are reproducible.
+
+    Shared by the delay lines and the impulse response renderer, which
+    must land every tap on the same sample.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+//==============================================================================
+namespace TapLayout
+{
+	constexpr int DECORRELATION_SAMPLES = 30;
+	constexpr float DECORRELATION_MAX = 2.0f;
+
+	inline float getDecorrelation(int channel, int tap)
+	{
+		if (channel == 0)
+			return 0.0f;
+		if (channel == 1)
+			return 1.0f;
+
+		unsigned int h = (unsigned int)channel * 73856093u ^ (unsigned int)tap * 19349663u;
+		h ^= h >> 13;
+		h *= 0x5bd1e995u;
+		h ^= h >> 15;
+
+		return 0.5f + (DECORRELATION_MAX - 0.5f) * (float)(h & 0xffff) / 65535.0f;
+	}
+
+	inline int getTapDelay(int delayScale, int channel, int tap, float factor)
+	{
+		const float channelScale = delayScale + getDecorrelation(channel, tap) * DECORRELATION_SAMPLES;
+		return (int)(2.0f + channelScale * factor * 0.98f);
+	}
+}
@@ -0,0 +1,51 @@
+/*
+  ==============================================================================
+
+    Generates custom room tap sets in the background.
+
+  ==============================================================================
+*/
+
+#include "TapSetPublisher.h"
+
+//==============================================================================
+TapSetPublisher::~TapSetPublisher()
+{
+	if (m_worker != nullptr)
+		m_worker->remove(this);
+}
+
+void TapSetPublisher::request(const RoomGeometry& room)
+{
+	if (m_worker == nullptr)
+	{
+		m_worker = BackgroundWorker::getShared();
+		m_worker->add(this);
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_request = room;
+		m_hasRequest = true;
+	}
+
+	m_worker->post(this);
+}
+
+//==============================================================================
+void TapSetPublisher::runBackgroundJob()
+{
+	RoomGeometry room;
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		if (!m_hasRequest)
+			return;
+
+		room = m_request;
+		m_hasRequest = false;
+	}
+
+	m_published.publish(new std::shared_ptr<const TapSet>(RoomGeometryGenerator::getShared(room)));
+}
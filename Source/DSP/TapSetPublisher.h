@@ -0,0 +1,56 @@
+/*
+  ==============================================================================
+
+    Generates custom room tap sets in the background and hands them to a
+    single consumer through an AtomicPublisher. Sets come from the process
+    wide cache, a room another instance already uses is not generated
+    again.
+
+    Every publisher is a client of the shared BackgroundWorker, started by
+    the first request(), so instances do not each keep a generator thread.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <memory>
+#include <mutex>
+
+#include "AtomicPublisher.h"
+#include "BackgroundWorker.h"
+#include "RoomGeometry.h"
+
+//==============================================================================
+class TapSetPublisher : private BackgroundWorker::Client
+{
+public:
+	TapSetPublisher() = default;
+	~TapSetPublisher() override;
+
+	// Message thread. Only the latest request is generated.
+	void request(const RoomGeometry& room);
+
+	// One consumer thread at a time. The returned set stays valid until
+	// release(), nullptr until the first set is published.
+	const TapSet* acquire()
+	{
+		const std::shared_ptr<const TapSet>* taps = m_published.acquire();
+		return taps != nullptr ? taps->get() : nullptr;
+	}
+	void release() { m_published.release(); }
+
+private:
+	void runBackgroundJob() override;
+
+	AtomicPublisher<std::shared_ptr<const TapSet>> m_published;
+
+	std::mutex m_mutex;
+	RoomGeometry m_request;
+	bool m_hasRequest = false;
+
+	std::shared_ptr<BackgroundWorker> m_worker;
+
+	TapSetPublisher(const TapSetPublisher&) = delete;
+	TapSetPublisher& operator=(const TapSetPublisher&) = delete;
+};
@@ -0,0 +1,61 @@
+/*
+  ==============================================================================
+
+    Wait-free handover of the latest value from one producer to one
+    consumer.
+
+    Three slots rotate between the producer (back), the handover (middle)
+    and the consumer (front). Publishing and acquiring are each a single
+    atomic exchange of the middle slot, so neither side ever waits, and a
+    value the consumer did not pick up in time is simply overwritten.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+
+//==============================================================================
+template <typename T>
+class TripleBuffer
+{
+public:
+	TripleBuffer()
+		: m_slots(new T[3])
+	{
+	}
+
+	// Producer. The slot is one of the consumer's earlier values, every
+	// field has to be written before publish().
+	T& getWriteBuffer() { return m_slots[m_back]; }
+
+	void publish()
+	{
+		m_back = m_middle.exchange(m_back | NEW_VALUE, std::memory_order_acq_rel) & INDEX_MASK;
+	}
+
+	// Consumer, the reference stays valid until the next acquire()
+	const T& acquire()
+	{
+		if ((m_middle.load(std::memory_order_relaxed) & NEW_VALUE) != 0)
+			m_front = m_middle.exchange(m_front, std::memory_order_acq_rel) & INDEX_MASK;
+
+		return m_slots[m_front];
+	}
+
+private:
+	static const int INDEX_MASK = 3;
+	static const int NEW_VALUE = 4;
+
+	std::unique_ptr<T[]> m_slots;
+	std::atomic<int> m_middle { 1 };
+
+	// Owned by one side each
+	int m_back = 2;
+	int m_front = 0;
+
+	TripleBuffer(const TripleBuffer&) = delete;
+	TripleBuffer& operator=(const TripleBuffer&) = delete;
+};
@@ -0,0 +1,79 @@
+/*
+  ==============================================================================
+
+    Fixed set of worker threads draining a FIFO job queue.
+
+  ==============================================================================
+*/
+
+#include "WorkerPool.h"
+
+#include <algorithm>
+
+//==============================================================================
+WorkerPool::WorkerPool(int numThreads)
+{
+	if (numThreads <= 0)
+		numThreads = std::max(1, (int)std::thread::hardware_concurrency());
+
+	for (int i = 0; i < numThreads; i++)
+		m_threads.emplace_back([this] { run(); });
+}
+
+WorkerPool::~WorkerPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_exit = true;
+	}
+
+	m_jobAvailable.notify_all();
+
+	for (auto& thread : m_threads)
+		thread.join();
+}
+
+void WorkerPool::submit(std::function<void()> job)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_jobs.push_back(std::move(job));
+	}
+
+	m_jobAvailable.notify_one();
+}
+
+void WorkerPool::wait()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_idle.wait(lock, [this] { return m_jobs.empty() && m_busy == 0; });
+}
+
+void WorkerPool::run()
+{
+	for (;;)
+	{
+		std::function<void()> job;
+
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_jobAvailable.wait(lock, [this] { return m_exit || !m_jobs.empty(); });
+
+			if (m_jobs.empty())
+				return;
+
+			job = std::move(m_jobs.front());
+			m_jobs.pop_front();
+			m_busy++;
+		}
+
+		job();
+
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_busy--;
+		}
+
+		m_idle.notify_all();
+	}
+}
@@ -0,0 +1,44 @@
+/*
+  ==============================================================================
+
+    Fixed set of worker threads draining a FIFO job queue. Used by the
+    offline render tool, never from the audio thread.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//==============================================================================
+class WorkerPool
+{
+public:
+	// 0 threads uses one per hardware core
+	explicit WorkerPool(int numThreads = 0);
+	~WorkerPool();
+
+	void submit(std::function<void()> job);
+	void wait();
+	int getNumThreads() const { return (int)m_threads.size(); }
+
+private:
+	void run();
+
+	std::vector<std::thread> m_threads;
+	std::deque<std::function<void()>> m_jobs;
+	std::mutex m_mutex;
+	std::condition_variable m_jobAvailable;
+	std::condition_variable m_idle;
+	int m_busy = 0;
+	bool m_exit = false;
+
+	WorkerPool(const WorkerPool&) = delete;
+	WorkerPool& operator=(const WorkerPool&) = delete;
+};
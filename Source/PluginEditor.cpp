@@ -9,10 +9,27 @@
 #include "PluginProcessor.h"
 #include "PluginEditor.h"
 
+//==============================================================================
+namespace
+{
+	enum RoomSlider
+	{
+		RoomWidth,
+		RoomDepth,
+		RoomHeight,
+		RoomOrder,
+		RoomAbsorption
+	};
+
+	const char* const roomSliderNames[] = { "Width", "Depth", "Height", "Order", "Walls" };
+}
+
 //==============================================================================
 
 EarlyReflectionsAudioProcessorEditor::EarlyReflectionsAudioProcessorEditor (EarlyReflectionsAudioProcessor& p, juce::AudioProcessorValueTreeState& vts)
-    : AudioProcessorEditor (&p), audioProcessor (p), valueTreeState(vts)
+    : AudioProcessorEditor (&p), audioProcessor (p), valueTreeState(vts),
+      reflectionDisplay(p.getMeter(), juce::Colour::fromHSV(HUE * 0.01f, 0.5f, 0.3f, 1.0f),
+                        juce::Colour::fromHSV(HUE * 0.01f, 0.4f, 0.9f, 1.0f))
 {
 	juce::Colour light = juce::Colour::fromHSV(HUE * 0.01f, 0.5f, 0.6f, 1.0f);
 	juce::Colour medium = juce::Colour::fromHSV(HUE * 0.01f, 0.5f, 0.5f, 1.0f);
@@ -44,32 +61,154 @@ EarlyReflectionsAudioProcessorEditor::EarlyReflectionsAudioProcessorEditor (Earl
 	addAndMakeVisible(typeAButton);
 	addAndMakeVisible(typeBButton);
 	addAndMakeVisible(typeCButton);
+	addAndMakeVisible(typeDButton);
 
 	typeAButton.setRadioGroupId(TYPE_BUTTON_GROUP);
 	typeBButton.setRadioGroupId(TYPE_BUTTON_GROUP);
 	typeCButton.setRadioGroupId(TYPE_BUTTON_GROUP);
+	typeDButton.setRadioGroupId(TYPE_BUTTON_GROUP);
 
 	typeAButton.setClickingTogglesState(true);
 	typeBButton.setClickingTogglesState(true);
 	typeCButton.setClickingTogglesState(true);
+	typeDButton.setClickingTogglesState(true);
 
 	buttonAAttachment.reset(new juce::AudioProcessorValueTreeState::ButtonAttachment(valueTreeState, "ButtonA", typeAButton));
 	buttonBAttachment.reset(new juce::AudioProcessorValueTreeState::ButtonAttachment(valueTreeState, "ButtonB", typeBButton));
 	buttonCAttachment.reset(new juce::AudioProcessorValueTreeState::ButtonAttachment(valueTreeState, "ButtonC", typeCButton));
+	buttonDAttachment.reset(new juce::AudioProcessorValueTreeState::ButtonAttachment(valueTreeState, "ButtonD", typeDButton));
 
 	typeAButton.setColour(juce::TextButton::buttonColourId, light);
 	typeBButton.setColour(juce::TextButton::buttonColourId, light);
 	typeCButton.setColour(juce::TextButton::buttonColourId, light);
+	typeDButton.setColour(juce::TextButton::buttonColourId, light);
+
+	// Reduced rate wet path, not a parameter since it reallocates the engine
+	addAndMakeVisible(reducedRateButton);
+	reducedRateButton.setClickingTogglesState(true);
+	reducedRateButton.setToggleState(audioProcessor.getReducedRate(), juce::dontSendNotification);
+	reducedRateButton.onClick = [this] { audioProcessor.setReducedRate(reducedRateButton.getToggleState()); };
+	reducedRateButton.setColour(juce::TextButton::buttonColourId, light);
+	reducedRateButton.setColour(juce::TextButton::buttonOnColourId, dark);
+
+	// Level of detail, items before the attachment so it can select one
+	addAndMakeVisible(qualityBox);
+	qualityBox.addItemList({ "Full", "Balanced", "Eco" }, 1);
+	qualityBox.setColour(juce::ComboBox::backgroundColourId, light);
+	qualityAttachment.reset(new juce::AudioProcessorValueTreeState::ComboBoxAttachment(valueTreeState, "Quality", qualityBox));
 
 	typeAButton.setColour(juce::TextButton::buttonOnColourId, dark);
 	typeBButton.setColour(juce::TextButton::buttonOnColourId, dark);
 	typeCButton.setColour(juce::TextButton::buttonOnColourId, dark);
+	typeDButton.setColour(juce::TextButton::buttonOnColourId, dark);
+
+	// Custom room, generated in the background when a slider moves
+	for (int i = 0; i < N_ROOM_SLIDERS_COUNT; i++)
+	{
+		auto& label = m_roomLabels[i];
+		auto& slider = m_roomSliders[i];
 
-	setSize((int)(SLIDER_WIDTH * 0.01f * SCALE * N_SLIDERS_COUNT), (int)((SLIDER_WIDTH + BOTTOM_MENU_HEIGHT) * 0.01f * SCALE));
+		label.setText(roomSliderNames[i], juce::dontSendNotification);
+		label.setFont(juce::Font(14.0f * 0.01f * SCALE));
+		label.setJustificationType(juce::Justification::centred);
+		addAndMakeVisible(label);
+
+		slider.setSliderStyle(juce::Slider::SliderStyle::LinearBar);
+		slider.setColour(juce::Slider::trackColourId, light);
+		addAndMakeVisible(slider);
+	}
+
+	m_roomSliders[RoomWidth].setRange(RoomGeometry::MIN_DIMENSION, RoomGeometry::MAX_DIMENSION, 0.1);
+	m_roomSliders[RoomDepth].setRange(RoomGeometry::MIN_DIMENSION, RoomGeometry::MAX_DIMENSION, 0.1);
+	m_roomSliders[RoomHeight].setRange(RoomGeometry::MIN_DIMENSION, RoomGeometry::MAX_DIMENSION, 0.1);
+	m_roomSliders[RoomOrder].setRange(1.0, RoomGeometry::MAX_ORDER, 1.0);
+	m_roomSliders[RoomAbsorption].setRange(0.0, 1.0, 0.01);
+
+	for (int i = RoomWidth; i <= RoomHeight; i++)
+		m_roomSliders[i].setTextValueSuffix(" m");
+
+	updateRoomSliders();
+
+	for (auto& slider : m_roomSliders)
+		slider.onValueChange = [this] { roomSlidersChanged(); };
+
+	// Loaded states and other changes of the room show up in the sliders,
+	// hosts may load them on any thread
+	valueTreeState.state.addListener(this);
+
+	typeDButton.onStateChange = [this] { updateRoomEnabled(); };
+	updateRoomEnabled();
+
+	// Tap pattern and energy
+	addAndMakeVisible(reflectionDisplay);
+
+#if ER_INSTRUMENTATION
+	addAndMakeVisible(profileView);
+#endif
+
+	setSize((int)(SLIDER_WIDTH * 0.01f * SCALE * N_SLIDERS_COUNT),
+			(int)((SLIDER_WIDTH + DISPLAY_HEIGHT + ROOM_MENU_HEIGHT + BOTTOM_MENU_HEIGHT) * 0.01f * SCALE));
 }
 
 EarlyReflectionsAudioProcessorEditor::~EarlyReflectionsAudioProcessorEditor()
 {
+	valueTreeState.state.removeListener(this);
+	cancelPendingUpdate();
+}
+
+//==============================================================================
+void EarlyReflectionsAudioProcessorEditor::roomSlidersChanged()
+{
+	RoomGeometry room;
+	room.width = (float)m_roomSliders[RoomWidth].getValue();
+	room.depth = (float)m_roomSliders[RoomDepth].getValue();
+	room.height = (float)m_roomSliders[RoomHeight].getValue();
+	room.order = (int)m_roomSliders[RoomOrder].getValue();
+	room.wallAbsorption = (float)m_roomSliders[RoomAbsorption].getValue();
+
+	audioProcessor.setCustomRoom(room);
+}
+
+void EarlyReflectionsAudioProcessorEditor::updateRoomSliders()
+{
+	const RoomGeometry room = audioProcessor.getCustomRoom();
+
+	m_roomSliders[RoomWidth].setValue(room.width, juce::dontSendNotification);
+	m_roomSliders[RoomDepth].setValue(room.depth, juce::dontSendNotification);
+	m_roomSliders[RoomHeight].setValue(room.height, juce::dontSendNotification);
+	m_roomSliders[RoomOrder].setValue(room.order, juce::dontSendNotification);
+	m_roomSliders[RoomAbsorption].setValue(room.wallAbsorption, juce::dontSendNotification);
+}
+
+void EarlyReflectionsAudioProcessorEditor::updateRoomEnabled()
+{
+	// The room only shapes the D mode
+	const bool custom = typeDButton.getToggleState();
+
+	for (auto& slider : m_roomSliders)
+		slider.setEnabled(custom);
+}
+
+void EarlyReflectionsAudioProcessorEditor::valueTreePropertyChanged(juce::ValueTree& tree, const juce::Identifier& property)
+{
+	juce::ignoreUnused(property);
+
+	// Parameters live in child trees and have their own attachments
+	if (tree == valueTreeState.state)
+		triggerAsyncUpdate();
+}
+
+void EarlyReflectionsAudioProcessorEditor::valueTreeRedirected(juce::ValueTree& tree)
+{
+	juce::ignoreUnused(tree);
+	triggerAsyncUpdate();
+}
+
+void EarlyReflectionsAudioProcessorEditor::handleAsyncUpdate()
+{
+	// State and preset loads change the room and the rate outside the editor
+	updateRoomSliders();
+	reducedRateButton.setToggleState(audioProcessor.getReducedRate(), juce::dontSendNotification);
 }
 
 //==============================================================================
@@ -95,11 +234,36 @@ void EarlyReflectionsAudioProcessorEditor::resized()
 		m_labels[i].setBounds(rectangles[i]);
 	}
 
+	// Display
+	const int displayHeight = (int)(DISPLAY_HEIGHT * 0.01f * SCALE);
+	const int margin = (int)(LABEL_OFFSET * 0.01f * SCALE * 0.5f);
+	reflectionDisplay.setBounds(margin, height, getWidth() - 2 * margin, displayHeight);
+
+	// Custom room
+	const int roomY = height + displayHeight;
+	const int roomHeight = (int)(ROOM_MENU_HEIGHT * 0.01f * SCALE);
+	const int roomWidth = (getWidth() - 2 * margin) / N_ROOM_SLIDERS_COUNT;
+
+	for (int i = 0; i < N_ROOM_SLIDERS_COUNT; i++)
+	{
+		const int x = margin + i * roomWidth;
+		m_roomLabels[i].setBounds(x, roomY, roomWidth, roomHeight / 2);
+		m_roomSliders[i].setBounds(x + margin / 2, roomY + roomHeight / 2, roomWidth - margin, roomHeight / 2);
+	}
+
 	// Buttons
-	const int posY = height + (int)(BOTTOM_MENU_HEIGHT * 0.01f * SCALE * 0.25f);
+	const int posY = roomY + roomHeight + (int)(BOTTOM_MENU_HEIGHT * 0.01f * SCALE * 0.25f);
 	const int buttonHeight = (int)(BOTTOM_MENU_HEIGHT * 0.01f * SCALE * 0.5f);
 
-	typeAButton.setBounds((int)(getWidth() * 0.5f - buttonHeight * 1.8f), posY, buttonHeight, buttonHeight);
-	typeBButton.setBounds((int)(getWidth() * 0.5f - buttonHeight * 0.6f), posY, buttonHeight, buttonHeight);
-	typeCButton.setBounds((int)(getWidth() * 0.5f + buttonHeight * 0.6f), posY, buttonHeight, buttonHeight);
+	typeAButton.setBounds((int)(getWidth() * 0.5f - buttonHeight * 2.4f), posY, buttonHeight, buttonHeight);
+	typeBButton.setBounds((int)(getWidth() * 0.5f - buttonHeight * 1.2f), posY, buttonHeight, buttonHeight);
+	typeCButton.setBounds((int)(getWidth() * 0.5f), posY, buttonHeight, buttonHeight);
+	typeDButton.setBounds((int)(getWidth() * 0.5f + buttonHeight * 1.2f), posY, buttonHeight, buttonHeight);
+
+	reducedRateButton.setBounds(getWidth() - buttonHeight * 3, posY, buttonHeight * 2, buttonHeight);
+	qualityBox.setBounds(getWidth() - buttonHeight * 8, posY, buttonHeight * 4, buttonHeight);
+
+#if ER_INSTRUMENTATION
+	profileView.setBounds(buttonHeight, posY, (int)(getWidth() * 0.5f - buttonHeight * 3.4f), buttonHeight);
+#endif
 }
@@ -10,17 +10,22 @@
 
 #include <JuceHeader.h>
 #include "PluginProcessor.h"
+#include "ProfileView.h"
+#include "ReflectionDisplay.h"
 
 //==============================================================================
 /**
 */
-class EarlyReflectionsAudioProcessorEditor  : public juce::AudioProcessorEditor
+class EarlyReflectionsAudioProcessorEditor  : public juce::AudioProcessorEditor,
+                                              private juce::ValueTree::Listener,
+                                              private juce::AsyncUpdater
 {
 public:
     EarlyReflectionsAudioProcessorEditor (EarlyReflectionsAudioProcessor&, juce::AudioProcessorValueTreeState&);
     ~EarlyReflectionsAudioProcessorEditor() override;
 
 	static const int N_SLIDERS_COUNT = 6;
+	static const int N_ROOM_SLIDERS_COUNT = 5;
 	static const int SCALE = 70;
 	static const int LABEL_OFFSET = 25;
 	static const int SLIDER_WIDTH = 200;
@@ -28,6 +33,8 @@ public:
 
 	static const int TYPE_BUTTON_GROUP = 1;
 	static const int BOTTOM_MENU_HEIGHT = 50;
+	static const int DISPLAY_HEIGHT = 100;
+	static const int ROOM_MENU_HEIGHT = 50;
 
     //==============================================================================
     void paint (juce::Graphics&) override;
@@ -36,6 +43,15 @@ public:
 	typedef juce::AudioProcessorValueTreeState::SliderAttachment SliderAttachment;
 
 private:
+	// Custom room of the D mode, kept in the state tree by the processor
+	void roomSlidersChanged();
+	void updateRoomSliders();
+	void updateRoomEnabled();
+
+	void valueTreePropertyChanged(juce::ValueTree& tree, const juce::Identifier& property) override;
+	void valueTreeRedirected(juce::ValueTree& tree) override;
+	void handleAsyncUpdate() override;
+
     EarlyReflectionsAudioProcessor& audioProcessor;
 
 	juce::AudioProcessorValueTreeState& valueTreeState;
@@ -44,13 +60,27 @@ private:
 	juce::Slider m_sliders[N_SLIDERS_COUNT] = {};
 	std::unique_ptr<SliderAttachment> m_sliderAttachment[N_SLIDERS_COUNT] = {};
 
+	juce::Label m_roomLabels[N_ROOM_SLIDERS_COUNT] = {};
+	juce::Slider m_roomSliders[N_ROOM_SLIDERS_COUNT] = {};
+
 	juce::TextButton typeAButton{ "A" };
 	juce::TextButton typeBButton{ "B" };
 	juce::TextButton typeCButton{ "C" };
+	juce::TextButton typeDButton{ "D" };
+	juce::TextButton reducedRateButton{ "48k" };
+	juce::ComboBox qualityBox;
 
 	std::unique_ptr<juce::AudioProcessorValueTreeState::ButtonAttachment> buttonAAttachment;
 	std::unique_ptr<juce::AudioProcessorValueTreeState::ButtonAttachment> buttonBAttachment;
 	std::unique_ptr<juce::AudioProcessorValueTreeState::ButtonAttachment> buttonCAttachment;
+	std::unique_ptr<juce::AudioProcessorValueTreeState::ButtonAttachment> buttonDAttachment;
+	std::unique_ptr<juce::AudioProcessorValueTreeState::ComboBoxAttachment> qualityAttachment;
+
+	ReflectionDisplay reflectionDisplay;
+
+#if ER_INSTRUMENTATION
+	ProfileView profileView{ audioProcessor.getProfiler() };
+#endif
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (EarlyReflectionsAudioProcessorEditor)
 };
@@ -9,58 +9,6 @@
 #include "PluginProcessor.h"
 #include "PluginEditor.h"
 
-//==============================================================================
-CircularBuffer::CircularBuffer()
-{
-}
-
-void CircularBuffer::init(int size)
-{
-	m_head = 0;
-	m_size = size;
-
-	m_buffer = NULL;
-	m_buffer = new float[size];
-	memset(m_buffer, 0, size * sizeof(float));
-}
-
-void CircularBuffer::clear()
-{
-	m_head = 0;
-	memset(m_buffer, 0, sizeof(m_buffer));
-}
-
-float CircularBuffer::readDelay(int sample)
-{
-	const int bufferSize = m_size;
-	int readIdx = m_head + bufferSize - sample;
-
-	if (readIdx >= bufferSize)
-		readIdx = readIdx - bufferSize;
-
-	return m_buffer[readIdx];
-}
-
-float CircularBuffer::readFactor(float factor)
-{
-	float sample = (int)(2.0f + m_size * factor * 0.98f);
-	return readDelay(sample);
-}
-
-//==============================================================================
-SimpleDelay::SimpleDelay()
-{
-}
-
-float SimpleDelay::process(float in)
-{
-	float bufferOut = m_buffer.readFactor(m_factor);
-	m_last = m_a0 * (in + bufferOut * m_feedback) + m_b1 * m_last;	
-	m_buffer.writeSample(m_last);
-	
-	return m_attenuation * bufferOut;
-}
-
 //==============================================================================
 const std::string EarlyReflectionsAudioProcessor::paramsNames[] = { "Size", "Absorbtion", "Attenuation", "Resonance", "Mix", "Volume" };
 
@@ -76,6 +24,10 @@ EarlyReflectionsAudioProcessor::EarlyReflectionsAudioProcessor()
                        )
 #endif
 {
+	// Builds the config on parameter changes, before the first listener call
+	m_worker = BackgroundWorker::getShared();
+	m_worker->add(this);
+
 	sizeParameter		 = apvts.getRawParameterValue(paramsNames[0]);
 	absorbtionParameter  = apvts.getRawParameterValue(paramsNames[1]);
 	attenuationParameter = apvts.getRawParameterValue(paramsNames[2]);
@@ -86,10 +38,33 @@ EarlyReflectionsAudioProcessor::EarlyReflectionsAudioProcessor()
 	buttonAParameter = static_cast<juce::AudioParameterBool*>(apvts.getParameter("ButtonA"));
 	buttonBParameter = static_cast<juce::AudioParameterBool*>(apvts.getParameter("ButtonB"));
 	buttonCParameter = static_cast<juce::AudioParameterBool*>(apvts.getParameter("ButtonC"));
+	buttonDParameter = static_cast<juce::AudioParameterBool*>(apvts.getParameter("ButtonD"));
+	qualityParameter = static_cast<juce::AudioParameterChoice*>(apvts.getParameter("Quality"));
+
+	for (const auto& name : paramsNames)
+		apvts.addParameterListener(name, this);
+
+	for (const auto* name : { "ButtonA", "ButtonB", "ButtonC", "ButtonD", "Quality" })
+		apvts.addParameterListener(name, this);
+
+	m_defaultTaps = RoomGeometryGenerator::getShared(RoomGeometry());
+	setCustomRoom(RoomGeometry());
+
+	updateConfig(true);
+	startTimerHz(100);
 }
 
 EarlyReflectionsAudioProcessor::~EarlyReflectionsAudioProcessor()
 {
+	stopTimer();
+
+	for (const auto& name : paramsNames)
+		apvts.removeParameterListener(name, this);
+
+	for (const auto* name : { "ButtonA", "ButtonB", "ButtonC", "ButtonD", "Quality" })
+		apvts.removeParameterListener(name, this);
+
+	m_worker->remove(this);
 }
 
 //==============================================================================
@@ -127,7 +102,7 @@ bool EarlyReflectionsAudioProcessor::isMidiEffect() const
 
 double EarlyReflectionsAudioProcessor::getTailLengthSeconds() const
 {
-    return 0.0;
+    return m_tailLength.load();
 }
 
 int EarlyReflectionsAudioProcessor::getNumPrograms()
@@ -157,21 +132,22 @@ void EarlyReflectionsAudioProcessor::changeProgramName (int index, const juce::S
 //==============================================================================
 void EarlyReflectionsAudioProcessor::prepareToPlay (double sampleRate, int samplesPerBlock)
 {
-	int samplesMax = MINIMUM_BUFFER_SIZE + int(m_hallDelayTimes[N_HALL_DELAY_LINES - 1] * ROOM_SIZE_MAX * sampleRate);
-
-	// TO DO: Optimize delay lines sizes
-	for (int i = 0; i < N_HALL_DELAY_LINES; i++)
-	{
-		m_delayLine[0][i].init(samplesMax, (int)sampleRate);
-		m_delayLine[1][i].init(samplesMax + STEREO_ADDITION, (int)sampleRate);
-	}
-	
-	clearCircularBuffers();
+	m_wetRate = getReducedRate() ? WetRate::Reduced : WetRate::Full;
+	m_engine.setWetRate(m_wetRate);
+	m_engine.prepare(sampleRate, samplesPerBlock, getTotalNumOutputChannels());
+	m_meter.prepare(sampleRate);
+	m_prepared = true;
+
+#if ER_INSTRUMENTATION
+	m_profiler.prepare(sampleRate);
+#endif
 }
 
 void EarlyReflectionsAudioProcessor::releaseResources()
 {
-	clearCircularBuffers();
+	m_engine.release();
+	m_offlinePool.reset();
+	m_prepared = false;
 }
 
 #ifndef JucePlugin_PreferredChannelConfigurations
@@ -181,12 +157,12 @@ bool EarlyReflectionsAudioProcessor::isBusesLayoutSupported (const BusesLayout&
     juce::ignoreUnused (layouts);
     return true;
   #else
-    // This is the place where you check if the layout is supported.
-    // In this template code we only support mono or stereo.
-    // Some plugin hosts, such as certain GarageBand versions, will only
-    // load plugins that support stereo bus layouts.
-    if (layouts.getMainOutputChannelSet() != juce::AudioChannelSet::mono()
-     && layouts.getMainOutputChannelSet() != juce::AudioChannelSet::stereo())
+    // Any layout up to the engine limit, surround and ambisonics included.
+    // Every channel gets its own decorrelated set of reflections.
+    const int numChannels = layouts.getMainOutputChannelSet().size();
+
+    if (layouts.getMainOutputChannelSet().isDisabled()
+     || numChannels > EarlyReflectionsEngine::MAX_CHANNELS)
         return false;
 
     // This checks if the input layout matches the output layout
@@ -202,81 +178,118 @@ bool EarlyReflectionsAudioProcessor::isBusesLayoutSupported (const BusesLayout&
 
 void EarlyReflectionsAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
 {
-	// Get params
-	const float size = 0.01f + 0.99f * sizeParameter->load();
-	const float absorbtion = absorbtionParameter->load();
-	const float attenuation = attenuationParameter->load();
-	const float resonance = resonanceParameter->load();
-	const float mix = mixParameter->load();
-	const float volume = juce::Decibels::decibelsToGain(volumeParameter->load());
-
-	// Buttons
-	const auto buttonA = buttonAParameter->get();
-	const auto buttonB = buttonBParameter->get();
-	const auto buttonC = buttonCParameter->get();
-
-	// Constants
-	const int channels = getTotalNumOutputChannels();
-	const int samples = buffer.getNumSamples();
-	const float mixInverse = 1.0f - mix;
-	
-	// Early reflection setup
-	int delaLinesCount = 0;
-	float volumeCompensation = 1.0f;
-	const float timeMax = m_hallDelayTimes[N_HALL_DELAY_LINES - 1];
-	const float attenuationInverse = 1.0f - attenuation;
-	const float *times;
-	const float *gains;
-
-	if (buttonA)
-	{
-		delaLinesCount = N_ROOM_DELAY_LINES;
-		times = m_roomDelayTimes;
-		gains = m_roomDelayGains;
-	}
-	else if(buttonB)
-	{
-		delaLinesCount = N_HALL_DELAY_LINES;
-		volumeCompensation = 0.75;
-		times = m_hallDelayTimes;
-		gains = m_hallDelayGains;
-	}
-	else
-	{
-		delaLinesCount = N_HALL_ECO_DELAY_LINES;
-		volumeCompensation = 0.6;
-		times = m_hallEcoDelayTimes;
-		gains = m_hallEcoDelayGains;
-	}
+#if ER_INSTRUMENTATION
+	const long long profileStart = BlockProfiler::now();
+#endif
 
-	for (int i = 0; i < delaLinesCount; i++)
+	// Offline renders get every parameter change on the block it happens,
+	// in real time the worker builds it. Wake it again until it did, in
+	// case it missed the wake of the change.
+	if (isNonRealtime())
+		updateConfig(true);
+	else if (m_configDirty.load())
+		m_worker->wake(this);
+
+	const EngineConfig& config = m_configBuffer.acquire();
+	m_engine.setConfig(config);
+
+	const int numChannels = getTotalNumOutputChannels();
+	m_meter.setConfig(config);
+	m_meter.measureInput(buffer.getArrayOfReadPointers(), numChannels, buffer.getNumSamples());
+
+	// The pool blocks and allocates, only use it when the host is not running
+	// in real time. Its threads start with the first offline render of a wide
+	// layout, sessions that never bounce one never create them.
+	WorkerPool* pool = nullptr;
+
+	if (isNonRealtime() && numChannels > 2)
 	{
-		const float gain = volumeCompensation * (gains[i] + (1.0f - gains[i]) * attenuationInverse);
-		const float factor = size * times[i] / timeMax;
+		if (m_offlinePool == nullptr)
+			m_offlinePool = std::make_unique<WorkerPool>();
 
-		m_delayLine[0][i].set(factor, absorbtion, gain, resonance);
-		m_delayLine[1][i].set(factor, absorbtion, gain, resonance);
+		pool = m_offlinePool.get();
 	}
 
-	// Process samples
-	for (int channel = 0; channel < channels; ++channel)
-	{
-		auto* channelBuffer = buffer.getWritePointer(channel);
+	m_engine.process(buffer.getArrayOfWritePointers(), numChannels, buffer.getNumSamples(), pool);
 
-		for (int sample = 0; sample < samples; ++sample)
-		{
-			const float in = channelBuffer[sample];
+	m_meter.measureOutput(buffer.getArrayOfReadPointers(), numChannels, buffer.getNumSamples());
 
-			float out = 0.0f;
+#if ER_INSTRUMENTATION
+	m_profiler.record(profileStart, buffer.getNumSamples(), m_engine.getActiveTapCount(), m_engine.getMode(),
+					  m_engine.isIdle(), m_engine.isHistoryShared());
+#endif
+}
 
-			for (int i = 0; i < delaLinesCount; i++)
-			{
-				out += m_delayLine[channel][i].process(in);
-			}
+//==============================================================================
+void EarlyReflectionsAudioProcessor::parameterChanged(const juce::String& parameterID, float newValue)
+{
+	juce::ignoreUnused(parameterID, newValue);
+	m_configDirty = true;
 
-			channelBuffer[sample] = volume * (mix * out + mixInverse * in);
-		}
+	// Maybe on the audio thread, the wake never blocks
+	m_worker->wake(this);
+}
+
+void EarlyReflectionsAudioProcessor::timerCallback()
+{
+	updateConfig(false);
+}
+
+void EarlyReflectionsAudioProcessor::runBackgroundJob()
+{
+	updateConfig(false);
+}
+
+void EarlyReflectionsAudioProcessor::updateConfig(bool wait)
+{
+	// One producer at a time, the timer just tries again on its next tick
+	while (m_configBuilding.exchange(true, std::memory_order_acquire))
+	{
+		if (!wait)
+			return;
+
+		std::this_thread::yield();
+	}
+
+	// Latest custom room, the builder copies what it needs from it
+	const TapSet* taps = m_tapSetPublisher.acquire();
+	const bool tapsChanged = taps != nullptr && taps->version != m_customTapsVersion;
+
+	if (m_configDirty.exchange(false) || tapsChanged)
+	{
+		// Get params
+		EngineParameters parameters;
+		parameters.size = sizeParameter->load();
+		parameters.absorbtion = absorbtionParameter->load();
+		parameters.attenuation = attenuationParameter->load();
+		parameters.resonance = resonanceParameter->load();
+		parameters.mix = mixParameter->load();
+		parameters.volume = volumeParameter->load();
+
+		// Buttons
+		if (buttonAParameter->get())
+			parameters.mode = ReflectionMode::Room;
+		else if (buttonBParameter->get())
+			parameters.mode = ReflectionMode::Hall;
+		else if (buttonCParameter->get())
+			parameters.mode = ReflectionMode::HallEco;
+		else
+			parameters.mode = ReflectionMode::Custom;
+
+		parameters.quality = (TapQuality)qualityParameter->getIndex();
+
+		if (taps != nullptr)
+			m_customTapsVersion = taps->version;
+
+		const EngineConfig& config = m_configBuilder.update(parameters, taps != nullptr ? *taps : *m_defaultTaps);
+		m_tailLength = EarlyReflectionsEngine::getTailLength(config);
+
+		m_configBuffer.getWriteBuffer() = config;
+		m_configBuffer.publish();
 	}
+
+	m_tapSetPublisher.release();
+	m_configBuilding.store(false, std::memory_order_release);
 }
 
 //==============================================================================
@@ -293,18 +306,115 @@ juce::AudioProcessorEditor* EarlyReflectionsAudioProcessor::createEditor()
 //==============================================================================
 void EarlyReflectionsAudioProcessor::getStateInformation (juce::MemoryBlock& destData)
 {
-	auto state = apvts.copyState();
-	std::unique_ptr<juce::XmlElement> xml(state.createXml());
-	copyXmlToBinary(*xml, destData);
+	PluginState state;
+	state.size = sizeParameter->load();
+	state.absorbtion = absorbtionParameter->load();
+	state.attenuation = attenuationParameter->load();
+	state.resonance = resonanceParameter->load();
+	state.mix = mixParameter->load();
+	state.volume = volumeParameter->load();
+	state.buttons = (buttonAParameter->get() ? 1u : 0u) | (buttonBParameter->get() ? 2u : 0u)
+				  | (buttonCParameter->get() ? 4u : 0u) | (buttonDParameter->get() ? 8u : 0u);
+	state.quality = qualityParameter->getIndex();
+	state.reducedRate = getReducedRate();
+	state.room = getCustomRoom();
+
+	destData.setSize(PluginState::SIZE);
+	state.write(destData.getData());
 }
 
 void EarlyReflectionsAudioProcessor::setStateInformation (const void* data, int sizeInBytes)
 {
+	PluginState state;
+
+	if (sizeInBytes > 0 && state.read(data, (size_t)sizeInBytes))
+	{
+		const float values[] = { state.size, state.absorbtion, state.attenuation, state.resonance, state.mix, state.volume };
+		for (int i = 0; i < 6; i++)
+			setParameterValue(apvts.getParameter(paramsNames[i]), values[i]);
+
+		setParameterValue(buttonAParameter, (state.buttons & 1u) != 0 ? 1.0f : 0.0f);
+		setParameterValue(buttonBParameter, (state.buttons & 2u) != 0 ? 1.0f : 0.0f);
+		setParameterValue(buttonCParameter, (state.buttons & 4u) != 0 ? 1.0f : 0.0f);
+		setParameterValue(buttonDParameter, (state.buttons & 8u) != 0 ? 1.0f : 0.0f);
+		setParameterValue(qualityParameter, (float)state.quality);
+
+		setCustomRoom(state.room);
+		setReducedRate(state.reducedRate);
+		return;
+	}
+
+	// States saved before the binary format
 	std::unique_ptr<juce::XmlElement> xmlState(getXmlFromBinary(data, sizeInBytes));
 
 	if (xmlState.get() != nullptr)
 		if (xmlState->hasTagName(apvts.state.getType()))
+		{
 			apvts.replaceState(juce::ValueTree::fromXml(*xmlState));
+			setCustomRoom(getCustomRoom());
+			applyWetRate();
+		}
+}
+
+void EarlyReflectionsAudioProcessor::setParameterValue(juce::RangedAudioParameter* parameter, float value)
+{
+	if (parameter != nullptr)
+		parameter->setValueNotifyingHost(parameter->convertTo0to1(value));
+}
+
+//==============================================================================
+void EarlyReflectionsAudioProcessor::setCustomRoom(const RoomGeometry& room)
+{
+	apvts.state.setProperty("RoomWidth", room.width, nullptr);
+	apvts.state.setProperty("RoomDepth", room.depth, nullptr);
+	apvts.state.setProperty("RoomHeight", room.height, nullptr);
+	apvts.state.setProperty("RoomOrder", room.order, nullptr);
+	apvts.state.setProperty("RoomAbsorption", room.wallAbsorption, nullptr);
+
+	m_tapSetPublisher.request(room);
+}
+
+RoomGeometry EarlyReflectionsAudioProcessor::getCustomRoom() const
+{
+	// Missing properties, e.g. older states, fall back to the default room
+	const RoomGeometry defaults;
+	RoomGeometry room;
+	room.width = apvts.state.getProperty("RoomWidth", defaults.width);
+	room.depth = apvts.state.getProperty("RoomDepth", defaults.depth);
+	room.height = apvts.state.getProperty("RoomHeight", defaults.height);
+	room.order = apvts.state.getProperty("RoomOrder", defaults.order);
+	room.wallAbsorption = apvts.state.getProperty("RoomAbsorption", defaults.wallAbsorption);
+
+	return room;
+}
+
+void EarlyReflectionsAudioProcessor::setReducedRate(bool reduced)
+{
+	apvts.state.setProperty("ReducedRate", reduced, nullptr);
+	applyWetRate();
+}
+
+bool EarlyReflectionsAudioProcessor::getReducedRate() const
+{
+	return apvts.state.getProperty("ReducedRate", false);
+}
+
+void EarlyReflectionsAudioProcessor::applyWetRate()
+{
+	const WetRate wetRate = getReducedRate() ? WetRate::Reduced : WetRate::Full;
+	if (wetRate == m_wetRate)
+		return;
+
+	m_wetRate = wetRate;
+
+	// Reallocates the delay lines, keep the audio thread out meanwhile
+	suspendProcessing(true);
+	m_engine.setWetRate(wetRate);
+
+	if (m_prepared)
+		m_engine.prepare(getSampleRate(), getBlockSize(), getTotalNumOutputChannels());
+
+	suspendProcessing(false);
 }
 
 juce::AudioProcessorValueTreeState::ParameterLayout EarlyReflectionsAudioProcessor::createParameterLayout()
@@ -318,11 +428,14 @@ juce::AudioProcessorValueTreeState::ParameterLayout EarlyReflectionsAudioProcess
 	layout.add(std::make_unique<juce::AudioParameterFloat>(paramsNames[2], paramsNames[2], NormalisableRange<float>(  0.0f,  1.0f, 0.01f, 1.0f), 1.0f));
 	layout.add(std::make_unique<juce::AudioParameterFloat>(paramsNames[3], paramsNames[3], NormalisableRange<float>(  0.0f,  1.0f, 0.01f, 1.0f), 0.0f));
 	layout.add(std::make_unique<juce::AudioParameterFloat>(paramsNames[4], paramsNames[4], NormalisableRange<float>(  0.0f,  1.0f, 0.01f, 1.0f), 0.5f));
-	layout.add(std::make_unique<juce::AudioParameterFloat>(paramsNames[5], paramsNames[5], NormalisableRange<float>(-12.0f, 12.0f,  0.1f, 1.0f), 0.0f));
+	layout.add(std::make_unique<juce::AudioParameterFloat>(paramsNames[5], paramsNames[5], NormalisableRange<float>(PluginState::VOLUME_MIN, PluginState::VOLUME_MAX, 0.1f, 1.0f), 0.0f));
 
 	layout.add(std::make_unique<juce::AudioParameterBool>("ButtonA", "ButtonA", true));
 	layout.add(std::make_unique<juce::AudioParameterBool>("ButtonB", "ButtonB", false));
 	layout.add(std::make_unique<juce::AudioParameterBool>("ButtonC", "ButtonC", false));
+	layout.add(std::make_unique<juce::AudioParameterBool>("ButtonD", "ButtonD", false));
+
+	layout.add(std::make_unique<juce::AudioParameterChoice>("Quality", "Quality", StringArray{ "Full", "Balanced", "Eco" }, 0));
 
 	return layout;
 }
@@ -1,31 +1,7 @@
 /*
   ==============================================================================
 
-    Room times calculation:
-
-	// Room Delay
-	const float speedOfSound = 343.0f;
-
-	// Max dimensions
-	const float h = pow(EarlyReflectionsAudioProcessor::m_roomSizeMax / 3.65f, 1.0f / 3.0f);
-	const float w = 1.6f * h;
-	const float d = 2.66f * h;
-
-	// Axial
-	const float axialHeightTime = h / speedOfSound;
-	const float axialWidthTime = w / speedOfSound;
-	const float axialDepthTime = d / speedOfSound;
-
-	// Tangential
-	const float tangentialHorizontal1Time = sqrt(d * d + 4.0f * w * w) / speedOfSound;
-	const float tangentialHorizontal2Time = sqrt(w * w + 4.0f * d * d) / speedOfSound;
-
-	const float tangentialVertical1Time = sqrt(d * d + 4.0f * h * h) / speedOfSound;
-	const float tangentialVertical2Time = sqrt(w * w + 4.0f * h * h) / speedOfSound;
-
-	Room gains calculation:
-
-	gain = 0.1224249 + 0.8558602 * exp(-40.69983 * time);
+    This file contains the basic framework code for a JUCE plugin processor.
 
   ==============================================================================
 */
@@ -33,79 +9,19 @@
 #pragma once
 
 #include <JuceHeader.h>
+#include "DSP/BackgroundWorker.h"
+#include "DSP/BlockProfiler.h"
+#include "DSP/EarlyReflectionsEngine.h"
+#include "DSP/PluginState.h"
+#include "DSP/ReflectionMeter.h"
+#include "DSP/TapSetPublisher.h"
+#include "DSP/TripleBuffer.h"
 
 //==============================================================================
-class CircularBuffer
-{
-public:
-	CircularBuffer();
-
-	void init(int size);
-	void clear();
-	void writeSample(float sample)
-	{
-		m_buffer[m_head] = sample;
-		if (++m_head >= m_size)
-			m_head = 0;
-	}
-	float read() const
-	{
-		return m_buffer[m_head];
-	}
-	float readDelay(int sample);
-	float readFactor(float factor);
-
-protected:
-	float *m_buffer;
-	int m_head = 0;
-	int m_size = 0;
-};
-
-//==============================================================================
-class SimpleDelay
-{
-public:
-	SimpleDelay();
-
-	void init(int size, int sampleRate)
-	{
-		m_buffer.init(size);
-	}
-	float process(float in);
-	void clear() { m_buffer.clear(); }
-	void setAbsorbtion(float absorbtion)
-	{
-		const float mel = 100.0f + (1.0f - absorbtion) * 3600.0f;
-		const float f = 700.0f * (expf(mel / 1127.0f) - 1.0f);
-		m_a0 = limit(powf(f / 20000.0f, 0.6f), 0.0f, 1.0f);
-		m_b1 = 1.0f - m_a0;
-	}
-	void set(float factor, float absorbtion, float attenuation, float feedback)
-	{
-		m_factor = factor;
-		setAbsorbtion(absorbtion);
-		m_attenuation = attenuation;
-		m_feedback = feedback;
-	}
-	float limit(float a, float min, float max)
-	{
-		return std::fmaxf(std::fminf(a, max), min);
-	}
-
-private:
-	CircularBuffer m_buffer = CircularBuffer();
-
-	float m_feedback = 0.0f;
-	float m_attenuation = 1.0f;
-	float m_factor = 1.0f;
-	
-	float m_last = 0.0f;
-	float m_a0 = 1.0f;
-	float m_b1 = 0.0f;
-};
-
-//==============================================================================
-class EarlyReflectionsAudioProcessor  : public juce::AudioProcessor
+class EarlyReflectionsAudioProcessor  : public juce::AudioProcessor,
+                                        private juce::AudioProcessorValueTreeState::Listener,
+                                        private juce::Timer,
+                                        private BackgroundWorker::Client
                             #if JucePlugin_Enable_ARA
                              , public juce::AudioProcessorARAExtension
                             #endif
@@ -116,13 +32,6 @@ public:
     ~EarlyReflectionsAudioProcessor() override;
 
 	static const std::string paramsNames[];
-	static const int N_ROOM_DELAY_LINES = 7;
-	static const int N_HALL_ECO_DELAY_LINES = 6;
-	static const int N_HALL_DELAY_LINES = 18;
-	static const int STEREO_ADDITION = 30;
-	static const int MINIMUM_BUFFER_SIZE = 10;
-	
-	static const int ROOM_SIZE_MAX = 2;
 
     //==============================================================================
     void prepareToPlay (double sampleRate, int samplesPerBlock) override;
@@ -162,18 +71,37 @@ public:
 
 	APVTS apvts{ *this, nullptr, "Parameters", createParameterLayout() };
 
+	// Room of the D mode. Generated in the background, stored with the state.
+	void setCustomRoom(const RoomGeometry& room);
+	RoomGeometry getCustomRoom() const;
+
+	// Wet path at 44.1 or 48 kHz on high rate sessions, stored with the state.
+	// Message thread, the engine is prepared again with processing suspended.
+	void setReducedRate(bool reduced);
+	bool getReducedRate() const;
+
+	// Tap energy and levels for the editor display
+	ReflectionMeter& getMeter() { return m_meter; }
+
+#if ER_INSTRUMENTATION
+	// Cost of every processBlock, drained by the editor
+	BlockProfiler& getProfiler() { return m_profiler; }
+#endif
+
 private:
-    //==============================================================================
-	void clearCircularBuffers()
-	{
-		for (int i = 0; i < N_HALL_DELAY_LINES; i++)
-		{
-			m_delayLine[0][i].clear();
-			m_delayLine[1][i].clear();
-		}
-	}
-	
 	//==============================================================================
+	void parameterChanged(const juce::String& parameterID, float newValue) override;
+	void timerCallback() override;
+	void runBackgroundJob() override;
+
+	// Builds and publishes a new engine config when a parameter or the custom
+	// tap set changed. Any non audio thread, or the audio thread of offline
+	// renders, where wait lets it finish a build that is in progress.
+	// Parameter changes wake the shared background worker to build, so
+	// automation keeps working while the message thread stalls. The timer
+	// picks up new custom rooms and anything a lost wake left behind.
+	void updateConfig(bool wait);
+
 	std::atomic<float>* sizeParameter = nullptr;
 	std::atomic<float>* absorbtionParameter = nullptr;
 	std::atomic<float>* attenuationParameter = nullptr;
@@ -184,88 +112,40 @@ private:
 	juce::AudioParameterBool* buttonAParameter = nullptr;
 	juce::AudioParameterBool* buttonBParameter = nullptr;
 	juce::AudioParameterBool* buttonCParameter = nullptr;
-
-	SimpleDelay m_delayLine[2][N_HALL_DELAY_LINES] = {};
-
-	const float m_roomDelayTimes[N_ROOM_DELAY_LINES] = {
-													0.0145f,
-													0.0187f,
-													0.0233f,
-													0.0242f,
-													0.0387f,
-													0.0303f,
-													0.0405f,
-	};
-
-	const float m_roomDelayGains[N_ROOM_DELAY_LINES] = {
-													0.5968f,
-													0.5228f,
-													0.4540f,
-													0.4421f,
-													0.2996f,
-													0.3718f,
-													0.2871f
-	};
-
-	const float m_hallEcoDelayTimes[N_HALL_ECO_DELAY_LINES] = {
-													0.0199f,
-													0.0354f,
-													0.0389f,
-													0.0414f,
-													0.0699f,
-													0.0796f,
-	};
-
-	const float m_hallEcoDelayGains[N_HALL_ECO_DELAY_LINES] = {
-													1.200f,
-													0.818f,
-													0.635f,
-													0.719f,
-													0.267f,
-													0.242f
-	};
-
-	const float m_hallDelayTimes[N_HALL_DELAY_LINES] = {
-													0.0043f,
-													0.0215f,
-													0.0225f,
-													0.0268f,
-													0.0270f,
-													0.0298f,
-													0.0458f,
-													0.0485f,
-													0.0572f,
-													0.0587f,
-													0.0595f,
-													0.0612f,
-													0.0707f,
-													0.0708f,
-													0.0726f,
-													0.0741f,
-													0.0753f,
-													0.0797f
-	};
-
-	const float m_hallDelayGains[N_HALL_DELAY_LINES] = {
-													0.841f,
-													0.504f,
-													0.491f,
-													0.379f,
-													0.380f,
-													0.346f,
-													0.289f,
-													0.272f,
-													0.192f,
-													0.193f,
-													0.217f,
-													0.181f,
-													0.180f,
-													0.181f,
-													0.176f,
-													0.142f,
-													0.167f,
-													0.134f
-	};
+	juce::AudioParameterBool* buttonDParameter = nullptr;
+	juce::AudioParameterChoice* qualityParameter = nullptr;
+
+	void applyWetRate();
+	// Plain value, as stored in the state
+	static void setParameterValue(juce::RangedAudioParameter* parameter, float value);
+
+	EarlyReflectionsEngine m_engine;
+	TapSetPublisher m_tapSetPublisher;
+
+	// Fully derived parameters, built off the audio thread and picked up
+	// with one acquire per block
+	TripleBuffer<EngineConfig> m_configBuffer;
+	EngineConfigBuilder m_configBuilder;
+	// Custom mode room until the first generated set arrives
+	std::shared_ptr<const TapSet> m_defaultTaps;
+	unsigned int m_customTapsVersion = 0;
+	std::atomic<bool> m_configDirty { true };
+	std::atomic<bool> m_configBuilding { false };
+	std::atomic<double> m_tailLength { 0.0 };
+	std::shared_ptr<BackgroundWorker> m_worker;
+
+	WetRate m_wetRate = WetRate::Full;
+	bool m_prepared = false;
+
+	// Offline renders of wide layouts spread channels over worker threads,
+	// created on the first one
+	std::unique_ptr<WorkerPool> m_offlinePool;
+
+	ReflectionMeter m_meter;
+
+#if ER_INSTRUMENTATION
+	BlockProfiler m_profiler;
+#endif
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (EarlyReflectionsAudioProcessor)
 };
@@ -0,0 +1,85 @@
+/*
+  ==============================================================================
+
+    Load readout of the per block profiler.
+
+  ==============================================================================
+*/
+
+#include "ProfileView.h"
+
+#if ER_INSTRUMENTATION
+
+//==============================================================================
+ProfileView::ProfileView(BlockProfiler& profiler)
+	: m_profiler(profiler)
+{
+	m_summary.setJustificationType(juce::Justification::centredLeft);
+	addAndMakeVisible(m_summary);
+
+	m_exportButton.onClick = [this] { exportCsv(); };
+	addAndMakeVisible(m_exportButton);
+
+	// The editor is the only reader, blocks pile up in the queue while it is closed
+	startTimerHz(4);
+}
+
+ProfileView::~ProfileView()
+{
+	stopTimer();
+}
+
+void ProfileView::resized()
+{
+	auto bounds = getLocalBounds();
+	m_exportButton.setBounds(bounds.removeFromRight(bounds.getHeight() * 2));
+	m_summary.setBounds(bounds);
+}
+
+void ProfileView::timerCallback()
+{
+	m_log.collect(m_profiler);
+
+	if (m_statusTicks > 0)
+		m_statusTicks--;
+	else
+		m_summary.setText(m_log.getSummary(m_profiler), juce::dontSendNotification);
+}
+
+void ProfileView::exportCsv()
+{
+	const juce::File initial = juce::File::getSpecialLocation(juce::File::userDocumentsDirectory)
+		.getChildFile("EarlyReflectionsProfile.csv");
+
+	m_chooser = std::make_unique<juce::FileChooser>("Export profile", initial, "*.csv");
+
+	const int flags = juce::FileBrowserComponent::saveMode | juce::FileBrowserComponent::canSelectFiles
+					| juce::FileBrowserComponent::warnAboutOverwriting;
+
+	// The chooser belongs to the view, the callback never outlives it
+	m_chooser->launchAsync(flags, [this](const juce::FileChooser& chooser)
+	{
+		const juce::File file = chooser.getResult();
+
+		if (file != juce::File())
+			writeCsv(file);
+	});
+}
+
+void ProfileView::writeCsv(const juce::File& file)
+{
+	m_log.collect(m_profiler);
+
+	if (m_log.writeCsv(file.getFullPathName().toStdString()))
+		showStatus("Profile written to " + file.getFullPathName());
+	else
+		showStatus("Cannot write " + file.getFullPathName());
+}
+
+void ProfileView::showStatus(const juce::String& status)
+{
+	m_summary.setText(status, juce::dontSendNotification);
+	m_statusTicks = 12;	// Three seconds at the timer rate
+}
+
+#endif
@@ -0,0 +1,46 @@
+/*
+  ==============================================================================
+
+    Load readout of the per block profiler, in builds with
+    ER_INSTRUMENTATION=1.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "DSP/BlockProfiler.h"
+
+#if ER_INSTRUMENTATION
+
+//==============================================================================
+class ProfileView  : public juce::Component,
+                     private juce::Timer
+{
+public:
+	explicit ProfileView(BlockProfiler& profiler);
+	~ProfileView() override;
+
+	void resized() override;
+
+private:
+	void timerCallback() override;
+	void exportCsv();
+	void writeCsv(const juce::File& file);
+	// Shown instead of the summary for a few timer ticks
+	void showStatus(const juce::String& status);
+
+	BlockProfiler& m_profiler;
+	ProfileLog m_log;
+
+	juce::Label m_summary;
+	juce::TextButton m_exportButton{ "CSV" };
+
+	std::unique_ptr<juce::FileChooser> m_chooser;
+	int m_statusTicks = 0;
+
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ProfileView)
+};
+
+#endif
@@ -0,0 +1,176 @@
+/*
+  ==============================================================================
+
+    Reflection pattern and energy display.
+
+  ==============================================================================
+*/
+
+#include "ReflectionDisplay.h"
+
+//==============================================================================
+ReflectionDisplay::ReflectionDisplay(ReflectionMeter& meter, juce::Colour background, juce::Colour foreground)
+	: m_meter(meter), m_background(background), m_foreground(foreground)
+{
+	setOpaque(true);
+	startTimerHz(FRAME_RATE);
+}
+
+ReflectionDisplay::~ReflectionDisplay()
+{
+	stopTimer();
+	m_meter.setActive(false);
+}
+
+void ReflectionDisplay::paint(juce::Graphics& g)
+{
+	g.drawImageAt(m_backgroundImage, 0, 0);
+
+	const juce::Rectangle<int> clip = g.getClipBounds();
+	g.setColour(m_foreground);
+
+	for (int bin = 0; bin < ReflectionFrame::BINS; bin++)
+	{
+		const juce::Rectangle<int> bar = getBar(getBinBounds(bin), m_binHeights[bin]);
+		if (bar.intersects(clip))
+			g.fillRect(bar);
+	}
+
+	for (int meter = 0; meter < 2; meter++)
+	{
+		const juce::Rectangle<int> bar = getBar(getMeterBounds(meter), m_meterHeights[meter]);
+		if (bar.intersects(clip))
+			g.fillRect(bar);
+	}
+}
+
+void ReflectionDisplay::resized()
+{
+	juce::Rectangle<int> bounds = getLocalBounds().reduced(4);
+
+	m_meters = bounds.removeFromRight(METER_WIDTH * 2 + 2);
+	bounds.removeFromRight(4);
+	m_plot = bounds;
+
+	for (int bin = 0; bin < ReflectionFrame::BINS; bin++)
+		m_binHeights[bin] = getLevelHeight(m_frame.tapEnergy[bin]);
+
+	m_meterHeights[0] = getLevelHeight(m_frame.inputEnergy);
+	m_meterHeights[1] = getLevelHeight(m_frame.outputEnergy);
+
+	renderBackground();
+}
+
+//==============================================================================
+void ReflectionDisplay::timerCallback()
+{
+	// Hidden editors cost the audio thread nothing either
+	const bool showing = isShowing();
+	m_meter.setActive(showing);
+
+	if (!showing)
+		return;
+
+	// Only the newest frame is drawn
+	bool received = false;
+	while (m_meter.pop(m_frame))
+		received = true;
+
+	if (!received)
+		return;
+
+	juce::Rectangle<int> dirty;
+
+	for (int bin = 0; bin < ReflectionFrame::BINS; bin++)
+	{
+		const int height = getLevelHeight(m_frame.tapEnergy[bin]);
+		if (height == m_binHeights[bin])
+			continue;
+
+		dirty = dirty.getUnion(getBar(getBinBounds(bin), std::max(height, m_binHeights[bin])));
+		m_binHeights[bin] = height;
+	}
+
+	const float meterEnergy[2] = { m_frame.inputEnergy, m_frame.outputEnergy };
+
+	for (int meter = 0; meter < 2; meter++)
+	{
+		const int height = getLevelHeight(meterEnergy[meter]);
+		if (height == m_meterHeights[meter])
+			continue;
+
+		dirty = dirty.getUnion(getBar(getMeterBounds(meter), std::max(height, m_meterHeights[meter])));
+		m_meterHeights[meter] = height;
+	}
+
+	if (!m_hasPattern || m_frame.tapsVersion != m_patternVersion)
+	{
+		renderBackground();
+		repaint();
+	}
+	else if (!dirty.isEmpty())
+		repaint(dirty);
+}
+
+void ReflectionDisplay::renderBackground()
+{
+	if (getWidth() <= 0 || getHeight() <= 0)
+		return;
+
+	m_backgroundImage = juce::Image(juce::Image::RGB, getWidth(), getHeight(), false);
+	juce::Graphics g(m_backgroundImage);
+
+	g.fillAll(m_background);
+
+	// A line every 20 dB
+	g.setColour(m_foreground.withAlpha(0.2f));
+	for (float db = MIN_DB + 20.0f; db < 0.0f; db += 20.0f)
+	{
+		const int y = m_plot.getBottom() - (int)(m_plot.getHeight() * (db - MIN_DB) / -MIN_DB);
+		g.drawHorizontalLine(y, (float)m_plot.getX(), (float)m_plot.getRight());
+	}
+
+	// The pattern as outlines the energy fills
+	g.setColour(m_foreground.withAlpha(0.35f));
+	for (int bin = 0; bin < ReflectionFrame::BINS; bin++)
+	{
+		const int height = getLevelHeight(m_frame.pattern[bin]);
+		if (height > 0)
+			g.drawRect(getBar(getBinBounds(bin), height), 1);
+	}
+
+	g.drawRect(m_meters.expanded(1), 1);
+
+	m_patternVersion = m_frame.tapsVersion;
+	m_hasPattern = true;
+}
+
+//==============================================================================
+int ReflectionDisplay::getLevelHeight(float energy) const
+{
+	if (energy <= 0.0f)
+		return 0;
+
+	const float db = 10.0f * std::log10(energy);
+	const float position = juce::jlimit(0.0f, 1.0f, (db - MIN_DB) / -MIN_DB);
+
+	return juce::roundToInt(position * m_plot.getHeight());
+}
+
+juce::Rectangle<int> ReflectionDisplay::getBinBounds(int bin) const
+{
+	const int left = m_plot.getX() + bin * m_plot.getWidth() / ReflectionFrame::BINS;
+	const int right = m_plot.getX() + (bin + 1) * m_plot.getWidth() / ReflectionFrame::BINS;
+
+	return { left, m_plot.getY(), std::max(1, right - left - 1), m_plot.getHeight() };
+}
+
+juce::Rectangle<int> ReflectionDisplay::getMeterBounds(int meter) const
+{
+	return { m_meters.getX() + meter * (METER_WIDTH + 2), m_plot.getY(), METER_WIDTH, m_plot.getHeight() };
+}
+
+juce::Rectangle<int> ReflectionDisplay::getBar(const juce::Rectangle<int>& column, int height) const
+{
+	return { column.getX(), column.getBottom() - height, column.getWidth(), height };
+}
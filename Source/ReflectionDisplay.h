@@ -0,0 +1,64 @@
+/*
+  ==============================================================================
+
+    Reflection pattern and energy display.
+
+    Draws the frames of a ReflectionMeter at up to FRAME_RATE: the tap
+    pattern and grid live in a cached image that is only rendered again
+    when the taps or the size change, and every frame repaints just the
+    bars and meters whose height moved by a pixel.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "DSP/ReflectionMeter.h"
+
+//==============================================================================
+class ReflectionDisplay  : public juce::Component,
+                           private juce::Timer
+{
+public:
+	ReflectionDisplay(ReflectionMeter& meter, juce::Colour background, juce::Colour foreground);
+	~ReflectionDisplay() override;
+
+	static const int FRAME_RATE = ReflectionMeter::FRAME_RATE;
+	static constexpr float MIN_DB = -60.0f;
+	static const int METER_WIDTH = 8;
+
+	void paint(juce::Graphics& g) override;
+	void resized() override;
+
+private:
+	void timerCallback() override;
+	void renderBackground();
+
+	// Pixels above the plot bottom for an energy, 0 at MIN_DB and below
+	int getLevelHeight(float energy) const;
+	// Whole column of a bin or meter, bars grow from its bottom
+	juce::Rectangle<int> getBinBounds(int bin) const;
+	juce::Rectangle<int> getMeterBounds(int meter) const;
+	juce::Rectangle<int> getBar(const juce::Rectangle<int>& column, int height) const;
+
+	ReflectionMeter& m_meter;
+	ReflectionFrame m_frame;
+
+	juce::Colour m_background;
+	juce::Colour m_foreground;
+
+	// Grid and pattern
+	juce::Image m_backgroundImage;
+	unsigned int m_patternVersion = 0;
+	bool m_hasPattern = false;
+
+	juce::Rectangle<int> m_plot;
+	juce::Rectangle<int> m_meters;
+
+	// Heights as last painted
+	int m_binHeights[ReflectionFrame::BINS] = {};
+	int m_meterHeights[2] = {};
+
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ReflectionDisplay)
+};
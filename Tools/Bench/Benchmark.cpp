@@ -0,0 +1,135 @@
+/*
+  ==============================================================================
+
+    Timing helpers and result reporting for er_bench.
+
+  ==============================================================================
+*/
+
+#include "Benchmark.h"
+
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <sstream>
+
+//==============================================================================
+static volatile float benchSink = 0.0f;
+
+void doNotOptimize(float value)
+{
+	benchSink = benchSink + value;
+}
+
+std::string BenchResult::key() const
+{
+	std::ostringstream stream;
+	stream << benchmark << '/' << mode << '/' << blockSize << '/' << sampleRate << '/' << channels << '/' << resonance;
+	return stream.str();
+}
+
+//==============================================================================
+bool writeCsv(const std::string& path, const std::vector<BenchResult>& results)
+{
+	std::ofstream file(path);
+	if (!file)
+		return false;
+
+	file << "benchmark,mode,block_size,sample_rate,channels,resonance,ns_per_sample,realtime_factor,extra_name,extra_value\n";
+
+	for (const auto& r : results)
+	{
+		file << r.benchmark << ',' << r.mode << ',' << r.blockSize << ',' << r.sampleRate << ',' << r.channels << ','
+			 << r.resonance << ',' << r.nsPerSample << ',' << r.realtimeFactor << ',' << r.extraName << ',' << r.extraValue << '\n';
+	}
+
+	return true;
+}
+
+bool writeJson(const std::string& path, const std::vector<BenchResult>& results)
+{
+	std::ofstream file(path);
+	if (!file)
+		return false;
+
+	file << "[\n";
+
+	for (size_t i = 0; i < results.size(); i++)
+	{
+		const auto& r = results[i];
+		file << "  { \"benchmark\": \"" << r.benchmark << "\", \"mode\": \"" << r.mode << "\", \"block_size\": " << r.blockSize
+			 << ", \"sample_rate\": " << r.sampleRate << ", \"channels\": " << r.channels << ", \"resonance\": " << r.resonance
+			 << ", \"ns_per_sample\": " << r.nsPerSample << ", \"realtime_factor\": " << r.realtimeFactor;
+
+		if (!r.extraName.empty())
+			file << ", \"" << r.extraName << "\": " << r.extraValue;
+
+		file << (i + 1 < results.size() ? " },\n" : " }\n");
+	}
+
+	file << "]\n";
+	return true;
+}
+
+bool readCsv(const std::string& path, std::vector<BenchResult>& results)
+{
+	std::ifstream file(path);
+	if (!file)
+		return false;
+
+	std::string line;
+	std::getline(file, line);
+
+	while (std::getline(file, line))
+	{
+		std::istringstream stream(line);
+		std::string field;
+		std::vector<std::string> fields;
+
+		while (std::getline(stream, field, ','))
+			fields.push_back(field);
+
+		if (fields.size() < 8)
+			continue;
+
+		BenchResult r;
+		r.benchmark = fields[0];
+		r.mode = fields[1];
+		r.blockSize = std::stoi(fields[2]);
+		r.sampleRate = std::stoi(fields[3]);
+		r.channels = std::stoi(fields[4]);
+		r.resonance = std::stof(fields[5]);
+		r.nsPerSample = std::stod(fields[6]);
+		r.realtimeFactor = std::stod(fields[7]);
+		results.push_back(r);
+	}
+
+	return true;
+}
+
+int compareResults(const std::vector<BenchResult>& baseline, const std::vector<BenchResult>& results, double thresholdPercent)
+{
+	std::map<std::string, const BenchResult*> byKey;
+	for (const auto& r : baseline)
+		byKey[r.key()] = &r;
+
+	int regressions = 0;
+
+	for (const auto& r : results)
+	{
+		const auto it = byKey.find(r.key());
+		if (it == byKey.end() || it->second->nsPerSample <= 0.0)
+			continue;
+
+		const double change = 100.0 * (r.nsPerSample / it->second->nsPerSample - 1.0);
+
+		if (change > thresholdPercent)
+		{
+			printf("REGRESSION %-60s %8.3f -> %8.3f ns/sample (%+.1f%%)\n",
+				   r.key().c_str(), it->second->nsPerSample, r.nsPerSample, change);
+			regressions++;
+		}
+	}
+
+	return regressions;
+}
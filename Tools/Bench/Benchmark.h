@@ -0,0 +1,58 @@
+/*
+  ==============================================================================
+
+    Timing helpers and result reporting for er_bench.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+//==============================================================================
+struct BenchResult
+{
+	std::string benchmark;
+	std::string mode;
+	int blockSize = 0;
+	int sampleRate = 0;
+	int channels = 0;
+	float resonance = 0.0f;
+	double nsPerSample = 0.0;
+	double realtimeFactor = 0.0;
+
+	// Optional extra measurement, e.g. a noise floor in dB
+	std::string extraName;
+	double extraValue = 0.0;
+
+	std::string key() const;
+};
+
+//==============================================================================
+class BenchTimer
+{
+public:
+	void start() { m_start = std::chrono::steady_clock::now(); }
+	double stopSeconds() const
+	{
+		return std::chrono::duration<double>(std::chrono::steady_clock::now() - m_start).count();
+	}
+
+private:
+	std::chrono::steady_clock::time_point m_start;
+};
+
+// Keeps the optimizer from dropping otherwise unused results
+void doNotOptimize(float value);
+
+//==============================================================================
+bool writeCsv(const std::string& path, const std::vector<BenchResult>& results);
+bool writeJson(const std::string& path, const std::vector<BenchResult>& results);
+bool readCsv(const std::string& path, std::vector<BenchResult>& results);
+
+// Prints every result slower than the baseline by more than thresholdPercent,
+// returns the number of regressions
+int compareResults(const std::vector<BenchResult>& baseline, const std::vector<BenchResult>& results, double thresholdPercent);
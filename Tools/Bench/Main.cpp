@@ -0,0 +1,1208 @@
+/*
+  ==============================================================================
+
+    Benchmarks for the hot path: CircularBuffer reads, MultiTapDelay per
+    sample and per block, dense image-source tap tables, direct taps against
+    FFT convolution, and the complete EarlyReflectionsEngine::process that
+    the plugin processBlock runs, also on mostly silent input, through
+    long resonant decays, at every level of detail and with compact delay
+    storage, saving and loading the plugin state, and the tables a new
+    instance sets up.
+
+    er_bench [--quick] [--seconds <s>] [--filter <name>]
+             [--csv <file>] [--json <file>]
+             [--compare <baseline.csv>] [--threshold <percent>]
+
+  ==============================================================================
+*/
+
+#include <algorithm>
+#include <cstdio>
+#include <cmath>
+#include <cstdlib>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Benchmark.h"
+#include "EarlyReflectionsEngine.h"
+#include "Fft.h"
+#include "PluginState.h"
+#include "RoomGeometry.h"
+
+//==============================================================================
+struct BenchSettings
+{
+	double seconds = 1.0;
+	bool quick = false;
+	std::string filter;
+	std::string csvPath;
+	std::string jsonPath;
+	std::string comparePath;
+	double threshold = 10.0;
+
+	std::vector<int> blockSizes() const
+	{
+		if (quick)
+			return { 64, 512 };
+		return { 16, 32, 64, 128, 256, 512, 1024, 2048, 4096 };
+	}
+	std::vector<int> sampleRates() const
+	{
+		if (quick)
+			return { 48000, 192000 };
+		return { 44100, 48000, 88200, 96000, 176400, 192000 };
+	}
+	bool wants(const std::string& benchmark) const
+	{
+		return filter.empty() || benchmark.find(filter) != std::string::npos;
+	}
+};
+
+static const ReflectionMode allModes[] = { ReflectionMode::Room, ReflectionMode::Hall, ReflectionMode::HallEco };
+static const float resonances[] = { 0.0f, 0.7f };
+
+static const char* modeName(ReflectionMode mode)
+{
+	switch (mode)
+	{
+		case ReflectionMode::Room:    return "Room";
+		case ReflectionMode::Hall:    return "Hall";
+		case ReflectionMode::HallEco: return "HallEco";
+		case ReflectionMode::Custom:  return "Custom";
+	}
+	return "";
+}
+
+static std::vector<float> makeNoise(int numSamples)
+{
+	std::vector<float> noise(numSamples);
+	unsigned int seed = 12345;
+
+	for (auto& sample : noise)
+	{
+		seed = seed * 1664525u + 1013904223u;
+		sample = (float)(seed >> 8) / 16777216.0f - 0.5f;
+	}
+
+	return noise;
+}
+
+static void report(std::vector<BenchResult>& results, BenchResult result, double wallSeconds, long long samples)
+{
+	result.nsPerSample = 1.0e9 * wallSeconds / (double)samples;
+	result.realtimeFactor = (double)samples / result.channels / result.sampleRate / wallSeconds;
+
+	printf("%-34s %-8s block %5d  %6d Hz  ch %d  res %.1f  %9.3f ns/sample  %9.1fx realtime\n",
+		   result.benchmark.c_str(), result.mode.c_str(), result.blockSize, result.sampleRate, result.channels,
+		   result.resonance, result.nsPerSample, result.realtimeFactor);
+
+	results.push_back(result);
+}
+
+static void setTapsForMode(MultiTapDelay& delay, ReflectionMode mode, float size)
+{
+	const ReflectionPattern pattern = ReflectionModes::getPattern(mode);
+	float factors[MultiTapDelay::MAX_TAPS];
+
+	for (int i = 0; i < pattern.count; i++)
+		factors[i] = size * pattern.times[i] / ReflectionModes::TIME_MAX;
+
+	delay.setTaps(factors, pattern.gains, pattern.count);
+}
+
+static int delayScaleFor(int sampleRate)
+{
+	return EarlyReflectionsEngine::MINIMUM_BUFFER_SIZE
+		 + int(ReflectionModes::TIME_MAX * EarlyReflectionsEngine::ROOM_SIZE_MAX * sampleRate);
+}
+
+//==============================================================================
+static void benchCircularBuffer(const BenchSettings& settings, std::vector<BenchResult>& results)
+{
+	const ReflectionPattern pattern = ReflectionModes::getPattern(ReflectionMode::Hall);
+
+	for (int sampleRate : settings.sampleRates())
+	{
+		const int numSamples = (int)(settings.seconds * sampleRate);
+		const std::vector<float> input = makeNoise(numSamples);
+
+		const int delayScale = delayScaleFor(sampleRate);
+		const int size = CircularBuffer::sizeForDelayScale(delayScale);
+
+		DelayArena arena;
+		arena.prepare(size);
+
+		CircularBuffer buffer;
+		buffer.init(arena.allocate(size), size, delayScale);
+
+		int delays[ReflectionModes::N_HALL_DELAY_LINES];
+		float factors[ReflectionModes::N_HALL_DELAY_LINES];
+		for (int i = 0; i < pattern.count; i++)
+		{
+			factors[i] = 0.5f * pattern.times[i] / ReflectionModes::TIME_MAX;
+			delays[i] = buffer.delayFromFactor(factors[i]);
+		}
+
+		BenchResult result;
+		result.mode = "-";
+		result.sampleRate = sampleRate;
+		result.channels = 1;
+
+		if (settings.wants("CircularBuffer::readDelay"))
+		{
+			BenchTimer timer;
+			float sum = 0.0f;
+			timer.start();
+
+			for (int n = 0; n < numSamples; n++)
+			{
+				for (int i = 0; i < pattern.count; i++)
+					sum += buffer.readDelay(delays[i]);
+				buffer.writeSample(input[n]);
+			}
+
+			doNotOptimize(sum);
+			result.benchmark = "CircularBuffer::readDelay";
+			report(results, result, timer.stopSeconds(), numSamples);
+		}
+
+		if (settings.wants("CircularBuffer::readFactor"))
+		{
+			BenchTimer timer;
+			float sum = 0.0f;
+			timer.start();
+
+			for (int n = 0; n < numSamples; n++)
+			{
+				for (int i = 0; i < pattern.count; i++)
+					sum += buffer.readFactor(factors[i]);
+				buffer.writeSample(input[n]);
+			}
+
+			doNotOptimize(sum);
+			result.benchmark = "CircularBuffer::readFactor";
+			report(results, result, timer.stopSeconds(), numSamples);
+		}
+	}
+}
+
+static void benchMultiTapDelay(const BenchSettings& settings, std::vector<BenchResult>& results)
+{
+	for (ReflectionMode mode : allModes)
+	{
+		for (int sampleRate : settings.sampleRates())
+		{
+			const int numSamples = (int)(settings.seconds * sampleRate);
+			const std::vector<float> input = makeNoise(numSamples);
+			std::vector<float> output(numSamples);
+
+			for (float resonance : resonances)
+			{
+				BenchResult result;
+				result.mode = modeName(mode);
+				result.sampleRate = sampleRate;
+				result.channels = 1;
+				result.resonance = resonance;
+
+				if (!settings.wants("MultiTapDelay::processBlock"))
+					continue;
+
+				for (int blockSize : settings.blockSizes())
+				{
+					DelayArena arena;
+					arena.prepare(MultiTapDelay::getRequiredStorage(delayScaleFor(sampleRate), blockSize));
+
+					MultiTapDelay delay;
+					delay.init(arena, delayScaleFor(sampleRate), blockSize);
+					setTapsForMode(delay, mode, 0.5f);
+					delay.set(0.3f, resonance);
+
+					BenchTimer timer;
+					timer.start();
+
+					for (int offset = 0; offset < numSamples; offset += blockSize)
+					{
+						const int count = std::min(blockSize, numSamples - offset);
+						delay.processBlock(input.data() + offset, output.data() + offset, count);
+					}
+
+					doNotOptimize(output[numSamples - 1]);
+					result.benchmark = "MultiTapDelay::processBlock";
+					result.blockSize = blockSize;
+					report(results, result, timer.stopSeconds(), numSamples);
+				}
+			}
+		}
+	}
+}
+
+// Image-source sized tap tables, reported per tap to show the cost stays
+// close to one multiply-add
+static void benchSparseTaps(const BenchSettings& settings, std::vector<BenchResult>& results)
+{
+	if (!settings.wants("MultiTapDelay::processBlock[sparse]"))
+		return;
+
+	const int sampleRate = 48000;
+	const int numSamples = (int)(settings.seconds * sampleRate);
+	const int delayScale = delayScaleFor(sampleRate);
+	const std::vector<float> input = makeNoise(numSamples);
+	std::vector<float> output(numSamples);
+
+	for (int tapCount : { 200, 2000 })
+	{
+		// Fixed pseudo random taps in four damping groups
+		std::vector<int> delays(tapCount);
+		std::vector<float> gains(tapCount);
+		std::vector<int> groups(tapCount);
+		unsigned int seed = 12345u;
+
+		for (int i = 0; i < tapCount; i++)
+		{
+			seed = seed * 1664525u + 1013904223u;
+			delays[i] = 100 + (int)(seed % (unsigned int)(delayScale * 0.9f));
+			gains[i] = 1.0f / tapCount;
+			groups[i] = i % 4;
+		}
+
+		for (float resonance : resonances)
+		{
+			for (int blockSize : settings.blockSizes())
+			{
+				DelayArena arena;
+				arena.prepare(MultiTapDelay::getRequiredStorage(delayScale, blockSize));
+
+				MultiTapDelay delay;
+				delay.init(arena, delayScale, blockSize);
+				delay.setTapDelays(delays.data(), gains.data(), tapCount, groups.data());
+				delay.set(0.3f, resonance);
+
+				BenchTimer timer;
+				timer.start();
+
+				for (int offset = 0; offset < numSamples; offset += blockSize)
+				{
+					const int count = std::min(blockSize, numSamples - offset);
+					delay.processBlock(input.data() + offset, output.data() + offset, count);
+				}
+
+				doNotOptimize(output[numSamples - 1]);
+
+				BenchResult result;
+				result.benchmark = "MultiTapDelay::processBlock[sparse]";
+				result.mode = "Taps" + std::to_string(tapCount);
+				result.blockSize = blockSize;
+				result.sampleRate = sampleRate;
+				result.channels = 1;
+				result.resonance = resonance;
+				report(results, result, timer.stopSeconds(), numSamples);
+
+				results.back().extraName = "ns_per_tap";
+				results.back().extraValue = results.back().nsPerSample / tapCount;
+			}
+		}
+	}
+}
+
+static void benchEngineLayout(const BenchSettings& settings, std::vector<BenchResult>& results,
+							  const char* name, EngineLayout layout, int minChannels,
+							  WetRate wetRate = WetRate::Full, double minSampleRate = 0.0, bool identicalInput = false)
+{
+	if (!settings.wants(name))
+		return;
+
+	for (ReflectionMode mode : allModes)
+	{
+		for (int sampleRate : settings.sampleRates())
+		{
+			if (sampleRate < minSampleRate)
+				continue;
+
+			const int numSamples = (int)(settings.seconds * sampleRate);
+			const std::vector<float> noise = makeNoise(numSamples);
+
+			// Independent channels unless the input is meant to be identical
+			std::vector<float> otherNoise(noise);
+			if (!identicalInput)
+				std::reverse(otherNoise.begin(), otherNoise.end());
+
+			for (int channels = minChannels; channels <= 2; channels++)
+			{
+				for (float resonance : resonances)
+				{
+					for (int blockSize : settings.blockSizes())
+					{
+						EngineParameters parameters;
+						parameters.mode = mode;
+						parameters.resonance = resonance;
+						parameters.absorbtion = 0.3f;
+
+						EarlyReflectionsEngine engine;
+						engine.setLayout(layout);
+						engine.setWetRate(wetRate);
+						engine.prepare(sampleRate, blockSize, channels);
+						engine.setParameters(parameters);
+
+						std::vector<std::vector<float>> audio(channels, noise);
+						std::vector<float*> pointers(channels);
+
+						if (channels > 1)
+							audio[1] = otherNoise;
+
+						BenchTimer timer;
+						timer.start();
+
+						for (int offset = 0; offset < numSamples; offset += blockSize)
+						{
+							for (int channel = 0; channel < channels; channel++)
+								pointers[channel] = audio[channel].data() + offset;
+
+							engine.setParameters(parameters);
+							engine.process(pointers.data(), channels, std::min(blockSize, numSamples - offset));
+						}
+
+						const double seconds = timer.stopSeconds();
+						doNotOptimize(audio[0][numSamples - 1]);
+
+						BenchResult result;
+						result.benchmark = name;
+						result.mode = modeName(mode);
+						result.blockSize = blockSize;
+						result.sampleRate = sampleRate;
+						result.channels = channels;
+						result.resonance = resonance;
+						report(results, result, seconds, (long long)numSamples * channels);
+
+						results.back().extraName = "memory_kb";
+						results.back().extraValue = engine.getMemoryUsage() / 1024.0;
+					}
+				}
+			}
+		}
+	}
+}
+
+static void benchConvolution(const BenchSettings& settings, std::vector<BenchResult>& results)
+{
+	const char* name = "EarlyReflectionsEngine::process[convolution]";
+	if (!settings.wants(name))
+		return;
+
+	const int sampleRate = 48000;
+	const int numSamples = (int)(settings.seconds * sampleRate);
+	const std::vector<float> noise = makeNoise(numSamples);
+
+	struct Variant
+	{
+		const char* name;
+		ConvolutionMode mode;
+	};
+	const Variant variants[] = { { "Off", ConvolutionMode::Off }, { "Always", ConvolutionMode::Always }, { "Auto", ConvolutionMode::Automatic } };
+
+	// Image-source rooms from a few dozen taps to the full tap table
+	const RoomGeometry rooms[] = {
+		{ 4.0f, 6.5f, 2.5f, 3, 0.3f },
+		{ 4.0f, 6.5f, 2.5f, 16, 0.3f },
+		{ 2.0f, 2.5f, 2.0f, 24, 0.3f },
+		{ 1.5f, 2.0f, 1.8f, 24, 0.3f }
+	};
+
+	for (const RoomGeometry& room : rooms)
+	{
+		const std::shared_ptr<const TapSet> taps = RoomGeometryGenerator::getShared(room);
+
+		for (const Variant& variant : variants)
+		{
+			for (int blockSize : settings.blockSizes())
+			{
+				EngineParameters parameters;
+				parameters.mode = ReflectionMode::Custom;
+				parameters.absorbtion = 0.3f;
+
+				EarlyReflectionsEngine engine;
+				engine.setConvolutionMode(variant.mode);
+				engine.prepare(sampleRate, blockSize, 2);
+				engine.setCustomTaps(taps);
+				engine.setParameters(parameters);
+
+				// Independent channels, identical ones would share one history
+				std::vector<std::vector<float>> audio(2, noise);
+				std::reverse(audio[1].begin(), audio[1].end());
+				float* pointers[2];
+
+				// The impulse response is rendered in the background, give it
+				// time to arrive before measuring
+				for (int warmup = 0; warmup < 10; warmup++)
+				{
+					pointers[0] = audio[0].data();
+					pointers[1] = audio[1].data();
+					engine.process(pointers, 2, std::min(blockSize, numSamples));
+					std::this_thread::sleep_for(std::chrono::milliseconds(5));
+				}
+
+				BenchTimer timer;
+				timer.start();
+
+				for (int offset = 0; offset < numSamples; offset += blockSize)
+				{
+					pointers[0] = audio[0].data() + offset;
+					pointers[1] = audio[1].data() + offset;
+					engine.process(pointers, 2, std::min(blockSize, numSamples - offset));
+				}
+
+				const double seconds = timer.stopSeconds();
+				doNotOptimize(audio[0][numSamples - 1]);
+
+				BenchResult result;
+				result.benchmark = name;
+				result.mode = "Taps" + std::to_string(taps->count) + variant.name;
+				result.blockSize = blockSize;
+				result.sampleRate = sampleRate;
+				result.channels = 2;
+				result.resonance = 0.0f;
+				report(results, result, seconds, (long long)numSamples * 2);
+			}
+		}
+	}
+}
+
+static void benchEngine(const BenchSettings& settings, std::vector<BenchResult>& results)
+{
+	benchEngineLayout(settings, results, "EarlyReflectionsEngine::process", EngineLayout::Planar, 1);
+
+	// The interleaved layout only differs from planar for stereo
+	benchEngineLayout(settings, results, "EarlyReflectionsEngine::process[interleaved]", EngineLayout::Interleaved, 2);
+
+	// Reduced rate only differs from full rate from 88.2 kHz on
+	benchEngineLayout(settings, results, "EarlyReflectionsEngine::process[reduced]", EngineLayout::Planar, 1,
+					  WetRate::Reduced, 2.0 * EarlyReflectionsEngine::MIN_REDUCED_RATE);
+
+	// Mono material on a stereo track shares one history
+	benchEngineLayout(settings, results, "EarlyReflectionsEngine::process[dual mono]", EngineLayout::Planar, 2,
+					  WetRate::Full, 0.0, true);
+}
+
+// A noise burst every ten seconds, the engine should idle in between
+static void benchSilence(const BenchSettings& settings, std::vector<BenchResult>& results)
+{
+	const char* name = "EarlyReflectionsEngine::process[silence]";
+	if (!settings.wants(name))
+		return;
+
+	const int channels = 2;
+	const int blockSize = 512;
+
+	for (ReflectionMode mode : allModes)
+	{
+		for (int sampleRate : settings.sampleRates())
+		{
+			const int numSamples = (int)(std::max(settings.seconds, 10.0) * sampleRate);
+			std::vector<float> input = makeNoise(numSamples);
+			std::fill(input.begin() + sampleRate / 10, input.end(), 0.0f);
+
+			for (float resonance : resonances)
+			{
+				EngineParameters parameters;
+				parameters.mode = mode;
+				parameters.resonance = resonance;
+				parameters.absorbtion = 0.3f;
+
+				EarlyReflectionsEngine engine;
+				engine.prepare(sampleRate, blockSize, channels);
+				engine.setParameters(parameters);
+
+				std::vector<std::vector<float>> audio(channels, input);
+				std::vector<float*> pointers(channels);
+				long long idleBlocks = 0;
+				long long blocks = 0;
+
+				BenchTimer timer;
+				timer.start();
+
+				for (int offset = 0; offset < numSamples; offset += blockSize)
+				{
+					for (int channel = 0; channel < channels; channel++)
+						pointers[channel] = audio[channel].data() + offset;
+
+					engine.setParameters(parameters);
+					engine.process(pointers.data(), channels, std::min(blockSize, numSamples - offset));
+
+					idleBlocks += engine.isIdle() ? 1 : 0;
+					blocks++;
+				}
+
+				const double seconds = timer.stopSeconds();
+				doNotOptimize(audio[0][numSamples - 1]);
+
+				BenchResult result;
+				result.benchmark = name;
+				result.mode = modeName(mode);
+				result.blockSize = blockSize;
+				result.sampleRate = sampleRate;
+				result.channels = channels;
+				result.resonance = resonance;
+				report(results, result, seconds, (long long)numSamples * channels);
+
+				results.back().extraName = "idle_percent";
+				results.back().extraValue = 100.0 * idleBlocks / blocks;
+			}
+		}
+	}
+}
+
+// One channel keeps playing while the other decays after a noise burst, so
+// the engine never idles and the resonance loop and damping filters of the
+// silent channel shrink into the subnormal range within a minute
+static void benchResonantDecay(const BenchSettings& settings, std::vector<BenchResult>& results)
+{
+	const char* name = "EarlyReflectionsEngine::process[resonant decay]";
+	if (!settings.wants(name))
+		return;
+
+	const int channels = 2;
+	const int blockSize = 512;
+	const float decayResonances[] = { 0.5f, 0.9f };
+
+	for (ReflectionMode mode : allModes)
+	{
+		for (int sampleRate : settings.sampleRates())
+		{
+			const int burstSamples = sampleRate / 10;
+			const int numSamples = burstSamples + (int)(std::max(settings.seconds, 60.0) * sampleRate);
+			std::vector<float> playing = makeNoise(numSamples);
+			std::vector<float> decaying(playing.begin(), playing.begin() + burstSamples);
+			decaying.resize(numSamples, 0.0f);
+
+			for (float resonance : decayResonances)
+			{
+				EngineParameters parameters;
+				parameters.mode = mode;
+				parameters.resonance = resonance;
+				parameters.absorbtion = 0.3f;
+
+				EarlyReflectionsEngine engine;
+				engine.prepare(sampleRate, blockSize, channels);
+				engine.setParameters(parameters);
+
+				std::vector<std::vector<float>> audio = { playing, decaying };
+				std::vector<float*> pointers(channels);
+				std::vector<double> blockSeconds;
+				blockSeconds.reserve(numSamples / blockSize + 1);
+				double decaySeconds = 0.0;
+
+				for (int offset = 0; offset < numSamples; offset += blockSize)
+				{
+					for (int channel = 0; channel < channels; channel++)
+						pointers[channel] = audio[channel].data() + offset;
+
+					BenchTimer timer;
+					timer.start();
+
+					engine.process(pointers.data(), channels, std::min(blockSize, numSamples - offset));
+
+					const double seconds = timer.stopSeconds();
+
+					// Only the blocks after the burst count
+					if (offset >= burstSamples)
+					{
+						decaySeconds += seconds;
+						blockSeconds.push_back(seconds);
+					}
+				}
+
+				doNotOptimize(audio[1][numSamples - 1]);
+
+				BenchResult result;
+				result.benchmark = name;
+				result.mode = modeName(mode);
+				result.blockSize = blockSize;
+				result.sampleRate = sampleRate;
+				result.channels = channels;
+				result.resonance = resonance;
+				report(results, result, decaySeconds, (long long)(numSamples - burstSamples) * channels);
+
+				// Cost of the worst blocks of the decay. The 99.9th percentile
+				// leaves out the odd block the scheduler interrupted, a
+				// subnormal slowdown lasts for seconds.
+				const size_t worst = blockSeconds.size() - 1 - blockSeconds.size() / 1000;
+				std::nth_element(blockSeconds.begin(), blockSeconds.begin() + worst, blockSeconds.end());
+				results.back().extraName = "p999_ns_per_sample";
+				results.back().extraValue = 1.0e9 * blockSeconds[worst] / ((double)blockSize * channels);
+			}
+		}
+	}
+}
+
+// Dense image-source rooms at every level of detail, direct taps only so the
+// cost follows the taps that are left
+static void benchQuality(const BenchSettings& settings, std::vector<BenchResult>& results)
+{
+	const char* name = "EarlyReflectionsEngine::process[quality]";
+	if (!settings.wants(name))
+		return;
+
+	const int sampleRate = 48000;
+	const int numSamples = (int)(settings.seconds * sampleRate);
+	const std::vector<float> noise = makeNoise(numSamples);
+
+	struct Variant
+	{
+		const char* name;
+		TapQuality quality;
+	};
+	const Variant variants[] = { { "Full", TapQuality::Full }, { "Balanced", TapQuality::Balanced }, { "Eco", TapQuality::Eco } };
+
+	const RoomGeometry rooms[] = {
+		{ 4.0f, 6.5f, 2.5f, 16, 0.3f },
+		{ 1.5f, 2.0f, 1.8f, 24, 0.3f }
+	};
+
+	for (const RoomGeometry& room : rooms)
+	{
+		const std::shared_ptr<const TapSet> taps = RoomGeometryGenerator::getShared(room);
+
+		for (const Variant& variant : variants)
+		{
+			for (float resonance : resonances)
+			{
+				for (int blockSize : settings.blockSizes())
+				{
+					EngineParameters parameters;
+					parameters.mode = ReflectionMode::Custom;
+					parameters.absorbtion = 0.3f;
+					parameters.resonance = resonance;
+					parameters.quality = variant.quality;
+
+					EarlyReflectionsEngine engine;
+					engine.setConvolutionMode(ConvolutionMode::Off);
+					engine.prepare(sampleRate, blockSize, 2);
+					engine.setCustomTaps(taps);
+					engine.setParameters(parameters);
+
+					std::vector<std::vector<float>> audio(2, noise);
+					std::reverse(audio[1].begin(), audio[1].end());
+					float* pointers[2];
+
+					BenchTimer timer;
+					timer.start();
+
+					for (int offset = 0; offset < numSamples; offset += blockSize)
+					{
+						pointers[0] = audio[0].data() + offset;
+						pointers[1] = audio[1].data() + offset;
+						engine.process(pointers, 2, std::min(blockSize, numSamples - offset));
+					}
+
+					const double seconds = timer.stopSeconds();
+					doNotOptimize(audio[0][numSamples - 1]);
+
+					BenchResult result;
+					result.benchmark = name;
+					result.mode = "Taps" + std::to_string(taps->count) + variant.name;
+					result.blockSize = blockSize;
+					result.sampleRate = sampleRate;
+					result.channels = 2;
+					result.resonance = resonance;
+					report(results, result, seconds, (long long)numSamples * 2);
+
+					results.back().extraName = "active_taps";
+					results.back().extraValue = engine.getActiveTapCount();
+				}
+			}
+		}
+	}
+}
+
+// Several instances in turn, as in a session, so at high sample rates their
+// histories compete for the cache. Float rows report the delay memory of one
+// instance, compact rows the noise floor of the wet signal against float.
+static void benchCompactStorage(const BenchSettings& settings, std::vector<BenchResult>& results)
+{
+	const char* name = "EarlyReflectionsEngine::process[compact]";
+	if (!settings.wants(name))
+		return;
+
+	const int channels = 2;
+	const int blockSize = 512;
+	const int instances = 8;
+
+	const std::shared_ptr<const TapSet> customTaps = RoomGeometryGenerator::getShared(RoomGeometry { 4.0f, 6.5f, 2.5f, 16, 0.3f });
+
+	const ReflectionMode modes[] = { ReflectionMode::Room, ReflectionMode::Hall, ReflectionMode::HallEco, ReflectionMode::Custom };
+	const DelayStorage storages[] = { DelayStorage::Float, DelayStorage::Compact };
+
+	for (ReflectionMode mode : modes)
+	{
+		for (int sampleRate : settings.sampleRates())
+		{
+			const int numSamples = (int)(settings.seconds * sampleRate);
+			const std::vector<float> noise = makeNoise(numSamples);
+			std::vector<float> otherNoise(noise);
+			std::reverse(otherNoise.begin(), otherNoise.end());
+
+			for (float resonance : resonances)
+			{
+				// Wet output of the first float instance
+				std::vector<float> reference;
+
+				for (DelayStorage storage : storages)
+				{
+					EngineParameters parameters;
+					parameters.mode = mode;
+					parameters.resonance = resonance;
+					parameters.absorbtion = 0.3f;
+					parameters.mix = 1.0f;
+
+					std::vector<std::unique_ptr<EarlyReflectionsEngine>> engines;
+					std::vector<std::vector<float>> audio;
+
+					for (int instance = 0; instance < instances; instance++)
+					{
+						engines.push_back(std::make_unique<EarlyReflectionsEngine>());
+						engines.back()->setDelayStorage(storage);
+						engines.back()->prepare(sampleRate, blockSize, channels);
+						engines.back()->setCustomTaps(customTaps);
+						engines.back()->setParameters(parameters);
+
+						audio.push_back(noise);
+						audio.push_back(otherNoise);
+					}
+
+					float* pointers[channels];
+
+					BenchTimer timer;
+					timer.start();
+
+					for (int offset = 0; offset < numSamples; offset += blockSize)
+					{
+						for (int instance = 0; instance < instances; instance++)
+						{
+							for (int channel = 0; channel < channels; channel++)
+								pointers[channel] = audio[instance * channels + channel].data() + offset;
+
+							engines[instance]->process(pointers, channels, std::min(blockSize, numSamples - offset));
+						}
+					}
+
+					const double seconds = timer.stopSeconds();
+					doNotOptimize(audio[0][numSamples - 1]);
+
+					// All instances together against real time
+					BenchResult result;
+					result.benchmark = name;
+					result.mode = std::string(modeName(mode)) + (storage == DelayStorage::Compact ? "Compact" : "Float");
+					result.blockSize = blockSize;
+					result.sampleRate = sampleRate;
+					result.channels = channels * instances;
+					result.resonance = resonance;
+					report(results, result, seconds, (long long)numSamples * channels * instances);
+
+					if (storage == DelayStorage::Float)
+					{
+						reference = audio[0];
+						results.back().extraName = "memory_kb";
+						results.back().extraValue = engines[0]->getMemoryUsage() / 1024.0;
+						continue;
+					}
+
+					double signal = 0.0;
+					double error = 0.0;
+
+					for (int n = 0; n < numSamples; n++)
+					{
+						const double difference = (double)audio[0][n] - reference[n];
+						signal += (double)reference[n] * reference[n];
+						error += difference * difference;
+					}
+
+					results.back().extraName = "noise_db";
+					results.back().extraValue = error > 0.0 && signal > 0.0 ? 10.0 * std::log10(error / signal) : -200.0;
+				}
+			}
+		}
+	}
+}
+
+//==============================================================================
+// Stand-in for the XML states the plugin saved before the binary format:
+// the same document, written and parsed into attribute lists. JUCE's parser
+// and the ValueTree it builds do more, so this is a lower bound of the old
+// cost.
+struct XmlAttribute
+{
+	std::string name;
+	std::string value;
+};
+
+static void appendAttribute(std::string& xml, const char* name, double value)
+{
+	char text[64];
+	snprintf(text, sizeof(text), " %s=\"%g\"", name, value);
+	xml += text;
+}
+
+static std::string writeXmlState(const PluginState& state)
+{
+	const char* names[] = { "Size", "Absorbtion", "Attenuation", "Resonance", "Mix", "Volume",
+							"ButtonA", "ButtonB", "ButtonC", "ButtonD", "Quality" };
+	const float values[] = { state.size, state.absorbtion, state.attenuation, state.resonance, state.mix, state.volume,
+							 (float)(state.buttons & 1u), (float)((state.buttons >> 1) & 1u),
+							 (float)((state.buttons >> 2) & 1u), (float)((state.buttons >> 3) & 1u), (float)state.quality };
+
+	std::string xml = "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n\n<Parameters";
+	appendAttribute(xml, "RoomWidth", state.room.width);
+	appendAttribute(xml, "RoomDepth", state.room.depth);
+	appendAttribute(xml, "RoomHeight", state.room.height);
+	appendAttribute(xml, "RoomOrder", state.room.order);
+	appendAttribute(xml, "RoomAbsorption", state.room.wallAbsorption);
+	appendAttribute(xml, "ReducedRate", state.reducedRate ? 1.0 : 0.0);
+	xml += ">\n";
+
+	for (int i = 0; i < 11; i++)
+	{
+		xml += "  <PARAM id=\"";
+		xml += names[i];
+		xml += "\"";
+		appendAttribute(xml, "value", values[i]);
+		xml += "/>\n";
+	}
+
+	return xml + "</Parameters>\n";
+}
+
+static bool readXmlState(const std::string& xml, PluginState& state)
+{
+	std::vector<std::vector<XmlAttribute>> elements;
+	size_t position = xml.find("?>");
+	if (position == std::string::npos)
+		return false;
+
+	// Every element with its attributes
+	while ((position = xml.find('<', position)) != std::string::npos)
+	{
+		if (xml.compare(position, 2, "</") == 0)
+			break;
+
+		position = xml.find_first_of(" />", position);
+		elements.emplace_back();
+
+		while (position < xml.size() && xml[position] == ' ')
+		{
+			const size_t equals = xml.find('=', position);
+			const size_t end = xml.find('"', equals + 2);
+			if (equals == std::string::npos || end == std::string::npos)
+				return false;
+
+			elements.back().push_back({ xml.substr(position + 1, equals - position - 1), xml.substr(equals + 2, end - equals - 2) });
+			position = end + 1;
+		}
+	}
+
+	if (elements.empty())
+		return false;
+
+	for (const XmlAttribute& attribute : elements[0])
+	{
+		const float value = strtof(attribute.value.c_str(), nullptr);
+		if (attribute.name == "RoomWidth")				state.room.width = value;
+		else if (attribute.name == "RoomDepth")			state.room.depth = value;
+		else if (attribute.name == "RoomHeight")		state.room.height = value;
+		else if (attribute.name == "RoomOrder")			state.room.order = (int)value;
+		else if (attribute.name == "RoomAbsorption")	state.room.wallAbsorption = value;
+		else if (attribute.name == "ReducedRate")		state.reducedRate = value != 0.0f;
+	}
+
+	float* values[] = { &state.size, &state.absorbtion, &state.attenuation, &state.resonance, &state.mix, &state.volume };
+	const char* names[] = { "Size", "Absorbtion", "Attenuation", "Resonance", "Mix", "Volume" };
+
+	for (size_t element = 1; element < elements.size(); element++)
+	{
+		if (elements[element].size() != 2)
+			continue;
+
+		const std::string& id = elements[element][0].value;
+		const float value = strtof(elements[element][1].value.c_str(), nullptr);
+
+		for (int i = 0; i < 6; i++)
+			if (id == names[i])
+				*values[i] = value;
+
+		if (id.compare(0, 6, "Button") == 0 && id.size() == 7)
+		{
+			const unsigned int bit = 1u << (id[6] - 'A');
+			state.buttons = value != 0.0f ? (state.buttons | bit) : (state.buttons & ~bit);
+		}
+		else if (id == "Quality")
+			state.quality = (int)value;
+	}
+
+	return true;
+}
+
+static void benchPluginState(const BenchSettings& settings, std::vector<BenchResult>& results)
+{
+	const char* name = "PluginState";
+	if (!settings.wants(name))
+		return;
+
+	// A session of instances with slightly different settings
+	const int instances = 512;
+	const int rounds = std::max(1, (int)(settings.seconds * 200));
+
+	std::vector<PluginState> states(instances);
+	for (int i = 0; i < instances; i++)
+	{
+		states[i].size = (float)(i % 100) / 100.0f;
+		states[i].mix = (float)(i % 7) / 7.0f;
+		states[i].volume = (float)(i % 24) - 12.0f;
+		states[i].buttons = 1u << (i % 4);
+		states[i].room.order = 3 + i % 5;
+	}
+
+	std::vector<unsigned char> binary((size_t)instances * PluginState::SIZE);
+	std::vector<std::string> xml(instances);
+	const size_t xmlSize = writeXmlState(states[0]).size();
+
+	auto run = [&](const char* operation, const char* mode, size_t bytes, const std::function<float()>& pass)
+	{
+		float check = 0.0f;
+		BenchTimer timer;
+		timer.start();
+
+		for (int round = 0; round < rounds; round++)
+			check += pass();
+
+		const double seconds = timer.stopSeconds();
+		doNotOptimize(check);
+
+		// ns_per_sample holds the time per state here
+		BenchResult result;
+		result.benchmark = std::string(name) + "[" + operation + "]";
+		result.mode = mode;
+		result.channels = 1;
+		result.nsPerSample = 1.0e9 * seconds / ((double)rounds * instances);
+		result.extraName = "bytes";
+		result.extraValue = (double)bytes;
+
+		printf("%-34s %-8s %9.1f ns/state  %5d bytes\n", result.benchmark.c_str(), mode, result.nsPerSample, (int)bytes);
+		results.push_back(result);
+	};
+
+	run("save", "Binary", PluginState::SIZE, [&]
+	{
+		for (int i = 0; i < instances; i++)
+			states[i].write(binary.data() + (size_t)i * PluginState::SIZE);
+		return (float)binary[PluginState::SIZE - 1];
+	});
+
+	run("save", "XmlText", xmlSize, [&]
+	{
+		for (int i = 0; i < instances; i++)
+			xml[i] = writeXmlState(states[i]);
+		return (float)xml[instances - 1].size();
+	});
+
+	run("load", "Binary", PluginState::SIZE, [&]
+	{
+		float sum = 0.0f;
+		for (int i = 0; i < instances; i++)
+		{
+			PluginState state;
+			if (state.read(binary.data() + (size_t)i * PluginState::SIZE, PluginState::SIZE))
+				sum += state.size;
+		}
+		return sum;
+	});
+
+	run("load", "XmlText", xmlSize, [&]
+	{
+		float sum = 0.0f;
+		for (int i = 0; i < instances; i++)
+		{
+			PluginState state;
+			if (readXmlState(xml[i], state))
+				sum += state.size;
+		}
+		return sum;
+	});
+
+	// Both formats have to give back what was saved
+	for (int i = 0; i < instances; i++)
+	{
+		PluginState fromBinary;
+		PluginState fromXml;
+
+		if (!fromBinary.read(binary.data() + (size_t)i * PluginState::SIZE, PluginState::SIZE) || !readXmlState(xml[i], fromXml)
+			|| fromBinary.size != states[i].size || fromXml.size != states[i].size
+			|| fromBinary.buttons != states[i].buttons || fromXml.buttons != states[i].buttons
+			|| fromBinary.room.order != states[i].room.order || fromXml.room.order != states[i].room.order)
+		{
+			fprintf(stderr, "error: state %d does not read back\n", i);
+			break;
+		}
+	}
+}
+
+//==============================================================================
+static void benchSharedTables(const BenchSettings& settings, std::vector<BenchResult>& results)
+{
+	const char* name = "SharedTables";
+	if (!settings.wants(name))
+		return;
+
+	// A session loading instances that all use the same room and block size
+	const int instances = 200;
+	const int rounds = std::max(1, (int)(settings.seconds * 20));
+	const int fftSize = 1024;
+	const RoomGeometry room;
+
+	auto run = [&](const char* table, const char* mode, const std::function<int()>& load)
+	{
+		int copies = 0;
+		BenchTimer timer;
+		timer.start();
+
+		for (int round = 0; round < rounds; round++)
+			copies = load();
+
+		const double seconds = timer.stopSeconds();
+
+		// ns_per_sample holds the time per instance here
+		BenchResult result;
+		result.benchmark = std::string(name) + "[" + table + "]";
+		result.mode = mode;
+		result.channels = 1;
+		result.nsPerSample = 1.0e9 * seconds / ((double)rounds * instances);
+		result.extraName = "copies";
+		result.extraValue = (double)copies;
+
+		printf("%-34s %-8s %9.1f ns/instance  %3d copies\n", result.benchmark.c_str(), mode, result.nsPerSample, copies);
+		results.push_back(result);
+	};
+
+	run("room", "Private", [&]
+	{
+		std::vector<std::unique_ptr<TapSet>> held(instances);
+		for (auto& taps : held)
+		{
+			taps.reset(new TapSet());
+			RoomGeometryGenerator::generate(room, *taps);
+		}
+		return (int)held.size();
+	});
+
+	run("room", "Shared", [&]
+	{
+		std::vector<std::shared_ptr<const TapSet>> held(instances);
+		for (auto& taps : held)
+			taps = RoomGeometryGenerator::getShared(room);
+
+		std::sort(held.begin(), held.end());
+		return (int)(std::unique(held.begin(), held.end()) - held.begin());
+	});
+
+	run("fft", "Private", [&]
+	{
+		std::vector<std::unique_ptr<Fft>> held(instances);
+		for (auto& fft : held)
+		{
+			fft.reset(new Fft());
+			fft->init(fftSize);
+		}
+		return (int)held.size();
+	});
+
+	run("fft", "Shared", [&]
+	{
+		std::vector<std::shared_ptr<const Fft>> held(instances);
+		for (auto& fft : held)
+			fft = Fft::getShared(fftSize);
+
+		std::sort(held.begin(), held.end());
+		return (int)(std::unique(held.begin(), held.end()) - held.begin());
+	});
+}
+
+//==============================================================================
+static void printUsage()
+{
+	printf("Usage: er_bench [options]\n"
+		   "\n"
+		   "  --quick                 Reduced sweep (2 block sizes, 2 sample rates)\n"
+		   "  --seconds <s>           Audio seconds rendered per measurement, default 1\n"
+		   "  --filter <name>         Only run benchmarks whose name contains <name>\n"
+		   "  --csv <file>            Write results as CSV\n"
+		   "  --json <file>           Write results as JSON\n"
+		   "  --compare <file>        Compare against a CSV from an earlier run\n"
+		   "  --threshold <percent>   Allowed slowdown before --compare fails, default 10\n");
+}
+
+int main(int argc, char** argv)
+{
+	BenchSettings settings;
+
+	for (int i = 1; i < argc; i++)
+	{
+		const std::string arg = argv[i];
+		const bool hasValue = i + 1 < argc;
+
+		if (arg == "--quick")
+			settings.quick = true;
+		else if (arg == "--seconds" && hasValue)
+			settings.seconds = std::max(0.01, atof(argv[++i]));
+		else if (arg == "--filter" && hasValue)
+			settings.filter = argv[++i];
+		else if (arg == "--csv" && hasValue)
+			settings.csvPath = argv[++i];
+		else if (arg == "--json" && hasValue)
+			settings.jsonPath = argv[++i];
+		else if (arg == "--compare" && hasValue)
+			settings.comparePath = argv[++i];
+		else if (arg == "--threshold" && hasValue)
+			settings.threshold = atof(argv[++i]);
+		else
+		{
+			printUsage();
+			return 1;
+		}
+	}
+
+	std::vector<BenchResult> results;
+
+	benchCircularBuffer(settings, results);
+	benchMultiTapDelay(settings, results);
+	benchSparseTaps(settings, results);
+	benchConvolution(settings, results);
+	benchEngine(settings, results);
+	benchSilence(settings, results);
+	benchResonantDecay(settings, results);
+	benchQuality(settings, results);
+	benchCompactStorage(settings, results);
+	benchPluginState(settings, results);
+	benchSharedTables(settings, results);
+
+	if (!settings.csvPath.empty() && !writeCsv(settings.csvPath, results))
+		fprintf(stderr, "error: cannot write %s\n", settings.csvPath.c_str());
+
+	if (!settings.jsonPath.empty() && !writeJson(settings.jsonPath, results))
+		fprintf(stderr, "error: cannot write %s\n", settings.jsonPath.c_str());
+
+	if (!settings.comparePath.empty())
+	{
+		std::vector<BenchResult> baseline;
+		if (!readCsv(settings.comparePath, baseline))
+		{
+			fprintf(stderr, "error: cannot read %s\n", settings.comparePath.c_str());
+			return 1;
+		}
+
+		if (compareResults(baseline, results, settings.threshold) > 0)
+			return 2;
+	}
+
+	return 0;
+}
@@ -0,0 +1,928 @@
+/*
+  ==============================================================================
+
+    Golden reference renders: records deterministic impulse and noise
+    responses of every mode over a grid of parameters and sample rates,
+    and of parameter changes after the engine went idle on silence, then
+    checks every engine variant against them.
+
+    er_golden record <dir> [--filter <name>] [--summary]
+    er_golden check <dir> [--filter <name>] [--verbose]
+
+    The reference is the planar engine with direct taps and 512 sample
+    blocks (and the MultiTapDelay with scalar kernels for the kernel
+    cases). Record once on a known good build, check after every change to
+    the hot path.
+
+    Next to the renders, record writes summary.txt with a few statistics
+    per window of every render, small enough to commit. Cases without a
+    render are checked against the summary, Tools/Golden/Reference holds
+    the committed one and CTest runs the check against it.
+    Reduced rate cases are their own references, the resampling filter
+    changes the sound on purpose.
+
+    The references are recorded from the engine itself, so check also
+    renders the Room, Hall and HallEco cases with a port of the original
+    per line delays and compares the reference engine against it.
+
+  ==============================================================================
+*/
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "EarlyReflectionsEngine.h"
+#include "RoomGeometry.h"
+#include "WavFile.h"
+#include "WorkerPool.h"
+
+//==============================================================================
+enum class Signal
+{
+	Impulse,
+	Noise,
+	DualMono
+};
+
+struct GoldenCase
+{
+	std::string name;
+	EngineParameters parameters;
+	int sampleRate = 48000;
+	Signal signal = Signal::Impulse;
+	WetRate wetRate = WetRate::Full;
+	// Parameters of a silent lead-in long enough for the engine to go idle,
+	// the render follows the change to parameters
+	bool changes = false;
+	EngineParameters before;
+};
+
+struct Variant
+{
+	const char* name;
+	EngineLayout layout;
+	ConvolutionMode convolution;
+	int blockSize;
+	bool threads;
+	bool sharing;
+	bool reprepare;
+	DelayStorage storage;
+	// Largest absolute sample error allowed against the golden render
+	double tolerance;
+};
+
+// Every variant has to match the reference render within its tolerance.
+// Reordered sums (convolution, interleaved gathers) get a little room and
+// compact storage its 16 bit history, the others only differ in how the
+// work is split and must stay at rounding.
+static const Variant variants[] = {
+	{ "reference",     EngineLayout::Planar,      ConvolutionMode::Off,    512,  false, false, false, DelayStorage::Float,   1.0e-6 },
+	{ "block64",       EngineLayout::Planar,      ConvolutionMode::Off,    64,   false, false, false, DelayStorage::Float,   1.0e-6 },
+	{ "block1000",     EngineLayout::Planar,      ConvolutionMode::Off,    1000, false, false, false, DelayStorage::Float,   1.0e-6 },
+	{ "threads",       EngineLayout::Planar,      ConvolutionMode::Off,    512,  true,  false, false, DelayStorage::Float,   1.0e-6 },
+	{ "reprepare",     EngineLayout::Planar,      ConvolutionMode::Off,    512,  false, false, true,  DelayStorage::Float,   1.0e-6 },
+	{ "shared",        EngineLayout::Planar,      ConvolutionMode::Off,    512,  false, true,  false, DelayStorage::Float,   1.0e-6 },
+	{ "interleaved",   EngineLayout::Interleaved, ConvolutionMode::Off,    512,  false, false, false, DelayStorage::Float,   1.0e-5 },
+	{ "convolution",   EngineLayout::Planar,      ConvolutionMode::Always, 512,  false, false, false, DelayStorage::Float,   1.0e-5 },
+	{ "convolution64", EngineLayout::Planar,      ConvolutionMode::Always, 64,   false, false, false, DelayStorage::Float,   1.0e-5 },
+	{ "compact",       EngineLayout::Planar,      ConvolutionMode::Off,    512,  false, false, false, DelayStorage::Compact, 1.0e-4 },
+	{ "compact64",     EngineLayout::Planar,      ConvolutionMode::Off,    64,   false, false, false, DelayStorage::Compact, 1.0e-4 },
+	{ "compactshared", EngineLayout::Planar,      ConvolutionMode::Off,    512,  false, true,  false, DelayStorage::Compact, 1.0e-4 },
+};
+
+static const double RENDER_SECONDS = 0.6;
+static const double LEAD_IN_SECONDS = 0.2;
+
+// SIMD kernels against the scalar ones, fused multiply-adds round differently.
+// A compact history stores the difference again, one step of 16 bits.
+static const double KERNEL_TOLERANCE = 1.0e-5;
+static const double KERNEL_COMPACT_TOLERANCE = 1.0e-4;
+
+// The reference engine against the original per line algorithm, which
+// sums its lines in another order
+static const double BASELINE_TOLERANCE = 1.0e-5;
+
+//==============================================================================
+static const char* modeName(ReflectionMode mode)
+{
+	switch (mode)
+	{
+		case ReflectionMode::Room:    return "room";
+		case ReflectionMode::Hall:    return "hall";
+		case ReflectionMode::HallEco: return "hall-eco";
+		case ReflectionMode::Custom:  return "custom";
+	}
+	return "";
+}
+
+static const char* signalName(Signal signal)
+{
+	switch (signal)
+	{
+		case Signal::Impulse:  return "impulse";
+		case Signal::Noise:    return "noise";
+		case Signal::DualMono: return "dualmono";
+	}
+	return "";
+}
+
+static std::vector<float> makeNoise(int numSamples, unsigned int seed)
+{
+	std::vector<float> noise(numSamples);
+
+	for (auto& sample : noise)
+	{
+		seed = seed * 1664525u + 1013904223u;
+		sample = (float)(seed >> 8) / 16777216.0f - 0.5f;
+	}
+
+	return noise;
+}
+
+static std::vector<std::vector<float>> makeSignal(Signal signal, int sampleRate)
+{
+	const int numSamples = (int)(RENDER_SECONDS * sampleRate);
+	std::vector<std::vector<float>> channels(2, std::vector<float>(numSamples, 0.0f));
+
+	switch (signal)
+	{
+		case Signal::Impulse:
+			// Apart, so both channel responses show in one render
+			channels[0][0] = 1.0f;
+			channels[1][sampleRate / 100] = 1.0f;
+			break;
+
+		case Signal::Noise:
+			channels[0] = makeNoise(numSamples, 12345);
+			channels[1] = makeNoise(numSamples, 54321);
+			break;
+
+		case Signal::DualMono:
+			channels[0] = makeNoise(numSamples, 12345);
+			channels[1] = channels[0];
+			break;
+	}
+
+	return channels;
+}
+
+// Dense enough for the convolution to matter
+static std::shared_ptr<const TapSet> getCustomTaps()
+{
+	RoomGeometry room;
+	room.order = 8;
+
+	return RoomGeometryGenerator::getShared(room);
+}
+
+//==============================================================================
+static std::vector<GoldenCase> makeCases()
+{
+	EngineParameters plain;
+	plain.absorbtion = 0.3f;
+
+	EngineParameters resonant;
+	resonant.size = 1.0f;
+	resonant.resonance = 0.7f;
+	resonant.attenuation = 0.5f;
+
+	EngineParameters small;
+	small.size = 0.2f;
+	small.absorbtion = 0.8f;
+	small.resonance = 0.3f;
+	small.mix = 1.0f;
+	small.volume = -6.0f;
+
+	const std::pair<const char*, EngineParameters> allParameters[] = { { "plain", plain }, { "resonant", resonant }, { "small", small } };
+	const ReflectionMode modes[] = { ReflectionMode::Room, ReflectionMode::Hall, ReflectionMode::HallEco, ReflectionMode::Custom };
+
+	std::vector<GoldenCase> cases;
+
+	auto add = [&cases](ReflectionMode mode, const char* parametersName, EngineParameters parameters,
+						int sampleRate, Signal signal, WetRate wetRate)
+	{
+		GoldenCase golden;
+		parameters.mode = mode;
+		golden.parameters = parameters;
+		golden.sampleRate = sampleRate;
+		golden.signal = signal;
+		golden.wetRate = wetRate;
+		golden.name = std::string(modeName(mode)) + "_" + parametersName + "_" + std::to_string(sampleRate) + "_"
+					+ signalName(signal) + (wetRate == WetRate::Reduced ? "_reduced" : "");
+		cases.push_back(golden);
+	};
+
+	for (ReflectionMode mode : modes)
+	{
+		// Every parameter set at 48 kHz, the resonant one at the other rates
+		for (const auto& named : allParameters)
+		{
+			for (Signal signal : { Signal::Impulse, Signal::Noise, Signal::DualMono })
+				add(mode, named.first, named.second, 48000, signal, WetRate::Full);
+		}
+
+		for (int sampleRate : { 44100, 96000, 192000 })
+		{
+			for (Signal signal : { Signal::Impulse, Signal::Noise })
+				add(mode, "resonant", resonant, sampleRate, signal, WetRate::Full);
+		}
+
+		for (int sampleRate : { 96000, 192000 })
+		{
+			for (Signal signal : { Signal::Impulse, Signal::Noise })
+				add(mode, "resonant", resonant, sampleRate, signal, WetRate::Reduced);
+		}
+	}
+
+	// Parameters that lengthen the tail after the engine went idle on silence
+	EngineParameters shortest = plain;
+	shortest.size = 0.0f;
+
+	EngineParameters grown = plain;
+	grown.size = 1.0f;
+
+	EngineParameters resonating = shortest;
+	resonating.resonance = 0.7f;
+
+	const std::pair<const char*, EngineParameters> changes[] = { { "grow", grown }, { "resonate", resonating } };
+
+	for (ReflectionMode mode : modes)
+	{
+		for (const auto& named : changes)
+		{
+			add(mode, named.first, named.second, 48000, Signal::Impulse, WetRate::Full);
+			cases.back().changes = true;
+			cases.back().before = shortest;
+			cases.back().before.mode = mode;
+		}
+	}
+
+	return cases;
+}
+
+static bool appliesTo(const Variant& variant, const GoldenCase& golden)
+{
+	// Sharing needs identical channels, and reduced rate has its own resampling
+	if (variant.sharing)
+		return golden.signal == Signal::DualMono && golden.wetRate == WetRate::Full;
+
+	if (variant.layout == EngineLayout::Interleaved)
+		return golden.wetRate == WetRate::Full;
+
+	return true;
+}
+
+//==============================================================================
+static void processEngine(EarlyReflectionsEngine& engine, std::vector<std::vector<float>>& audio, int blockSize, WorkerPool* pool)
+{
+	const int numSamples = (int)audio[0].size();
+	float* channels[2];
+
+	for (int offset = 0; offset < numSamples; offset += blockSize)
+	{
+		channels[0] = audio[0].data() + offset;
+		channels[1] = audio[1].data() + offset;
+		engine.process(channels, 2, std::min(blockSize, numSamples - offset), pool);
+	}
+}
+
+static std::vector<std::vector<float>> renderCase(const GoldenCase& golden, const Variant& variant, WorkerPool& pool)
+{
+	EarlyReflectionsEngine engine;
+	engine.setLayout(variant.layout);
+	engine.setConvolutionMode(variant.convolution);
+	engine.setWetRate(golden.wetRate);
+	engine.setHistorySharing(variant.sharing);
+	engine.setDelayStorage(variant.storage);
+	engine.prepare(golden.sampleRate, variant.blockSize, 2);
+	engine.setCustomTaps(getCustomTaps());
+	engine.setParameters(golden.changes ? golden.before : golden.parameters);
+
+	// State left from an earlier render must not leak into the next one
+	if (variant.reprepare)
+	{
+		std::vector<std::vector<float>> previous = makeSignal(Signal::Noise, golden.sampleRate);
+		processEngine(engine, previous, variant.blockSize, nullptr);
+		engine.prepare(golden.sampleRate, variant.blockSize, 2);
+	}
+
+	if (golden.changes)
+	{
+		const int leadIn = (int)(LEAD_IN_SECONDS * golden.sampleRate);
+		std::vector<std::vector<float>> silence(2, std::vector<float>(leadIn, 0.0f));
+		processEngine(engine, silence, variant.blockSize, nullptr);
+		engine.setParameters(golden.parameters);
+	}
+
+	std::vector<std::vector<float>> audio = makeSignal(golden.signal, golden.sampleRate);
+	processEngine(engine, audio, variant.blockSize, variant.threads ? &pool : nullptr);
+
+	return audio;
+}
+
+//==============================================================================
+// The delay with the CPU's tap read kernels against the scalar ones, the
+// engine always runs the widest the CPU has
+struct KernelCase
+{
+	std::string name;
+	ReflectionMode mode;
+	float resonance;
+	DelayStorage storage;
+};
+
+static std::vector<KernelCase> makeKernelCases()
+{
+	std::vector<KernelCase> cases;
+
+	for (ReflectionMode mode : { ReflectionMode::Room, ReflectionMode::Hall, ReflectionMode::HallEco })
+	{
+		for (float resonance : { 0.0f, 0.7f })
+		{
+			for (DelayStorage storage : { DelayStorage::Float, DelayStorage::Compact })
+				cases.push_back({ std::string("kernel_") + modeName(mode) + (resonance > 0.0f ? "_resonant" : "_plain")
+								  + (storage == DelayStorage::Compact ? "_compact" : ""), mode, resonance, storage });
+		}
+	}
+
+	return cases;
+}
+
+static std::vector<float> renderKernelCase(const KernelCase& kernelCase, const TapKernels& kernels)
+{
+	const int sampleRate = 48000;
+	const int blockSize = 512;
+	const int delayScale = EarlyReflectionsEngine::MINIMUM_BUFFER_SIZE
+						 + int(ReflectionModes::TIME_MAX * EarlyReflectionsEngine::ROOM_SIZE_MAX * sampleRate);
+
+	DelayArena arena;
+	arena.prepare(MultiTapDelay::getRequiredStorage(delayScale, blockSize, MultiTapDelay::MAX_TAPS, kernelCase.storage));
+
+	MultiTapDelay delay;
+	delay.init(arena, delayScale, blockSize, MultiTapDelay::MAX_TAPS, kernelCase.storage);
+	delay.setKernels(kernels);
+
+	const ReflectionPattern pattern = ReflectionModes::getPattern(kernelCase.mode);
+	float factors[MultiTapDelay::MAX_TAPS];
+
+	for (int i = 0; i < pattern.count; i++)
+		factors[i] = 0.5f * pattern.times[i] / ReflectionModes::TIME_MAX;
+
+	delay.setTaps(factors, pattern.gains, pattern.count);
+	delay.set(0.3f, kernelCase.resonance);
+
+	const std::vector<float> input = makeSignal(Signal::Noise, sampleRate)[0];
+	const int numSamples = (int)input.size();
+	std::vector<float> output(numSamples);
+
+	for (int offset = 0; offset < numSamples; offset += blockSize)
+		delay.processBlock(input.data() + offset, output.data() + offset, std::min(blockSize, numSamples - offset));
+
+	return output;
+}
+
+//==============================================================================
+// The per line algorithm of the original plugin, kept apart from the engine
+// so the fixed modes can be checked against the sound they started from.
+// Every tap is its own delay line of a low passed comb, the right channel
+// lines are longer by 30 samples.
+namespace Baseline
+{
+	const int MINIMUM_BUFFER_SIZE = 10;
+	const int STEREO_ADDITION = 30;
+	const int ROOM_SIZE_MAX = 2;
+
+	const float roomTimes[] = { 0.0145f, 0.0187f, 0.0233f, 0.0242f, 0.0387f, 0.0303f, 0.0405f };
+	const float roomGains[] = { 0.5968f, 0.5228f, 0.4540f, 0.4421f, 0.2996f, 0.3718f, 0.2871f };
+	const float hallEcoTimes[] = { 0.0199f, 0.0354f, 0.0389f, 0.0414f, 0.0699f, 0.0796f };
+	const float hallEcoGains[] = { 1.200f, 0.818f, 0.635f, 0.719f, 0.267f, 0.242f };
+	const float hallTimes[] = { 0.0043f, 0.0215f, 0.0225f, 0.0268f, 0.0270f, 0.0298f, 0.0458f, 0.0485f, 0.0572f,
+								0.0587f, 0.0595f, 0.0612f, 0.0707f, 0.0708f, 0.0726f, 0.0741f, 0.0753f, 0.0797f };
+	const float hallGains[] = { 0.841f, 0.504f, 0.491f, 0.379f, 0.380f, 0.346f, 0.289f, 0.272f, 0.192f,
+								0.193f, 0.217f, 0.181f, 0.180f, 0.181f, 0.176f, 0.142f, 0.167f, 0.134f };
+
+	struct Line
+	{
+		std::vector<float> buffer;
+		int head = 0;
+		int delay = 0;
+		float gain = 0.0f;
+		float last = 0.0f;
+	};
+
+	// Room, Hall and HallEco at the full rate, the stereo layout of the original
+	static std::vector<std::vector<float>> render(const EngineParameters& parameters, int sampleRate,
+												  std::vector<std::vector<float>> audio)
+	{
+		const float* times = roomTimes;
+		const float* gains = roomGains;
+		int count = 7;
+		float volumeCompensation = 1.0f;
+
+		if (parameters.mode == ReflectionMode::Hall)
+		{
+			times = hallTimes;
+			gains = hallGains;
+			count = 18;
+			volumeCompensation = 0.75f;
+		}
+		else if (parameters.mode == ReflectionMode::HallEco)
+		{
+			times = hallEcoTimes;
+			gains = hallEcoGains;
+			count = 6;
+			volumeCompensation = 0.6f;
+		}
+
+		const float size = 0.01f + 0.99f * parameters.size;
+		const float timeMax = hallTimes[17];
+		const float attenuationInverse = 1.0f - parameters.attenuation;
+		const float mixInverse = 1.0f - parameters.mix;
+		const float volume = parameters.volume > -100.0f ? std::pow(10.0f, parameters.volume * 0.05f) : 0.0f;
+
+		const float mel = 100.0f + (1.0f - parameters.absorbtion) * 3600.0f;
+		const float frequency = 700.0f * (std::exp(mel / 1127.0f) - 1.0f);
+		const float a0 = std::max(std::min(std::pow(frequency / 20000.0f, 0.6f), 1.0f), 0.0f);
+		const float b1 = 1.0f - a0;
+
+		const int samplesMax = MINIMUM_BUFFER_SIZE + int(timeMax * ROOM_SIZE_MAX * sampleRate);
+
+		for (size_t channel = 0; channel < audio.size(); channel++)
+		{
+			const int bufferSize = samplesMax + (channel == 1 ? STEREO_ADDITION : 0);
+			std::vector<Line> lines(count);
+
+			for (int i = 0; i < count; i++)
+			{
+				const float factor = size * times[i] / timeMax;
+				lines[i].buffer.assign(bufferSize, 0.0f);
+				lines[i].delay = (int)(2.0f + bufferSize * factor * 0.98f);
+				lines[i].gain = volumeCompensation * (gains[i] + (1.0f - gains[i]) * attenuationInverse);
+			}
+
+			for (float& sample : audio[channel])
+			{
+				const float in = sample;
+				float out = 0.0f;
+
+				for (Line& line : lines)
+				{
+					int read = line.head + bufferSize - line.delay;
+					if (read >= bufferSize)
+						read -= bufferSize;
+
+					const float delayed = line.buffer[read];
+					line.last = a0 * (in + delayed * parameters.resonance) + b1 * line.last;
+					line.buffer[line.head] = line.last;
+
+					if (++line.head >= bufferSize)
+						line.head = 0;
+
+					out += line.gain * delayed;
+				}
+
+				sample = volume * (parameters.mix * out + mixInverse * in);
+			}
+		}
+
+		return audio;
+	}
+
+	static bool appliesTo(const GoldenCase& golden)
+	{
+		return golden.parameters.mode != ReflectionMode::Custom && golden.wetRate == WetRate::Full;
+	}
+}
+
+//==============================================================================
+static std::string goldenPath(const std::string& dir, const std::string& name)
+{
+	return (std::filesystem::path(dir) / (name + ".wav")).string();
+}
+
+static bool writeGolden(const std::string& dir, const std::string& name, int sampleRate,
+						std::vector<std::vector<float>> channels, std::string& error)
+{
+	WavFile wav;
+	wav.sampleRate = sampleRate;
+	wav.format = WavFile::Format::Float32;
+	wav.channels = std::move(channels);
+
+	return wav.write(goldenPath(dir, name), error);
+}
+
+//==============================================================================
+// Per channel and window the peak, mean, RMS and correlation with a fixed
+// sign sequence. None of them moves by more than the largest sample error,
+// so a render within tolerance of the full reference matches its summary,
+// while a changed level, tail or phase shows in the windows.
+static const int SUMMARY_WINDOW = 4096;
+static const int SUMMARY_STATS = 4;
+static const char* const SUMMARY_FILE = "summary.txt";
+
+// Floor of the tolerance against summaries, other compilers and CPUs round
+// differently than the build that recorded them
+static const double SUMMARY_TOLERANCE = 1.0e-5;
+
+struct Summary
+{
+	int numSamples = 0;
+	// SUMMARY_STATS values per window
+	std::vector<std::vector<double>> channels;
+};
+
+static Summary summarize(const std::vector<std::vector<float>>& channels)
+{
+	Summary summary;
+	summary.numSamples = channels.empty() ? 0 : (int)channels[0].size();
+
+	for (const auto& samples : channels)
+	{
+		std::vector<double> stats;
+		unsigned int seed = 1;
+
+		for (size_t begin = 0; begin < samples.size(); begin += SUMMARY_WINDOW)
+		{
+			const size_t end = std::min(samples.size(), begin + SUMMARY_WINDOW);
+			double peak = 0.0, sum = 0.0, squares = 0.0, correlation = 0.0;
+
+			for (size_t n = begin; n < end; n++)
+			{
+				const double sample = samples[n];
+				seed = seed * 1664525u + 1013904223u;
+
+				peak = std::max(peak, std::abs(sample));
+				sum += sample;
+				squares += sample * sample;
+				correlation += (seed & 0x80000000u) != 0 ? sample : -sample;
+			}
+
+			const double count = (double)(end - begin);
+			stats.insert(stats.end(), { peak, sum / count, std::sqrt(squares / count), correlation / count });
+		}
+
+		summary.channels.push_back(std::move(stats));
+	}
+
+	return summary;
+}
+
+// Largest difference of a statistic, or a negative value when the shapes differ
+static double maxError(const Summary& golden, const Summary& rendered)
+{
+	if (golden.numSamples != rendered.numSamples || golden.channels.size() != rendered.channels.size())
+		return -1.0;
+
+	double error = 0.0;
+
+	for (size_t channel = 0; channel < golden.channels.size(); channel++)
+	{
+		if (golden.channels[channel].size() != rendered.channels[channel].size())
+			return -1.0;
+
+		for (size_t i = 0; i < golden.channels[channel].size(); i++)
+			error = std::max(error, std::abs(golden.channels[channel][i] - rendered.channels[channel][i]));
+	}
+
+	return error;
+}
+
+// case <name> <channels> <samples>, then one line of statistics per window
+static bool writeSummaries(const std::string& dir, const std::map<std::string, Summary>& summaries, std::string& error)
+{
+	const std::string path = (std::filesystem::path(dir) / SUMMARY_FILE).string();
+	std::ofstream file(path);
+
+	if (!file)
+	{
+		error = "cannot write " + path;
+		return false;
+	}
+
+	file << "# er_golden summary, window " << SUMMARY_WINDOW << ": peak mean rms correlation\n";
+	file.precision(9);
+
+	for (const auto& entry : summaries)
+	{
+		const Summary& summary = entry.second;
+		file << "case " << entry.first << " " << summary.channels.size() << " " << summary.numSamples << "\n";
+
+		for (const auto& stats : summary.channels)
+		{
+			for (size_t i = 0; i < stats.size(); i += SUMMARY_STATS)
+				file << stats[i] << " " << stats[i + 1] << " " << stats[i + 2] << " " << stats[i + 3] << "\n";
+		}
+	}
+
+	return true;
+}
+
+// A missing file is no error, the check then only has the renders
+static bool readSummaries(const std::string& dir, std::map<std::string, Summary>& summaries, std::string& error)
+{
+	const std::string path = (std::filesystem::path(dir) / SUMMARY_FILE).string();
+	std::ifstream file(path);
+
+	if (!file)
+		return true;
+
+	std::string line;
+
+	while (std::getline(file, line))
+	{
+		if (line.empty() || line[0] == '#')
+			continue;
+
+		std::istringstream header(line);
+		std::string keyword, name;
+		size_t numChannels = 0;
+		Summary summary;
+
+		if (!(header >> keyword >> name >> numChannels >> summary.numSamples) || keyword != "case")
+		{
+			error = "malformed line in " + path + ": " + line;
+			return false;
+		}
+
+		const size_t numWindows = ((size_t)summary.numSamples + SUMMARY_WINDOW - 1) / SUMMARY_WINDOW;
+		summary.channels.assign(numChannels, std::vector<double>(numWindows * SUMMARY_STATS));
+
+		for (auto& stats : summary.channels)
+		{
+			for (double& value : stats)
+			{
+				if (!(file >> value))
+				{
+					error = "truncated summary of " + name + " in " + path;
+					return false;
+				}
+			}
+		}
+
+		summaries[name] = std::move(summary);
+		file >> std::ws;
+	}
+
+	return true;
+}
+
+// Largest absolute difference, or a negative value when the shapes differ
+static double maxError(const std::vector<std::vector<float>>& golden, const std::vector<std::vector<float>>& rendered)
+{
+	if (golden.size() != rendered.size())
+		return -1.0;
+
+	double error = 0.0;
+
+	for (size_t channel = 0; channel < golden.size(); channel++)
+	{
+		if (golden[channel].size() != rendered[channel].size())
+			return -1.0;
+
+		for (size_t n = 0; n < golden[channel].size(); n++)
+			error = std::max(error, (double)std::abs(golden[channel][n] - rendered[channel][n]));
+	}
+
+	return error;
+}
+
+static double toDb(double value)
+{
+	return value > 0.0 ? 20.0 * std::log10(value) : -999.0;
+}
+
+//==============================================================================
+struct GoldenSettings
+{
+	bool record = false;
+	std::string dir;
+	std::string filter;
+	bool verbose = false;
+	bool summaryOnly = false;
+
+	bool wants(const std::string& name) const
+	{
+		return filter.empty() || name.find(filter) != std::string::npos;
+	}
+};
+
+static void printUsage()
+{
+	printf("Usage: er_golden record|check <dir> [options]\n"
+		   "\n"
+		   "  record                  Render the reference of every case into <dir>\n"
+		   "  check                   Render every variant and compare it with <dir>\n"
+		   "  --filter <name>         Only cases whose name contains <name>\n"
+		   "  --summary               Record only the summary, without the renders\n"
+		   "  --verbose               Print passing checks too\n");
+}
+
+static bool parseArguments(int argc, char** argv, GoldenSettings& settings)
+{
+	if (argc < 3)
+		return false;
+
+	const std::string command = argv[1];
+	if (command != "record" && command != "check")
+		return false;
+
+	settings.record = command == "record";
+	settings.dir = argv[2];
+
+	for (int i = 3; i < argc; i++)
+	{
+		const std::string arg = argv[i];
+
+		if (arg == "--filter" && i + 1 < argc)
+			settings.filter = argv[++i];
+		else if (arg == "--summary")
+			settings.summaryOnly = true;
+		else if (arg == "--verbose")
+			settings.verbose = true;
+		else
+			return false;
+	}
+
+	return true;
+}
+
+static int record(const GoldenSettings& settings, WorkerPool& pool)
+{
+	std::error_code ec;
+	std::filesystem::create_directories(settings.dir, ec);
+
+	std::map<std::string, Summary> summaries;
+	std::string error;
+
+	// Recording a subset keeps the summaries of the other cases
+	if (!readSummaries(settings.dir, summaries, error))
+	{
+		fprintf(stderr, "error: %s\n", error.c_str());
+		return 1;
+	}
+
+	int written = 0;
+
+	auto write = [&settings, &summaries, &written, &error](const std::string& name, int sampleRate,
+														   std::vector<std::vector<float>> channels)
+	{
+		summaries[name] = summarize(channels);
+		written++;
+
+		return settings.summaryOnly || writeGolden(settings.dir, name, sampleRate, std::move(channels), error);
+	};
+
+	for (const GoldenCase& golden : makeCases())
+	{
+		if (!settings.wants(golden.name))
+			continue;
+
+		if (!write(golden.name, golden.sampleRate, renderCase(golden, variants[0], pool)))
+		{
+			fprintf(stderr, "error: %s\n", error.c_str());
+			return 1;
+		}
+	}
+
+	for (const KernelCase& kernelCase : makeKernelCases())
+	{
+		if (!settings.wants(kernelCase.name))
+			continue;
+
+		if (!write(kernelCase.name, 48000, { renderKernelCase(kernelCase, getScalarTapKernels()) }))
+		{
+			fprintf(stderr, "error: %s\n", error.c_str());
+			return 1;
+		}
+	}
+
+	if (!writeSummaries(settings.dir, summaries, error))
+	{
+		fprintf(stderr, "error: %s\n", error.c_str());
+		return 1;
+	}
+
+	printf("%d golden %s written to %s\n", written, settings.summaryOnly ? "summaries" : "renders", settings.dir.c_str());
+	return 0;
+}
+
+static int check(const GoldenSettings& settings, WorkerPool& pool)
+{
+	int checked = 0;
+	int failed = 0;
+
+	std::map<std::string, Summary> summaries;
+	std::string error;
+
+	if (!readSummaries(settings.dir, summaries, error))
+	{
+		fprintf(stderr, "error: %s\n", error.c_str());
+		return 1;
+	}
+
+	auto compare = [&settings, &summaries, &checked, &failed](const std::string& name, const char* variant, double tolerance,
+															  const std::function<std::vector<std::vector<float>>()>& render)
+	{
+		const std::string path = goldenPath(settings.dir, name);
+		const auto summary = summaries.find(name);
+		double maxErr;
+
+		// The full render when there is one, else its summary
+		if (std::filesystem::exists(path) || summary == summaries.end())
+		{
+			WavFile wav;
+			std::string error;
+
+			if (!wav.read(path, error))
+			{
+				fprintf(stderr, "error: %s\n", error.c_str());
+				failed++;
+				return;
+			}
+
+			maxErr = maxError(wav.channels, render());
+		}
+		else
+		{
+			tolerance = std::max(tolerance, SUMMARY_TOLERANCE);
+			maxErr = maxError(summary->second, summarize(render()));
+		}
+
+		const bool pass = maxErr >= 0.0 && maxErr <= tolerance;
+
+		checked++;
+		failed += pass ? 0 : 1;
+
+		if (!pass || settings.verbose)
+			printf("%-4s %-44s %-14s max error %8.1f dB  (limit %.1f dB)\n", pass ? "ok" : "FAIL",
+				   name.c_str(), variant, maxErr < 0.0 ? 0.0 : toDb(maxErr), toDb(tolerance));
+	};
+
+	for (const GoldenCase& golden : makeCases())
+	{
+		if (!settings.wants(golden.name))
+			continue;
+
+		for (const Variant& variant : variants)
+		{
+			if (appliesTo(variant, golden))
+				compare(golden.name, variant.name, variant.tolerance, [&] { return renderCase(golden, variant, pool); });
+		}
+
+		if (Baseline::appliesTo(golden))
+		{
+			const double maxErr = maxError(Baseline::render(golden.parameters, golden.sampleRate, makeSignal(golden.signal, golden.sampleRate)),
+										   renderCase(golden, variants[0], pool));
+			const bool pass = maxErr >= 0.0 && maxErr <= BASELINE_TOLERANCE;
+
+			checked++;
+			failed += pass ? 0 : 1;
+
+			if (!pass || settings.verbose)
+				printf("%-4s %-44s %-14s max error %8.1f dB  (limit %.1f dB)\n", pass ? "ok" : "FAIL",
+					   golden.name.c_str(), "baseline", maxErr < 0.0 ? 0.0 : toDb(maxErr), toDb(BASELINE_TOLERANCE));
+		}
+	}
+
+	for (const KernelCase& kernelCase : makeKernelCases())
+	{
+		if (!settings.wants(kernelCase.name))
+			continue;
+
+		const double tolerance = kernelCase.storage == DelayStorage::Compact ? KERNEL_COMPACT_TOLERANCE : KERNEL_TOLERANCE;
+
+		compare(kernelCase.name, "scalar", tolerance,
+				[&] { return std::vector<std::vector<float>> { renderKernelCase(kernelCase, getScalarTapKernels()) }; });
+		compare(kernelCase.name, getTapKernels().name, tolerance,
+				[&] { return std::vector<std::vector<float>> { renderKernelCase(kernelCase, getTapKernels()) }; });
+	}
+
+	printf("%d checks, %d failed\n", checked, failed);
+	return failed > 0 ? 2 : 0;
+}
+
+//==============================================================================
+int main(int argc, char** argv)
+{
+	GoldenSettings settings;
+
+	if (!parseArguments(argc, argv, settings))
+	{
+		printUsage();
+		return 1;
+	}
+
+	WorkerPool pool(2);
+
+	return settings.record ? record(settings, pool) : check(settings, pool);
+}
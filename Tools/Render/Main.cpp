@@ -0,0 +1,294 @@
+/*
+  ==============================================================================
+
+    Offline renderer: runs EarlyReflectionsEngine over WAV files, one file
+    per job, spread across all cores.
+
+    er_render [options] -o <output dir> <input.wav>...
+
+    Builds with ER_INSTRUMENTATION=1 can write the cost of every block.
+
+  ==============================================================================
+*/
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "BlockProfiler.h"
+#include "EarlyReflectionsEngine.h"
+#include "WorkerPool.h"
+#include "WavFile.h"
+
+//==============================================================================
+struct RenderSettings
+{
+	EngineParameters parameters;
+	std::string outputDir;
+	std::vector<std::string> inputs;
+	EngineLayout layout = EngineLayout::Planar;
+	ConvolutionMode convolution = ConvolutionMode::Automatic;
+	WetRate wetRate = WetRate::Full;
+	DelayStorage storage = DelayStorage::Float;
+	int blockSize = 512;
+	int threads = 0;
+	std::shared_ptr<const TapSet> customTaps;
+	bool profile = false;
+	float overrunThreshold = 0.5f;
+};
+
+static void printUsage()
+{
+	printf("Usage: er_render [options] -o <output dir> <input.wav>...\n"
+		   "\n"
+		   "  --mode <name>               room, hall, hall-eco or custom (ButtonA-D), default room\n"
+		   "  --room <WxDxH[:order:abs]>  Custom room in meters, implies custom, e.g. 4x6.5x2.5:3:0.3\n"
+		   "  --size <0..1>               Size, default 0.5\n"
+		   "  --absorbtion <0..1>         Absorbtion, default 0\n"
+		   "  --attenuation <0..1>        Attenuation, default 1\n"
+		   "  --resonance <0..1>          Resonance, default 0\n"
+		   "  --mix <0..1>                Mix, default 0.5\n"
+		   "  --volume <-12..12>          Volume in dB, default 0\n"
+		   "  --quality <name>            full, balanced or eco, level of detail of the taps, default full\n"
+		   "  --interleaved               Process stereo files with the interleaved engine layout\n"
+		   "  --convolution <name>        auto, off or always, FFT convolution of dense taps, default auto\n"
+		   "  --reduced-rate              Run the reflections at 44.1/48 kHz on high sample rates\n"
+		   "  --compact-storage           Keep the delay history as 16 bit samples, overrides --interleaved\n"
+		   "  --block <samples>           Processing block size, default 512\n"
+		   "  --threads <n>               Worker threads, default one per core\n"
+		   "  --profile [share]           Per block cost as <output>.profile.csv, blocks above share of\n"
+		   "                              their duration count as overruns, default 0.5\n"
+		   "                              (builds with ER_INSTRUMENTATION only)\n");
+}
+
+static bool parseArguments(int argc, char** argv, RenderSettings& settings)
+{
+	for (int i = 1; i < argc; i++)
+	{
+		const std::string arg = argv[i];
+		const bool hasValue = i + 1 < argc;
+
+		if (arg == "-h" || arg == "--help")
+			return false;
+		else if (arg == "-o" && hasValue)
+			settings.outputDir = argv[++i];
+		else if (arg == "--mode" && hasValue)
+		{
+			const std::string mode = argv[++i];
+			if (mode == "room")
+				settings.parameters.mode = ReflectionMode::Room;
+			else if (mode == "hall")
+				settings.parameters.mode = ReflectionMode::Hall;
+			else if (mode == "hall-eco")
+				settings.parameters.mode = ReflectionMode::HallEco;
+			else if (mode == "custom")
+				settings.parameters.mode = ReflectionMode::Custom;
+			else
+				return false;
+		}
+		else if (arg == "--room" && hasValue)
+		{
+			RoomGeometry room;
+			if (sscanf(argv[++i], "%fx%fx%f:%d:%f", &room.width, &room.depth, &room.height, &room.order, &room.wallAbsorption) < 3)
+				return false;
+
+			settings.customTaps = RoomGeometryGenerator::getShared(room);
+			settings.parameters.mode = ReflectionMode::Custom;
+		}
+		else if (arg == "--size" && hasValue)
+			settings.parameters.size = (float)atof(argv[++i]);
+		else if (arg == "--absorbtion" && hasValue)
+			settings.parameters.absorbtion = (float)atof(argv[++i]);
+		else if (arg == "--attenuation" && hasValue)
+			settings.parameters.attenuation = (float)atof(argv[++i]);
+		else if (arg == "--resonance" && hasValue)
+			settings.parameters.resonance = (float)atof(argv[++i]);
+		else if (arg == "--mix" && hasValue)
+			settings.parameters.mix = (float)atof(argv[++i]);
+		else if (arg == "--volume" && hasValue)
+			settings.parameters.volume = (float)atof(argv[++i]);
+		else if (arg == "--quality" && hasValue)
+		{
+			const std::string quality = argv[++i];
+			if (quality == "full")
+				settings.parameters.quality = TapQuality::Full;
+			else if (quality == "balanced")
+				settings.parameters.quality = TapQuality::Balanced;
+			else if (quality == "eco")
+				settings.parameters.quality = TapQuality::Eco;
+			else
+				return false;
+		}
+		else if (arg == "--interleaved")
+			settings.layout = EngineLayout::Interleaved;
+		else if (arg == "--convolution" && hasValue)
+		{
+			const std::string mode = argv[++i];
+			if (mode == "auto")
+				settings.convolution = ConvolutionMode::Automatic;
+			else if (mode == "off")
+				settings.convolution = ConvolutionMode::Off;
+			else if (mode == "always")
+				settings.convolution = ConvolutionMode::Always;
+			else
+				return false;
+		}
+		else if (arg == "--reduced-rate")
+			settings.wetRate = WetRate::Reduced;
+		else if (arg == "--compact-storage")
+			settings.storage = DelayStorage::Compact;
+		else if (arg == "--block" && hasValue)
+			settings.blockSize = std::max(1, atoi(argv[++i]));
+		else if (arg == "--threads" && hasValue)
+			settings.threads = atoi(argv[++i]);
+		else if (arg == "--profile")
+		{
+#if ER_INSTRUMENTATION
+			settings.profile = true;
+			if (hasValue && atof(argv[i + 1]) > 0.0)
+				settings.overrunThreshold = (float)atof(argv[++i]);
+#else
+			fprintf(stderr, "error: --profile needs a build with ER_INSTRUMENTATION\n");
+			return false;
+#endif
+		}
+		else if (!arg.empty() && arg[0] == '-')
+			return false;
+		else
+			settings.inputs.push_back(arg);
+	}
+
+	return !settings.outputDir.empty() && !settings.inputs.empty();
+}
+
+static bool renderFile(const RenderSettings& settings, const std::string& input, WorkerPool* channelPool, std::string& error)
+{
+	WavFile wav;
+	if (!wav.read(input, error))
+		return false;
+
+	const int numChannels = wav.getNumChannels();
+	const int numSamples = wav.getNumSamples();
+
+	if (numChannels > EarlyReflectionsEngine::MAX_CHANNELS)
+	{
+		error = input + ": more than " + std::to_string(EarlyReflectionsEngine::MAX_CHANNELS) + " channels";
+		return false;
+	}
+
+	EarlyReflectionsEngine engine;
+	engine.setLayout(settings.layout);
+	engine.setConvolutionMode(settings.convolution);
+	engine.setWetRate(settings.wetRate);
+	engine.setDelayStorage(settings.storage);
+	engine.prepare(wav.sampleRate, settings.blockSize, numChannels);
+	engine.setCustomTaps(settings.customTaps);
+	engine.setParameters(settings.parameters);
+
+	std::vector<float*> channels(numChannels);
+
+#if ER_INSTRUMENTATION
+	BlockProfiler profiler;
+	profiler.prepare(wav.sampleRate);
+	profiler.setOverrunThreshold(settings.overrunThreshold);
+	ProfileLog profileLog;
+#endif
+
+	for (int offset = 0; offset < numSamples; offset += settings.blockSize)
+	{
+		for (int channel = 0; channel < numChannels; channel++)
+			channels[channel] = wav.channels[channel].data() + offset;
+
+#if ER_INSTRUMENTATION
+		const long long profileStart = settings.profile ? BlockProfiler::now() : 0;
+#endif
+
+		const int count = std::min(settings.blockSize, numSamples - offset);
+		engine.process(channels.data(), numChannels, count, channelPool);
+
+#if ER_INSTRUMENTATION
+		if (settings.profile)
+		{
+			profiler.record(profileStart, count, engine.getActiveTapCount(), engine.getMode(), engine.isIdle(), engine.isHistoryShared());
+			profileLog.collect(profiler);
+		}
+#endif
+	}
+
+	const std::filesystem::path output = std::filesystem::path(settings.outputDir) / std::filesystem::path(input).filename();
+
+#if ER_INSTRUMENTATION
+	if (settings.profile)
+	{
+		std::filesystem::path profilePath = output;
+		profilePath.replace_extension(".profile.csv");
+
+		if (!profileLog.writeCsv(profilePath.string()))
+		{
+			error = profilePath.string() + ": cannot write";
+			return false;
+		}
+
+		printf("%s: %s\n", input.c_str(), profileLog.getSummary(profiler).c_str());
+	}
+#endif
+
+	return wav.write(output.string(), error);
+}
+
+//==============================================================================
+int main(int argc, char** argv)
+{
+	RenderSettings settings;
+
+	if (!parseArguments(argc, argv, settings))
+	{
+		printUsage();
+		return 1;
+	}
+
+	std::error_code ec;
+	std::filesystem::create_directories(settings.outputDir, ec);
+
+	std::atomic<int> failed { 0 };
+	std::mutex printMutex;
+
+	auto render = [&settings, &failed, &printMutex](const std::string& input, WorkerPool* channelPool)
+	{
+		std::string error;
+		const bool ok = renderFile(settings, input, channelPool, error);
+
+		std::lock_guard<std::mutex> lock(printMutex);
+		if (ok)
+			printf("%s\n", input.c_str());
+		else
+		{
+			fprintf(stderr, "error: %s\n", error.c_str());
+			failed++;
+		}
+	};
+
+	{
+		WorkerPool pool(settings.threads);
+
+		// A single file spreads its channels over the pool, several files
+		// get one job each. Never both, jobs must not wait on their own pool.
+		if (settings.inputs.size() == 1)
+			render(settings.inputs[0], &pool);
+		else
+		{
+			for (const auto& input : settings.inputs)
+				pool.submit([&render, input] { render(input, nullptr); });
+
+			pool.wait();
+		}
+	}
+
+	return failed > 0 ? 1 : 0;
+}
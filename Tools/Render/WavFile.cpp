@@ -0,0 +1,186 @@
+/*
+  ==============================================================================
+
+    Minimal RIFF/WAVE reader and writer for the offline tools.
+
+  ==============================================================================
+*/
+
+#include "WavFile.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+
+//==============================================================================
+static uint32_t readLE(const unsigned char* data, int bytes)
+{
+	uint32_t value = 0;
+	for (int i = 0; i < bytes; i++)
+		value |= (uint32_t)data[i] << (8 * i);
+	return value;
+}
+
+static void writeLE(std::vector<unsigned char>& out, uint32_t value, int bytes)
+{
+	for (int i = 0; i < bytes; i++)
+		out.push_back((unsigned char)(value >> (8 * i)));
+}
+
+static int bytesPerSample(WavFile::Format format)
+{
+	switch (format)
+	{
+		case WavFile::Format::Pcm16: return 2;
+		case WavFile::Format::Pcm24: return 3;
+		default:                     return 4;
+	}
+}
+
+//==============================================================================
+bool WavFile::read(const std::string& path, std::string& error)
+{
+	std::ifstream file(path, std::ios::binary);
+	if (!file)
+	{
+		error = "cannot open " + path;
+		return false;
+	}
+
+	std::vector<unsigned char> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+	if (data.size() < 12 || memcmp(data.data(), "RIFF", 4) != 0 || memcmp(data.data() + 8, "WAVE", 4) != 0)
+	{
+		error = path + " is not a RIFF/WAVE file";
+		return false;
+	}
+
+	int numChannels = 0;
+	int bitsPerSample = 0;
+	int formatTag = 0;
+	const unsigned char* samples = nullptr;
+	size_t samplesSize = 0;
+
+	for (size_t pos = 12; pos + 8 <= data.size(); )
+	{
+		const unsigned char* chunk = data.data() + pos;
+		const size_t chunkSize = std::min((size_t)readLE(chunk + 4, 4), data.size() - pos - 8);
+
+		if (memcmp(chunk, "fmt ", 4) == 0 && chunkSize >= 16)
+		{
+			formatTag = (int)readLE(chunk + 8, 2);
+			numChannels = (int)readLE(chunk + 10, 2);
+			sampleRate = (int)readLE(chunk + 12, 4);
+			bitsPerSample = (int)readLE(chunk + 22, 2);
+
+			// WAVE_FORMAT_EXTENSIBLE keeps the real tag in the sub format GUID
+			if (formatTag == 0xFFFE && chunkSize >= 26)
+				formatTag = (int)readLE(chunk + 32, 2);
+		}
+		else if (memcmp(chunk, "data", 4) == 0)
+		{
+			samples = chunk + 8;
+			samplesSize = chunkSize;
+		}
+
+		pos += 8 + chunkSize + (chunkSize & 1);
+	}
+
+	if (formatTag == 1 && bitsPerSample == 16)
+		format = Format::Pcm16;
+	else if (formatTag == 1 && bitsPerSample == 24)
+		format = Format::Pcm24;
+	else if (formatTag == 1 && bitsPerSample == 32)
+		format = Format::Pcm32;
+	else if (formatTag == 3 && bitsPerSample == 32)
+		format = Format::Float32;
+	else
+	{
+		error = path + ": unsupported sample format";
+		return false;
+	}
+
+	if (numChannels <= 0 || samples == nullptr)
+	{
+		error = path + ": missing fmt or data chunk";
+		return false;
+	}
+
+	const int bytes = bytesPerSample(format);
+	const int numSamples = (int)(samplesSize / (bytes * numChannels));
+
+	channels.assign(numChannels, std::vector<float>(numSamples));
+
+	for (int i = 0; i < numSamples; i++)
+	{
+		for (int channel = 0; channel < numChannels; channel++)
+		{
+			const unsigned char* p = samples + ((size_t)i * numChannels + channel) * bytes;
+			float value = 0.0f;
+
+			switch (format)
+			{
+				case Format::Pcm16:   value = (int16_t)readLE(p, 2) / 32768.0f; break;
+				case Format::Pcm24:   value = ((int32_t)(readLE(p, 3) << 8) >> 8) / 8388608.0f; break;
+				case Format::Pcm32:   value = (float)((int32_t)readLE(p, 4) / 2147483648.0); break;
+				case Format::Float32: { const uint32_t bits = readLE(p, 4); memcpy(&value, &bits, 4); } break;
+			}
+
+			channels[channel][i] = value;
+		}
+	}
+
+	return true;
+}
+
+bool WavFile::write(const std::string& path, std::string& error) const
+{
+	const int numChannels = getNumChannels();
+	const int numSamples = getNumSamples();
+	const int bytes = bytesPerSample(format);
+	const uint32_t dataSize = (uint32_t)numSamples * numChannels * bytes;
+
+	std::vector<unsigned char> out;
+	out.reserve(44 + dataSize);
+
+	out.insert(out.end(), { 'R', 'I', 'F', 'F' });
+	writeLE(out, 36 + dataSize, 4);
+	out.insert(out.end(), { 'W', 'A', 'V', 'E', 'f', 'm', 't', ' ' });
+	writeLE(out, 16, 4);
+	writeLE(out, format == Format::Float32 ? 3 : 1, 2);
+	writeLE(out, numChannels, 2);
+	writeLE(out, sampleRate, 4);
+	writeLE(out, sampleRate * numChannels * bytes, 4);
+	writeLE(out, numChannels * bytes, 2);
+	writeLE(out, bytes * 8, 2);
+	out.insert(out.end(), { 'd', 'a', 't', 'a' });
+	writeLE(out, dataSize, 4);
+
+	for (int i = 0; i < numSamples; i++)
+	{
+		for (int channel = 0; channel < numChannels; channel++)
+		{
+			const float value = channels[channel][i];
+			const double clipped = std::max(-1.0, std::min(1.0, (double)value));
+
+			switch (format)
+			{
+				case Format::Pcm16:   writeLE(out, (uint32_t)(int32_t)std::lrint(std::min(clipped * 32768.0, 32767.0)), 2); break;
+				case Format::Pcm24:   writeLE(out, (uint32_t)(int32_t)std::lrint(std::min(clipped * 8388608.0, 8388607.0)), 3); break;
+				case Format::Pcm32:   writeLE(out, (uint32_t)(int32_t)std::llrint(std::min(clipped * 2147483648.0, 2147483647.0)), 4); break;
+				case Format::Float32: { uint32_t bits; memcpy(&bits, &value, 4); writeLE(out, bits, 4); } break;
+			}
+		}
+	}
+
+	std::ofstream file(path, std::ios::binary);
+	if (!file.write((const char*)out.data(), (std::streamsize)out.size()))
+	{
+		error = "cannot write " + path;
+		return false;
+	}
+
+	return true;
+}
@@ -0,0 +1,38 @@
+/*
+  ==============================================================================
+
+    Minimal RIFF/WAVE reader and writer for the offline tools.
+    Supports 16/24/32 bit PCM and 32 bit float, including
+    WAVE_FORMAT_EXTENSIBLE headers.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+//==============================================================================
+struct WavFile
+{
+	enum class Format
+	{
+		Pcm16,
+		Pcm24,
+		Pcm32,
+		Float32
+	};
+
+	int sampleRate = 48000;
+	Format format = Format::Float32;
+
+	// Planar samples, one vector per channel
+	std::vector<std::vector<float>> channels;
+
+	int getNumChannels() const { return (int)channels.size(); }
+	int getNumSamples() const { return channels.empty() ? 0 : (int)channels[0].size(); }
+
+	bool read(const std::string& path, std::string& error);
+	bool write(const std::string& path, std::string& error) const;
+};